@@ -2,6 +2,10 @@
 #include <stdlib.h>
 #include <nbredis/redis_non_block.h>
 #include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
 
 #define MAX_REDIS_CONNECT 2
 int rd_array[MAX_REDIS_CONNECT] = {-1};
@@ -42,6 +46,206 @@ int my_callback(char *private , int private_len , REDIS_CB_RESULT result , int a
   return 0;
 }
 
+/***demo paths. ./demo [io|uring|cluster|wait]*/
+static int demo_done = 0;
+int demo_callback(char *private , int private_len , REDIS_CB_RESULT result , int argc , char *argv[] , int arglen[])
+{
+  demo_done++;
+  return my_callback(private , private_len , result , argc , argv , arglen);
+}
+
+static long long demo_ms()
+{
+  struct timeval tv;
+  gettimeofday(&tv , NULL);
+  return tv.tv_sec*1000LL + tv.tv_usec/1000;
+}
+
+//drive default context until rd connected or timeout
+//return:0<connected> -1<failed>
+static int demo_wait_connect(int rd , int timeout_ms)
+{
+  long long end = demo_ms() + timeout_ms;
+  while(demo_ms() < end)
+  {
+    redis_wait(10);
+    if(redis_isconnect(rd) == REDIS_CONN_FLG_CONNECTED)
+      return 0;
+  }
+  printf("connect failed!\n");
+  return -1;
+}
+
+//cmds and replies pass through rings of an io thread. callbacks run on this thread
+int demo_io(char *ip , int port , int log_level)
+{
+  redis_ctx_t *ctx = NULL;
+  redis_io_t *io = NULL;
+  long long end = 0;
+  int rd = -1;
+  int i = 0;
+  char private[32] = {0};
+
+  ctx = redis_ctx_open();
+  if(!ctx)
+    return -1;
+  redis_ctx_use(ctx);
+  rd = redis_open(ip , port , 5 , log_level);
+  redis_ctx_use(NULL);
+  if(rd < 0)
+  {
+    redis_ctx_close(ctx);
+    return -1;
+  }
+
+  //ctx belongs to io thread from now on
+  io = redis_io_start(ctx , 0);
+  if(!io)
+  {
+    redis_ctx_close(ctx);
+    return -1;
+  }
+
+  demo_done = 0;
+  for(i=0; i<8; i++)
+  {
+    snprintf(private , sizeof(private) , "IO INCR:%d" , i);
+    if(redis_io_exec(io , rd , "INCR demo_io_counter" , demo_callback , private , strlen(private)) < 0)
+      printf("submission ring full!\n");
+  }
+
+  end = demo_ms() + 3000;
+  while(demo_done<8 && demo_ms()<end)
+    redis_poll_completions(io , 0);
+
+  //cmds still in flight are called back with CB_RET_DISCONNECT
+  redis_io_exec(io , rd , "PING" , demo_callback , "IO PING" , strlen("IO PING"));
+  return redis_io_stop(io);
+}
+
+//sends and recvs of all rds reaped from one io_uring per tick
+int demo_uring(char *ip , int port , int log_level)
+{
+  long long end = 0;
+  int rd = -1;
+  int i = 0;
+  char private[32] = {0};
+
+  redis_set_backend(REDIS_BACKEND_URING);
+  rd = redis_open(ip , port , 5 , log_level);
+  if(rd < 0)
+    return -1;
+  printf("backend:%s\n" , redis_get_backend()==REDIS_BACKEND_URING?"io_uring":"epoll(fallback)");
+  if(demo_wait_connect(rd , 5000) < 0)
+    goto _end;
+
+  demo_done = 0;
+  for(i=0; i<16; i++)
+  {
+    snprintf(private , sizeof(private) , "URING LPUSH:%d" , i);
+    redis_exec(rd , "LPUSH demo_uring_list x" , demo_callback , private , strlen(private));
+  }
+  redis_exec(rd , "LRANGE demo_uring_list 0 3" , demo_callback , "URING LRANGE" , strlen("URING LRANGE"));
+  redis_exec(rd , "DEL demo_uring_list" , demo_callback , "URING DEL" , strlen("URING DEL"));
+
+  end = demo_ms() + 3000;
+  while(demo_done<18 && demo_ms()<end)
+    redis_wait(10);
+
+_end:
+  redis_close(rd);
+  return 0;
+}
+
+//keys spread over nodes. MOVED/ASK replies are followed transparently
+//cmds sent before slot map is loaded go to seed node and are redirected
+int demo_cluster(char *ip , int port , int log_level)
+{
+  long long end = 0;
+  int cd = -1;
+  int i = 0;
+  char key[32] = {0};
+  char cmd[64] = {0};
+  char private[64] = {0};
+
+  cd = redis_cluster_open(ip , port , 5 , log_level);
+  if(cd < 0)
+    return -1;
+
+  //slot map is loaded in tick
+  end = demo_ms() + 5000;
+  while(redis_cluster_rd(cd , "demo" , 4)<0 && demo_ms()<end)
+    redis_wait(10);
+  if(redis_cluster_rd(cd , "demo" , 4) < 0)
+  {
+    printf("cluster not ready!\n");
+    redis_cluster_close(cd);
+    return -1;
+  }
+
+  demo_done = 0;
+  for(i=0; i<8; i++)
+  {
+    snprintf(key , sizeof(key) , "demo_key:%d" , i);
+    snprintf(cmd , sizeof(cmd) , "SET %s %d" , key , i);
+    snprintf(private , sizeof(private) , "CLUSTER %s rd:%d" , cmd , redis_cluster_rd(cd , key , strlen(key)));
+    redis_cluster_exec(cd , cmd , demo_callback , private , strlen(private));
+  }
+  //{tag} keeps keys in one slot
+  redis_cluster_exec(cd , "MSET {demo}a 1 {demo}b 2" , demo_callback , "CLUSTER MSET" , strlen("CLUSTER MSET"));
+  redis_cluster_exec(cd , "PING" , demo_callback , "CLUSTER PING" , strlen("CLUSTER PING")); //keyless,any node
+
+  end = demo_ms() + 3000;
+  while(demo_done<10 && demo_ms()<end)
+    redis_wait(10);
+
+  redis_cluster_close(cd);
+  return 0;
+}
+
+static void *demo_wakeup_thread(void *arg)
+{
+  (void)arg;
+  sleep(1);
+  redis_wakeup(NULL);
+  return NULL;
+}
+
+//block in redis_wait until replies arrive or another thread wakes it up
+int demo_wait(char *ip , int port , int log_level)
+{
+  pthread_t tid;
+  long long start = 0;
+  int rd = -1;
+
+  rd = redis_open(ip , port , 5 , log_level);
+  if(rd < 0)
+    return -1;
+  printf("pollfd:%d\n" , redis_get_pollfd());
+  if(demo_wait_connect(rd , 5000) < 0)
+    goto _end;
+
+  //reply ends wait
+  demo_done = 0;
+  redis_exec(rd , "PING" , demo_callback , "WAIT PING" , strlen("WAIT PING"));
+  start = demo_ms();
+  while(demo_done == 0)
+    redis_wait(-1);
+  printf("reply waited %lldms\n" , demo_ms()-start);
+
+  //wakeup ends wait from another thread
+  if(pthread_create(&tid , NULL , demo_wakeup_thread , NULL) != 0)
+    goto _end;
+  start = demo_ms();
+  redis_wait(-1);
+  printf("woken up after %lldms\n" , demo_ms()-start);
+  pthread_join(tid , NULL);
+
+_end:
+  redis_close(rd);
+  return 0;
+}
+
 //return:0<all connected> -1<not all connected>
 int check_connect()
 {
@@ -91,6 +295,20 @@ int main(int argc , char **argv)
   signal(SIGTERM , sig_handle);
   signal(SIGINT , sig_handle);
 
+  /***demo paths*/
+  if(argc > 1)
+  {
+    if(strcmp(argv[1] , "io") == 0)
+      return demo_io(ip , 6379 , log_level);
+    if(strcmp(argv[1] , "uring") == 0)
+      return demo_uring(ip , 6379 , log_level);
+    if(strcmp(argv[1] , "cluster") == 0)
+      return demo_cluster(ip , 7000 , log_level);
+    if(strcmp(argv[1] , "wait") == 0)
+      return demo_wait(ip , 6379 , log_level);
+    printf("usage:%s [io|uring|cluster|wait]\n" , argv[0]);
+    return -1;
+  }
 
   ret = redis_open(ip , 6698 , 5 , log_level);
   if(ret < 0)
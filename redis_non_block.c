@@ -1,6 +1,23 @@
 #include <nbredis/redis_non_block.h>
 #include <slog/slog.h>
+#include <hiredis/sds.h>
 #include <math.h>
+#include <sys/ioctl.h>
+#include <strings.h>
+#include <ctype.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <poll.h>
+#include <signal.h>
+#include <linux/io_uring.h>
+
+#if defined(__NR_io_uring_setup) && defined(IORING_RECV_MULTISHOT)
+#define REDIS_URING 1 //io_uring backend built in. used only if kernel supports it
+#endif
 
 extern int errno;
 
@@ -9,9 +26,77 @@ extern int errno;
 
 #define CB_INFO_STAT_NULL  0
 #define CB_INFO_STAT_VALID 1
+#define CB_INFO_STAT_TIMEOUT 2 //timed out. reply is dropped
 
 #define DEFAULT_CB_PRIVATE_LEN 64 //default callback private_data len
-#define DEFAULT_ARG_COUNT 1024 //default arg max count
+#define DEFAULT_CB_RING_SIZE 64 //default callback ring size of env.must be power of 2
+#define CB_SLAB_MIN_SHIFT 7 //smallest slab private buffer(128B)
+#define CB_SLAB_CLASS 10 //slab private buffer 128B~64KB. larger one allocated directly
+#define CB_SLAB_NONE -1
+#define REDIS_CMD_HEAD_LEN 16 //reserved in front of cmd buffer for "*<argc>\r\n"
+#define REDIS_CMD_DEFAULT_SIZE 256
+#define REDIS_TPL_MAX_SLOT 32 //max placeholders of a template
+#define REDIS_TPL_MAX_OP (REDIS_TPL_MAX_SLOT*4+8)
+
+//op of compiled template
+#define TPL_OP_RAW 0 //copy pre-encoded RESP bytes
+#define TPL_OP_LEN 1 //$<len>\r\n of a token with placeholders
+#define TPL_OP_ARG 2 //value of a placeholder
+//placeholder type
+#define TPL_ARG_S 0
+#define TPL_ARG_B 1
+#define TPL_ARG_D 2
+#define TPL_ARG_LLD 3
+#define REDIS_ARENA_CHUNK (64*1024) //reply arena chunk size
+#define REDIS_EPOLL_WAIT_MS 1 //epoll_wait timeout of each tick(ms)
+#define REDIS_READ_MIN (16*1024) //first read size of a readable env
+#define REDIS_READ_MAX (8*1024*1024) //max read size when backlog is large
+#define REDIS_SHED_PERCENT 75 //low priority cmds shed at this percent of limits
+//timing wheel. level 0:256 slots of 1ms, upper levels:64 slots each
+#define TW_BITS0 8
+#define TW_BITS 6
+#define TW_LEVEL 4
+#define TW_SIZE0 (1<<TW_BITS0)
+#define TW_SIZE (1<<TW_BITS)
+#define TW_SLOTS (TW_SIZE0 + (TW_LEVEL-1)*TW_SIZE)
+#define TW_MAX_DELAY ((1LL<<(TW_BITS0+(TW_LEVEL-1)*TW_BITS))-1)
+#define TW_NODE_INIT 256
+#define REDIS_RECYCLE_RETRY_MS 1000 //retry interval of a recycled connection failed to reconnect
+#define REDIS_CLUSTER_SLOTS 16384 //hash slots of redis cluster. power of 2
+#define REDIS_CLUSTER_REDIRECT 5 //max MOVED/ASK followed by one cmd
+#define REDIS_CLUSTER_RELOAD_MS 1000 //min interval of reloading slot map
+#define REDIS_CLUSTER_NODE_INIT 8
+#define REDIS_SHARD_VNODES 160 //default virtual nodes of a shard member
+
+#define REDIS_REPL_SAMPLES 256 //read latency samples of replica group. power of 2
+#define REDIS_REPL_P95_EVERY 64 //p95 recomputed after this many samples
+#define REDIS_REPL_MAX_REPLICAS 64 //max replicas of a group
+#define REDIS_RTT_INIT_US 1000 //rtt of a member not measured yet
+
+#define GATHER_MGET 0 //values in key order
+#define GATHER_MSET 1 //OK
+#define GATHER_SUM 2 //sum of integer replies
+
+#define SUB_CMD_SUBSCRIBE 0
+#define SUB_CMD_UNSUBSCRIBE 1
+#define SUB_CMD_PSUBSCRIBE 2
+#define SUB_CMD_PUNSUBSCRIBE 3
+#define SUB_TABLE_INIT 64 //buckets of handler table. power of 2
+
+#define IO_RING_DEFAULT 4096 //slots of submission and completion ring
+#define IO_EFD_EVENT 0xffffffff //epoll data of wakeup eventfd. out of rd range
+#define REDIS_WAKE_EVENT 0xfffffffe //epoll data of redis_wakeup eventfd
+#define REDIS_TIMER_EVENT 0xfffffffd //epoll data of deadline timerfd of exported pollfd
+
+#define URING_SQ_ENTRIES 256 //more sqes of a tick are submitted when full
+#define URING_CQ_ENTRIES 4096
+#define URING_BUF_COUNT 256 //provided recv buffers. power of 2
+#define URING_BUF_SIZE (16*1024)
+#define URING_BGID 0 //group of provided buffers
+#define URING_UD_SEND 0 //user_data:address of URINGSEND
+#define URING_UD_RECV 1 //user_data:seq<<32 | rd<<3 | tag
+#define URING_UD_POLL 2 //poll of epfd
+#define URING_UD_MASK 7
 
 #define REDIS_LOG "redis_non_block.log"
 #define REDIS_LOG_SIZE (10*1024*1024)
@@ -19,17 +104,104 @@ extern int errno;
 #define REDIS_LOG_DEGREE SLD_SEC
 #define REDIS_LOG_FORMAT SLF_PREFIX
 
+//reply laid out in arena of env. built by reader directly
+struct _reply_node
+{
+  int type; //REDIS_REPLY_XX
+  int len; //length of str or count of elements
+  long long integer;
+  double dval;
+  char *str; //string,status,error,double text. decimal of integer. NULL if nil or aggregate
+  char **argv; //aggregate:str of each element
+  int *arglen; //aggregate:len of each element
+  struct _reply_node **element; //aggregate:each element
+};
+typedef struct _reply_node REPLYNODE;
+
+typedef struct _arena_chunk
+{
+  struct _arena_chunk *next;
+  size_t size;
+  size_t used;
+  char data[];
+}ARENACHUNK;
+
+//per connection reply arena. reset after each callback
+typedef struct
+{
+  ARENACHUNK *head;
+  ARENACHUNK *curr;
+  size_t used; //bytes allocated since last reset
+}REPLYARENA;
+
 struct _cb_info
 {
   char stat; //0:NULL 1:valid
+  char slab_class; //slab class of private buffer if private_len>DEFAULT_CB_PRIVATE_LEN. CB_SLAB_NONE:malloc
   REDIS_CALLBACK func;
+  REDIS_BATCH_CALLBACK batch_func; //if batch
+  REDIS_REPLY_CALLBACK reply_func; //if typed
   char private_data[DEFAULT_CB_PRIVATE_LEN]; //if private data<=DEFAULT_CB_PRIVATE_LEN
   char *private; //pointer private_data
   int private_len; //private_data len
-  struct _cb_info *next; //next
+  int batch_n; //>0:cmds of batch sharing this slot
+  int batch_got; //replies of batch received
+  REPLYNODE **batch_reply; //replies of batch kept in arena until last one arrives
+  char queued; //cmd in overflow queue
+  int qlen; //bytes of cmd in overflow queue
+  int timer; //node of timing wheel. -1:no timeout
+  char recycle; //reconnect when timed out
+  char *cmd; //copy of cmd for replay or cluster redirect
+  int cmd_len;
+  char cmd_class; //slab class of cmd copy. CB_SLAB_NONE:malloc
+  char replay; //cmd resent after reconnect
+  char redirect; //MOVED/ASK followed
+  long long sent_us; //read of replica group. latency sampled on reply
 };
 typedef struct _cb_info CBINFO;
 
+//send in flight of io_uring backend. kept until its completion even if env is disconnected
+typedef struct
+{
+  int rd; //-1:env disconnected. freed by completion
+  char busy; //submitted and not completed
+  sds buf; //swapped with obuf of env when sent
+  size_t off; //bytes sent
+}URINGSEND;
+
+//recv completion taken out of cq and put aside by budget. its buffer is held till handled
+typedef struct
+{
+  unsigned long long ud;
+  int res;
+  unsigned int flags;
+}URINGCQE;
+
+//handler of a channel or pattern
+struct _sub_handler
+{
+  struct _sub_handler *next; //in bucket
+  unsigned int hash;
+  char pattern; //1:pattern 0:channel
+  REDIS_SUB_CALLBACK func;
+  char *private; //stored after name
+  int private_len;
+  int name_len;
+  char name[];
+};
+typedef struct _sub_handler SUBHANDLER;
+
+//handlers of subscriber connection
+typedef struct
+{
+  unsigned int size; //buckets. power of 2
+  int count;
+  SUBHANDLER **buckets;
+  sds pend; //args of (un)subscribe cmd not sent yet
+  int pend_kind; //SUB_CMD_XX of pend
+  int pend_cnt;
+}SUBTABLE;
+
 typedef struct
 {
   char stat;
@@ -37,45 +209,530 @@ typedef struct
   //redisContext *conn;
   //redisContext *run;
   redisContext *hiredis_cxt;
-  long connect_end_ts; //seconds
+  long long connect_end_ms; //connect deadline. monotonic ms
   char ip[64];
   int port;
-  int timeout;
+  int timeout_ms; //connect timeout(ms)
   int cb_count;
-  CBINFO *cb_head;
-  CBINFO *cb_tail;
+  CBINFO *cb_ring; //callback ring. slot of seq is cb_ring[seq & (cb_size-1)]
+  unsigned int cb_size; //power of 2
+  unsigned int cb_head; //seq of head
+  unsigned int cb_tail; //seq of tail(next push)
+  char *cb_slab[CB_SLAB_CLASS]; //free private buffers of each class
   int id;
+  unsigned int gen; //generation of rd. differs after reopen
+  REPLYARENA *arena; //replies of reader. heap allocated so that reader privdata is stable
+  unsigned int events; //epoll events registered. 0:not in epoll
+  char wqueued; //in pending-write queue of this tick
+  char flush_policy; //REDIS_FLUSH_POLICY
+  int flush_bytes; //threshold of REDIS_FLUSH_BYTES
+  REDIS_LIMIT limit; //backpressure limits
+  int exec_flags; //REDIS_EXEC_XX of following execs
+  int exec_timeout; //ms. timeout of following execs
+  char timeout_recycle; //recycle flag of following execs
+  //managed reconnect
+  int reconn_min; //ms. 0:not managed
+  int reconn_max; //ms
+  int reconn_attempt;
+  long long reconn_at_ms; //next reconnect. 0:not scheduled
+  int recycle_timer; //timer id+1 of recycle retry. 0:none
+  char hold; //pending cmds held after disconnect. sorted out in tick
+  int pool; //pd+1 if member of pool. 0:not pooled
+  int cluster; //cd+1 if node of cluster. 0:not in cluster
+  int repl; //gd+1 if member of replica group
+  int rtt_us; //moving average of read latency in replica group
+  SUBTABLE *sub; //subscriber connection if not NULL. replies are messages
+  unsigned int urecv; //seq of multishot recv armed on io_uring. 0:none
+  URINGSEND *usend; //io_uring backend. NULL:epoll watches fd
+  char backlog; //replies left in reader by budget of tick
+  size_t obuf_mark; //obuf length before current append
+  //overflow queue. bytes of queued cmds stay at tail of obuf and are not written
+  unsigned int ov_seq; //seq of first queued cmd
+  int ov_cnt;
+  size_t ov_bytes;
 }
 REDISENV;
+
+struct _redis_cmd
+{
+  char *buf; //REDIS_CMD_HEAD_LEN reserved + encoded args
+  int len; //length of encoded args
+  int size; //size of buf
+  int argc;
+};
+typedef struct
+{
+  char op; //TPL_OP_XX
+  char type; //TPL_ARG_XX if TPL_OP_ARG
+  int off; //TPL_OP_RAW:offset in raw. TPL_OP_LEN:first slot of token
+  int len; //TPL_OP_RAW:bytes. TPL_OP_LEN:static bytes of token
+  int nslot; //TPL_OP_LEN:slots of token
+}TPLOP;
+
+struct _redis_tpl
+{
+  char *raw; //pre-encoded static bytes
+  int raw_len;
+  int nop;
+  int nslot;
+  char slot_type[REDIS_TPL_MAX_SLOT];
+  TPLOP ops[REDIS_TPL_MAX_OP];
+};
 //static REDISENV redis_env = {1 , NULL , NULL , 0 , {0}  , 0};
 
+//connections to one endpoint
+typedef struct
+{
+  int size; //0:empty
+  int *rds;
+  unsigned int rr; //start of scan so that ties are spread
+}REDISPOOL;
+
+//redis cluster. cmds are routed by slot table
+typedef struct
+{
+  int *slots; //rd of each hash slot. -1:unknown. NULL:empty cluster
+  int timeout_ms; //connect timeout of nodes(ms)
+  REDIS_LOG_LEVEL log_level;
+  int node_cnt;
+  int node_size;
+  int *nodes; //rd of nodes
+  char refresh; //slot map should be reloaded
+  long long load_ms; //last CLUSTER SLOTS sent
+}REDISCLUSTER;
+
+//point of ketama ring
+typedef struct
+{
+  unsigned int hash;
+  int member;
+}SHARDPOINT;
+
+//consistent-hash shard group over opened rds
+typedef struct
+{
+  int count; //0:empty
+  int *rds;
+  char *down; //FAIL or CLOSED when ring built
+  char rebalance;
+  int point_cnt;
+  SHARDPOINT *points; //all points sorted by hash
+  int live_cnt;
+  SHARDPOINT *live; //points of members up. used if rebalance
+}REDISSHARD;
+
+//multi-key cmd scattered over connections
+struct _gather
+{
+  struct _gather *next; //in done list
+  REDIS_CALLBACK func;
+  char *private; //copy of private
+  int private_len;
+  int op; //GATHER_XX
+  int nkeys;
+  int pending; //sub cmds not finished
+  int result; //first failure
+  char *err; //error info of first failure
+  int err_len;
+  long long sum;
+  int *pos; //key index of sub cmds in order
+  int *off; //MGET:offset of value in data. -1:nil
+  int *len; //MGET:length of value
+  char *data; //MGET:values copied out of arena
+  int data_len;
+  int data_size;
+};
+typedef struct _gather GATHER;
+
+//private of a sub cmd
+typedef struct
+{
+  GATHER *pgather;
+  int start; //first key in pos
+  int n;
+}GATHERSUB;
+
+//master and replicas
+typedef struct
+{
+  int master; //-1:empty
+  int count;
+  int *replicas;
+  char hedge;
+  int hedge_ms; //p95 of reads. 0:not enough samples
+  unsigned int sample_cnt;
+  int *samples; //latency of reads(us)
+}REDISREPL;
+
+//read raced on two nodes. first reply wins
+struct _hedge
+{
+  struct _hedge *next; //in done list
+  REDIS_CALLBACK func;
+  int gd;
+  int refs; //attempts pending + holder
+  char done; //callback called
+  int timer; //hedge timer. -1:none
+  char *cmd; //formatted cmd
+  int cmd_len;
+  char sent; //attempts sent
+  int rd[2];
+  unsigned int gen[2];
+  unsigned int seq[2];
+  char *private;
+  int private_len;
+};
+typedef struct _hedge HEDGE;
+
+//private of an attempt
+typedef struct
+{
+  HEDGE *phedge;
+  int k; //index of attempt
+}HEDGESUB;
+
+//routed key of a scatter
+typedef struct
+{
+  int group; //rd of shard. slot of cluster
+  int idx;
+}GATHERKEY;
 
+//timer of a pending cmd or retry of recycled connection
+typedef struct
+{
+  int next;
+  int prev; //-1:first of slot
+  int slot; //slot index in wheel. -1:free
+  int rd;
+  unsigned int gen;
+  unsigned int seq; //seq of cmd in callback ring
+  long long expire_ms;
+  HEDGE *hedge; //read to be hedged. NULL:timer of cmd
+  char reconnect; //retry reconnecting recycled env
+}TIMERNODE;
+
+//hierarchical timing wheel of cmd timeouts
+typedef struct
+{
+  long long now_ms; //time wheel has advanced to
+  int active; //timers in wheel
+  int node_len;
+  int free_node;
+  TIMERNODE *nodes;
+  int slots[TW_SLOTS]; //first node of each slot. -1:empty
+  int tails[TW_SLOTS]; //last node of each slot. expired in adding order
+}TIMERWHEEL;
+
+//io_uring of a context. connected fds are read and written by it. connecting fds and epfd stay in epoll
 typedef struct
+{
+  int fd;
+  unsigned int *sq_head;
+  unsigned int *sq_tail;
+  unsigned int sq_mask;
+  unsigned int *sq_array;
+  struct io_uring_sqe *sqes;
+  unsigned int pending; //sqes not submitted
+  unsigned int *cq_head;
+  unsigned int *cq_tail;
+  unsigned int *cq_flags;
+  unsigned int cq_mask;
+  struct io_uring_cqe *cqes;
+  void *sq_ptr;
+  size_t sq_len;
+  void *cq_ptr;
+  size_t cq_len;
+  size_t sqe_len;
+  struct io_uring_buf_ring *br; //provided buffers of multishot recv
+  char *bufs;
+  unsigned short br_tail;
+  unsigned int seq; //seq of recv armed
+  char batch; //sqes submitted by enter of tick instead of at once
+  char poll_armed;
+  char poll_ready; //epfd readable
+  int orphans; //sends of disconnected envs in flight
+  URINGCQE *stash; //recvs of backlog envs. handled before cq in next reap
+  int stash_len;
+  int stash_cap;
+}REDISURING;
+
+struct _redis_ctx
 {
   int valid_count;
   int list_len;
   REDISENV *env_list;
   int slog_d;
-}REDIS_GLOBALSPACE;
-REDIS_GLOBALSPACE redis_global_space = {0 , -1 , NULL , -1};
+  int epfd; //epoll fd of all connections
+  unsigned int gen_seq; //generation seq of opened rd
+  int wqueue_len;
+  int wqueue[REDIS_MAX_OPEN_NUM]; //rd with output pending in this tick
+  struct epoll_event ev_list[REDIS_MAX_OPEN_NUM];
+  TIMERWHEEL wheel;
+  unsigned int rand_seed; //jitter of reconnect backoff
+  int pool_len;
+  int pool_count;
+  REDISPOOL *pool_list;
+  int cluster_len;
+  int cluster_count;
+  REDISCLUSTER *cluster_list;
+  int shard_len;
+  int shard_count;
+  REDISSHARD *shard_list;
+  GATHER *gather_done; //gathers finished by dropped sub cmds. called back in tick
+  int repl_len;
+  int repl_count;
+  REDISREPL *repl_list;
+  HEDGE *hedge_done; //hedges whose attempts were all dropped. called back in tick
+  REDISURING *uring; //io_uring backend. NULL:epoll
+  //work budget of current tick
+  int budget_max; //replies. 0:no limit
+  int budget_used;
+  long long budget_end_us; //deadline. 0:no limit
+  char budget_out; //used up
+  int backlog_cnt; //envs with work left by budget
+  int resume_rd; //env served first in next tick
+  int ctx_id; //0:default context. names log file of others
+  char use_uring; //by redis_set_backend before first rd is opened. epoll by default
+  //blocking wait
+  int wake_fd; //eventfd of redis_wakeup. valid with epfd
+  char waiting; //in redis_wait
+  int wait_ms; //timeout of redis_wait. -1:until event
+  char pollfd_on; //epfd exported by redis_get_pollfd
+  int timer_fd; //nearest deadline of exported epfd. valid with pollfd_on
+  long long timer_at; //deadline timer_fd armed to. -1:none
+};
+typedef struct _redis_ctx REDIS_GLOBALSPACE;
+
+//single producer single consumer ring. indexes on own lines
+typedef struct
+{
+  unsigned int size; //power of 2
+  void **slots;
+  char pad0[64];
+  unsigned int head; //written by consumer
+  char pad1[64];
+  unsigned int tail; //written by producer
+  char pad2[64];
+}IORING;
+
+//cmd submitted by app thread
+typedef struct
+{
+  struct _redis_io *io;
+  int rd;
+  REDIS_CALLBACK func;
+  char *cmd; //formatted
+  int cmd_len;
+  char *private; //stored after req
+  int private_len;
+}IOREQ;
+
+//reply copied out of arena by io thread
+struct _io_comp
+{
+  struct _io_comp *next; //in backlog
+  IOREQ *req;
+  REDIS_CB_RESULT result;
+  int argc;
+  char **argv; //stored after comp
+  int *arglen;
+};
+typedef struct _io_comp IOCOMP;
+
+struct _redis_io
+{
+  REDIS_GLOBALSPACE *ctx; //owned by io thread
+  pthread_t tid;
+  int efd; //wakes io thread in epoll_wait
+  int stop;
+  int sleeping; //io thread may be in epoll_wait
+  IORING sq; //app -> io
+  IORING cq; //io -> app
+  IOCOMP *backlog; //completions waiting for room of cq. io thread only
+  IOCOMP *backlog_tail;
+};
+typedef struct _redis_io REDISIO;
+
+REDIS_GLOBALSPACE redis_global_space = {.valid_count = 0 , .list_len = -1 , .env_list = NULL , .slog_d = -1 , 
+  .epfd = -1}; //default context. other members zero
+static __thread REDIS_GLOBALSPACE *redis_space = &redis_global_space; //context of calling thread
+static int redis_ctx_seq = 0; //id of last context opened
 
 /************INNER FUNC DEC*****************/
-static int _redis_open(char *ip , int port , REDIS_LOG_LEVEL log_level);
-static int _redis_connect(int rd , char *ip , int port , int timeout);
-static int _check_connect(REDISENV *penv);
+static int _redis_open(char *ip , int port , REDIS_LOG_LEVEL log_level , int pooled);
+static int _redis_connect(int rd , char *ip , int port , int timeout_ms);
+static int _check_connect(REDISENV *penv , unsigned int events);
 static int _redis_reconnect();
-static int _redis_tick(REDISENV *penv);
-static int _redis_tick_multi(REDISENV *env_list[] , int env_count);
-static int _fd_readable(int fd , int timeout);
-static int _fd_writable(int fd , int timeout);
-static int _handle_reply(REDISENV *pstEnv , redisReply *pstReply);
-static int _tpush_cbi(REDISENV *pstEnv , CBINFO *pstCBInfo);
-static CBINFO * _hpop_cbi(REDISENV *pstEnv);
+static int _redis_tick_epoll();
+static int _redis_tick_uring();
+static void _flush_wqueue();
+static void _epoll_events(int ready);
+static int _wait_ms();
+static long long _next_deadline(long long curr_ms);
+static long long _timer_next();
+static int _wake(REDIS_GLOBALSPACE *pspace);
+static void _wake_drain();
+static void _pollfd_arm();
+static int _budget_out();
+static void _budget_waited(long long start_us);
+static void _env_backlog(REDISENV *penv);
+static void _env_resume();
+static int _env_watch(REDISENV *penv , unsigned int events);
+static int _env_unwatch(REDISENV *penv);
+static int _wqueue_push(REDISENV *penv);
+static int _env_appended(REDISENV *penv);
+static int _env_admit(REDISENV *penv);
+static int _ov_release(REDISENV *penv);
+static size_t _env_ibuf(REDISENV *penv);
+static int _timer_add(REDISENV *penv , unsigned int seq , long long expire_ms);
+static void _timer_del(int id);
+static void _timer_link(int id);
+static void _timer_advance(long long curr_ms);
+static void _timer_expire(int id);
+static void _env_recycle(REDISENV *penv);
+static void _fire_cb(CBINFO *pcb , REDIS_CB_RESULT result);
+static int _fail_pending(REDISENV *penv , REDIS_CB_RESULT result);
+static int _env_hold(REDISENV *penv);
+static int _env_replay(REDISENV *penv);
+static int _env_backoff(REDISENV *penv , long long curr_ms);
+static int _env_push_cmd(REDISENV *penv , char *cmd , int len , CBINFO *pcb);
+static REDISCLUSTER *_cluster_get(int cd);
+static REDISENV *_cluster_env(int cd , int rd);
+static int _cluster_any(REDISCLUSTER *pcluster , int cd);
+static int _cluster_slot(const char *key , int keylen);
+static int _cluster_keypos(const char *name , int len);
+static const char *_cmd_token(const char *cmd , int idx , int *len);
+static int _cluster_node(int cd , char *ip , int port);
+static int _cluster_redirect(REDISENV *penv , CBINFO *pcb , REPLYNODE *preply);
+static int _cluster_slots_cb(char *private , int private_len , REDIS_CB_RESULT result , const redis_reply_t *reply);
+static void _cluster_tick(long long curr_ms);
+static REDISSHARD *_shard_get(int sd);
+static unsigned int _shard_hash(const char *key , int len);
+static int _shard_point_cmp(const void *a , const void *b);
+static int _shard_down(int rd);
+static int _shard_build(REDISSHARD *pshard);
+static void _shard_tick();
+static int _scatter(int id , int cluster , int argc , const char *argv[] , const size_t argvlen[] , 
+  REDIS_CALLBACK callback , char *private , int private_len);
+static int _gather_key_cmp(const void *a , const void *b);
+static int _gather_cb(char *private , int private_len , REDIS_CB_RESULT result , int argc , char *argv[] , int arglen[]);
+static void _gather_put(GATHER *pgather , GATHERSUB *psub , REDIS_CB_RESULT result , int argc , char *argv[] , 
+  int arglen[]);
+static void _gather_drop(CBINFO *pcb);
+static void _gather_finish(GATHER *pgather);
+static void _gather_flush();
+static REDISREPL *_repl_get(int gd);
+static int _repl_name_cmp(const void *a , const void *b);
+static int _repl_readonly(const char *name , int len);
+static REDISENV *_repl_env(int rd);
+static int _repl_sample_cmp(const void *a , const void *b);
+static int _repl_pick(REDISREPL *prepl , int exclude);
+static void _repl_sample(REDISENV *penv , long long us);
+static int _repl_send(int gd , char *cmd , int len , REDIS_CALLBACK callback , char *private , 
+  int private_len);
+static int _exec_raw(int rd , char *cmd , int len , REDIS_CALLBACK callback , char *private , int private_len , 
+  long long sent_us , unsigned int *pseq);
+static int _hedge_cb(char *private , int private_len , REDIS_CB_RESULT result , int argc , char *argv[] , int arglen[]);
+static void _hedge_expire(HEDGE *phedge);
+static void _hedge_drop(CBINFO *pcb);
+static void _hedge_ignore(HEDGE *phedge , int k);
+static void _hedge_release(HEDGE *phedge);
+static void _hedge_free(HEDGE *phedge);
+static void _hedge_flush();
+static unsigned int _rand_next();
+static SUBTABLE *_sub_table(REDISENV *penv);
+static SUBHANDLER **_sub_link(SUBTABLE *psub , int pattern , const char *name , int len , unsigned int hash);
+static void _sub_grow(SUBTABLE *psub);
+static int _sub_add(int rd , int pattern , int count , const char *names[] , REDIS_SUB_CALLBACK callback , 
+  char *private , int private_len);
+static int _sub_del(int rd , int pattern , int count , const char *names[]);
+static int _sub_queue(REDISENV *penv , int kind , const char *name , int len);
+static int _sub_flush(REDISENV *penv);
+static void _sub_resume(REDISENV *penv);
+static int _sub_dispatch(REDISENV *penv , REPLYNODE *preply);
+static void _sub_free(REDISENV *penv);
+static int _ring_init(IORING *ring , unsigned int size);
+static int _ring_push(IORING *ring , void *p);
+static void *_ring_pop(IORING *ring);
+static int _io_send(REDISIO *io , int rd , char *cmd , int len , REDIS_CALLBACK callback , char *private , 
+  int private_len);
+static void *_io_main(void *arg);
+static void _io_submit(REDISIO *io);
+static int _io_cb(char *private , int private_len , REDIS_CB_RESULT result , int argc , char *argv[] , int arglen[]);
+static void _io_drop(CBINFO *pcb);
+static IOCOMP *_io_comp(IOREQ *req , REDIS_CB_RESULT result , int argc , char *argv[] , int arglen[]);
+static void _io_complete(REDISIO *io , IOCOMP *pcomp);
+static void _io_finish(IOCOMP *pcomp);
+static void _io_free(REDISIO *io);
+static int _efd_write(int fd);
+static void _efd_read(int fd);
+static long long _now_us();
+static int _flush_env(REDISENV *penv);
+static int _read_env(REDISENV *penv);
+static int _read_reader(REDISENV *penv , int size);
+static char *_reader_room(REDISENV *penv , int size);
+static int _parse_env(REDISENV *penv);
+static size_t _env_obuf(REDISENV *penv);
+static int _uring_init(REDIS_GLOBALSPACE *pspace);
+static void _uring_free(REDIS_GLOBALSPACE *pspace);
+static int _uring_notify(REDIS_GLOBALSPACE *pspace);
+static int _uring_attach(REDISENV *penv);
+static void _uring_detach(REDISENV *penv);
+static int _uring_send(REDISENV *penv);
+#ifdef REDIS_URING
+static struct io_uring_sqe *_uring_sqe(REDISURING *puring);
+static int _uring_enter(REDISURING *puring , int wait_ms);
+static int _uring_recv(REDISENV *penv);
+static void _uring_reap();
+static REDISENV *_uring_recv_env(unsigned long long ud);
+static int _uring_stash(REDISURING *puring , URINGCQE *pcqe , int pos);
+static int _uring_probe_recv(REDISURING *puring);
+static void _uring_recv_done(unsigned long long ud , int res , unsigned int flags);
+static void _uring_send_done(URINGSEND *psend , int res);
+static void _uring_buf_put(REDISURING *puring , unsigned short bid);
+#endif
+static long long _now_ms();
+static int _append_argv(REDISENV *penv , int argc , const char **argv , const size_t *argvlen);
+static int _ll2str(char *buf , long long value);
+static int _cmd_reserve(redis_cmd_t *cmd , int need);
+static int _tpl_raw(redis_tpl_t *tpl , int *raw_size , const char *data , int len);
+static int _handle_reply(REDISENV *pstEnv , REPLYNODE *pstReply);
+static int _env_reader(REDISENV *penv);
+static void *_arena_alloc(REPLYARENA *arena , size_t size);
+static void _arena_reset(REPLYARENA *arena);
+static void _arena_free(REPLYARENA *arena);
+static void *_reply_node(const redisReadTask *task , int type , int len);
+static void *_reply_create_string(const redisReadTask *task , char *str , size_t len);
+static void *_reply_create_array(const redisReadTask *task , size_t elements);
+static void *_reply_create_integer(const redisReadTask *task , long long value);
+static void *_reply_create_double(const redisReadTask *task , double value , char *str , size_t len);
+static void *_reply_create_nil(const redisReadTask *task);
+static void *_reply_create_bool(const redisReadTask *task , int bval);
+static void _reply_free_object(void *reply);
+static CBINFO *_tpush_cbi(REDISENV *pstEnv);
+static int _tcancel_cbi(REDISENV *pstEnv);
+static int _hpop_cbi(REDISENV *pstEnv , CBINFO *pstCBInfo);
+static CBINFO *_save_cb(REDISENV *pstEnv , REDIS_CALLBACK callback , REDIS_REPLY_CALLBACK reply_func , 
+  char *private , int private_len);
+static int _exec_str(int rd , char *cmd , REDIS_CALLBACK callback , REDIS_REPLY_CALLBACK reply_func , 
+  char *private , int private_len);
+static int _exec_argv(int rd , int argc , const char *argv[] , const size_t argvlen[] , REDIS_CALLBACK callback , 
+  REDIS_REPLY_CALLBACK reply_func , char *private , int private_len);
+static int _exec_built(int rd , redis_cmd_t *cmd , REDIS_CALLBACK callback , REDIS_REPLY_CALLBACK reply_func , 
+  char *private , int private_len);
+static int _dispatch_batch(REDISENV *pstEnv , CBINFO *pstCBInfo);
+static char *_cmd_head(redis_cmd_t *cmd , int *len);
 static REDISENV *_rd2env(int rd , const char *caller);
 static int _reset_env(REDISENV *penv);
 static void _print_space();
 static int _redis_disconnect(int rd);
-static void _free_cb(CBINFO *pcb);
+static void _free_cb(REDISENV *penv , CBINFO *pcb);
+static char *_slab_get(REDISENV *penv , int len , char *pcls);
+static void _slab_put(REDISENV *penv , char *buf , char cls);
+static void _drain_cb(REDISENV *penv);
+static void _free_env_mem(REDISENV *penv);
+static REDISENV *_env_alive(int rd , unsigned int gen);
 static int _put_fd_env(int fd , REDISENV *penv);
 /************INNER FUNC DEC*****************/
 
@@ -85,7 +742,7 @@ static int _put_fd_env(int fd , REDISENV *penv);
 int redis_close(int rd)
 {
   REDISENV *penv = NULL;
-  REDIS_GLOBALSPACE *pspace = &redis_global_space;
+  REDIS_GLOBALSPACE *pspace = redis_space;
   int sld = -1;
   int real_len = 0;
 
@@ -117,6 +774,7 @@ int redis_close(int rd)
   
   _redis_disconnect(rd);
   _reset_env(penv);
+  _free_env_mem(penv);
   memset(penv , 0 , sizeof(REDISENV));
   pspace->valid_count--;
   slog_log(sld, SL_INFO, "<%s> success! rd:%d",__FUNCTION__ , rd);
@@ -134,6 +792,13 @@ int redis_close(int rd)
     free(pspace->env_list);
     pspace->list_len = -1;
     pspace->env_list = NULL;
+
+    //all timers released with their cmds. wheel starts over on next open
+    free(pspace->wheel.nodes);
+    memset(&pspace->wheel , 0 , sizeof(TIMERWHEEL));
+    pspace->wheel.free_node = -1;
+    memset(pspace->wheel.slots , -1 , sizeof(pspace->wheel.slots));
+    memset(pspace->wheel.tails , -1 , sizeof(pspace->wheel.tails));
   }
   
   return 0;
@@ -141,7 +806,12 @@ int redis_close(int rd)
 
 int redis_open(char *ip , int port , int timeout , REDIS_LOG_LEVEL log_level)
 {
-  REDIS_GLOBALSPACE *pspace = &redis_global_space;
+  return redis_open_ms(ip , port , timeout*1000 , log_level);
+}
+
+int redis_open_ms(char *ip , int port , int timeout_ms , REDIS_LOG_LEVEL log_level)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
   int rd = -1;
   int ret = -1;
   //check count
@@ -153,29 +823,265 @@ int redis_open(char *ip , int port , int timeout , REDIS_LOG_LEVEL log_level)
   }
   
   //open rd
-  rd = _redis_open(ip , port , log_level);
+  rd = _redis_open(ip , port , log_level , 0);
   if(rd < 0)
   {
-    slog_log(pspace->slog_d , SL_ERR , "<%s> failed for open %s:%d:%d!", __FUNCTION__ , ip , port , timeout);
+    slog_log(pspace->slog_d , SL_ERR , "<%s> failed for open %s:%d:%dms!", __FUNCTION__ , ip , port , timeout_ms);
     return -1;
   }
 
   //connect
-  ret = _redis_connect(rd, ip, port, timeout);
+  ret = _redis_connect(rd, ip, port, timeout_ms);
   if(ret < 0)
   {
-    slog_log(pspace->slog_d , SL_ERR , "<%s> failed for connect %s:%d:%d!", __FUNCTION__ , ip , port , timeout);
+    slog_log(pspace->slog_d , SL_ERR , "<%s> failed for connect %s:%d:%dms!", __FUNCTION__ , ip , port , timeout_ms);
+    redis_close(rd);
+    return -1;
+  }
+
+  slog_log(pspace->slog_d , SL_INFO, "<%s> %s:%d:%dms success!", __FUNCTION__ , ip , port , timeout_ms);
+  return rd;
+}
+
+int redis_sub_open(char *ip , int port , int timeout , REDIS_LOG_LEVEL log_level)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  int rd = -1;
+
+  if(pspace->valid_count >= REDIS_MAX_OPEN_NUM)
+  {
+    slog_log(pspace->slog_d , SL_ERR, "<%s> failed! opened count max! opened:%d max:%d", __FUNCTION__ , 
+      pspace->valid_count , REDIS_MAX_OPEN_NUM);
+    return -1;
+  }
+
+  //may share endpoint with cmd connection
+  rd = _redis_open(ip , port , log_level , 1);
+  if(rd < 0)
+    return -1;
+  if(!_sub_table(&pspace->env_list[rd]) || _redis_connect(rd , ip , port , timeout*1000)<0)
+  {
+    slog_log(pspace->slog_d , SL_ERR , "<%s> failed for open %s:%d:%d!", __FUNCTION__ , ip , port , timeout);
     redis_close(rd);
     return -1;
   }
 
-  slog_log(pspace->slog_d , SL_INFO, "<%s> %s:%d:%d success!", __FUNCTION__ , ip , port , timeout);
+  slog_log(pspace->slog_d , SL_INFO, "<%s> %s:%d:%d success! rd:%d", __FUNCTION__ , ip , port , timeout , rd);
   return rd;
 }
 
+redis_ctx_t *redis_ctx_open()
+{
+  REDIS_GLOBALSPACE *pctx = NULL;
+
+  //own allocation so that loops of threads share no line
+  pctx = (REDIS_GLOBALSPACE *)calloc(1 , sizeof(REDIS_GLOBALSPACE));
+  if(!pctx)
+    return NULL;
+  pctx->list_len = -1;
+  pctx->slog_d = -1;
+  pctx->epfd = -1;
+  pctx->ctx_id = __atomic_add_fetch(&redis_ctx_seq , 1 , __ATOMIC_RELAXED);
+  return pctx;
+}
+
+redis_ctx_t *redis_ctx_use(redis_ctx_t *ctx)
+{
+  REDIS_GLOBALSPACE *prev = redis_space;
+
+  redis_space = ctx? ctx : &redis_global_space;
+  return prev;
+}
+
+int redis_ctx_close(redis_ctx_t *ctx)
+{
+  REDIS_GLOBALSPACE *prev = redis_space;
+  REDIS_GLOBALSPACE *pspace = ctx;
+  int i = 0;
+
+  if(!ctx || ctx==&redis_global_space)
+    return -1;
+  redis_space = pspace;
+
+  //groups first. pools and clusters close their members
+  for(i=pspace->pool_len-1; i>=0 && pspace->pool_list; i--)
+    redis_pool_close(i);
+  for(i=pspace->cluster_len-1; i>=0 && pspace->cluster_list; i--)
+    redis_cluster_close(i);
+  for(i=pspace->shard_len-1; i>=0 && pspace->shard_list; i--)
+    redis_shard_close(i);
+  for(i=pspace->repl_len-1; i>=0 && pspace->repl_list; i--)
+    redis_repl_close(i);
+  for(i=0; pspace->env_list && pspace->list_len>=0 && i<(int)pow(2 , pspace->list_len); i++)
+  {
+    if(pspace->env_list[i].stat != REDIS_ENV_STAT_EMPTY)
+      redis_close(i);
+  }
+
+  //cmds dropped by close are failed
+  if(pspace->gather_done)
+    _gather_flush();
+  if(pspace->hedge_done)
+    _hedge_flush();
+
+  if(pspace->uring)
+    _uring_free(pspace);
+  if(pspace->pollfd_on)
+    close(pspace->timer_fd);
+  if(pspace->epfd >= 0)
+  {
+    close(pspace->wake_fd);
+    close(pspace->epfd);
+  }
+  if(pspace->slog_d >= 0)
+    slog_close(pspace->slog_d);
+  free(pspace->wheel.nodes);
+  free(pspace);
+  redis_space = (prev==pspace)? &redis_global_space : prev;
+  return 0;
+}
+
+int redis_set_backend(REDIS_BACKEND backend)
+{
+  if(backend!=REDIS_BACKEND_EPOLL && backend!=REDIS_BACKEND_URING)
+    return -1;
+  redis_space->use_uring = (backend==REDIS_BACKEND_URING)? 1 : 0;
+  return 0;
+}
+
+REDIS_BACKEND redis_get_backend()
+{
+  return redis_space->uring? REDIS_BACKEND_URING : REDIS_BACKEND_EPOLL;
+}
+
+redis_io_t *redis_io_start(redis_ctx_t *ctx , int ring_size)
+{
+  REDISIO *io = NULL;
+  struct epoll_event ev;
+  unsigned int size = 1;
+
+  //rds opened on ctx before. epoll created by first open
+  if(!ctx || ctx==&redis_global_space || ctx->epfd<0)
+    return NULL;
+  if(ring_size <= 0)
+    ring_size = IO_RING_DEFAULT;
+  while(size < (unsigned int)ring_size)
+    size <<= 1;
+
+  io = (REDISIO *)calloc(1 , sizeof(REDISIO));
+  if(!io)
+    return NULL;
+  io->ctx = ctx;
+  io->efd = eventfd(0 , EFD_NONBLOCK|EFD_CLOEXEC);
+  if(io->efd<0 || _ring_init(&io->sq , size)<0 || _ring_init(&io->cq , size)<0)
+  {
+    slog_log(ctx->slog_d , SL_ERR , "<%s> failed! alloc rings:%u err:%s" , __FUNCTION__ , size , strerror(errno));
+    goto _fail;
+  }
+
+  memset(&ev , 0 , sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.u32 = IO_EFD_EVENT;
+  if(epoll_ctl(ctx->epfd , EPOLL_CTL_ADD , io->efd , &ev) < 0)
+  {
+    slog_log(ctx->slog_d , SL_ERR , "<%s> failed! add eventfd err:%s" , __FUNCTION__ , strerror(errno));
+    goto _fail;
+  }
+
+  if(pthread_create(&io->tid , NULL , _io_main , io) != 0)
+  {
+    slog_log(ctx->slog_d , SL_ERR , "<%s> failed! create io thread!" , __FUNCTION__);
+    epoll_ctl(ctx->epfd , EPOLL_CTL_DEL , io->efd , NULL);
+    goto _fail;
+  }
+  slog_log(ctx->slog_d , SL_INFO , "<%s> success! ring:%u" , __FUNCTION__ , size);
+  return io;
+
+_fail:
+  _io_free(io);
+  return NULL;
+}
+
+int redis_io_exec(redis_io_t *io , int rd , char *cmd , REDIS_CALLBACK callback , char *private , int private_len)
+{
+  char *buf = NULL;
+  int len = 0;
+
+  if(!io || !cmd)
+    return -1;
+  len = redisFormatCommand(&buf , cmd);
+  if(len <= 0)
+    return -1;
+  return _io_send(io , rd , buf , len , callback , private , private_len);
+}
+
+int redis_io_execv(redis_io_t *io , int rd , int argc , const char *argv[] , const size_t argvlen[] , 
+  REDIS_CALLBACK callback , char *private , int private_len)
+{
+  char *buf = NULL;
+  int len = 0;
+
+  if(!io || argc<=0 || !argv)
+    return -1;
+  len = redisFormatCommandArgv(&buf , argc , argv , argvlen);
+  if(len <= 0)
+    return -1;
+  return _io_send(io , rd , buf , len , callback , private , private_len);
+}
+
+int redis_poll_completions(redis_io_t *io , int max)
+{
+  IOCOMP *pcomp = NULL;
+  int n = 0;
+
+  if(!io)
+    return -1;
+  while(max<=0 || n<max)
+  {
+    pcomp = (IOCOMP *)_ring_pop(&io->cq);
+    if(!pcomp)
+      break;
+    _io_finish(pcomp);
+    n++;
+  }
+  return n;
+}
+
+int redis_io_stop(redis_io_t *io)
+{
+  IOREQ *req = NULL;
+  IOCOMP *pcomp = NULL;
+
+  if(!io)
+    return -1;
+  __atomic_store_n(&io->stop , 1 , __ATOMIC_RELEASE);
+  _efd_write(io->efd);
+  pthread_join(io->tid , NULL);
+
+  //not taken by io thread
+  while((req = (IOREQ *)_ring_pop(&io->sq)))
+  {
+    if(req->func)
+      (*req->func)(req->private , req->private_len , CB_RET_DISCONNECT , 0 , NULL , NULL);
+    redisFreeCommand(req->cmd);
+    free(req);
+  }
+
+  //replied or failed by close of ctx
+  redis_poll_completions(io , 0);
+  while(io->backlog)
+  {
+    pcomp = io->backlog;
+    io->backlog = pcomp->next;
+    _io_finish(pcomp);
+  }
+  _io_free(io);
+  return 0;
+}
+
 int redis_reconnect(int rd)
 {
-  REDIS_GLOBALSPACE *pspace = &redis_global_space;
+  REDIS_GLOBALSPACE *pspace = redis_space;
   REDISENV *penv = NULL;
   int sld = -1;
 
@@ -205,7 +1111,7 @@ int redis_redirect(int rd , char *ip , int port , int timeout)
   REDISENV *pstEnv = NULL;
   //pstEnv = &redis_env;
   int sld = -1;
-  REDIS_GLOBALSPACE *pspace = &redis_global_space;
+  REDIS_GLOBALSPACE *pspace = redis_space;
 
   /***Check Basic*/
   sld = pspace->slog_d;
@@ -224,1265 +1130,7331 @@ int redis_redirect(int rd , char *ip , int port , int timeout)
 
   strncpy(pstEnv->ip , ip , sizeof(pstEnv->ip));
   pstEnv->port = port; 
-  pstEnv->timeout = timeout;
+  pstEnv->timeout_ms = timeout*1000;
 
   slog_log(sld , SL_INFO , "<%s> to %s:%d will try reconnect. timeout:%d rd:%d" , __FUNCTION__ , ip , port , 
     timeout , rd);
   return 0; 
 }
 
-REDIS_CONN_FLAG redis_isconnect(int rd)
+int redis_pool_open(char *ip , int port , int timeout , int size , REDIS_LOG_LEVEL log_level)
 {
-  REDISENV *pstEnv = NULL;
-  pstEnv = NULL;
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISPOOL *ppool = NULL;
+  REDISPOOL *new_list = NULL;
+  int *rds = NULL;
+  int new_len = 0;
+  int pd = -1;
+  int rd = -1;
+  int i = 0;
 
-  /***Get Env*/
-  pstEnv = _rd2env(rd, __FUNCTION__);
-  if(!pstEnv)
-    return REDIS_CONN_FLG_FAIL;
+  if(size<=0 || pspace->valid_count+size>REDIS_MAX_OPEN_NUM)
+  {
+    slog_log(pspace->slog_d , SL_ERR, "<%s> failed! size:%d illegal! opened:%d max:%d", __FUNCTION__ , size , 
+      pspace->valid_count , REDIS_MAX_OPEN_NUM);
+    return -1;
+  }
 
-  //if(!pstEnv->conn && pstEnv->run)
-  //  return 1;
-  //if(pstEnv->flag == REDIS_ENV_FLG_CONNECTED)
-  //  return 1;
-  
+  rds = (int *)calloc(size , sizeof(int));
+  if(!rds)
+  {
+    slog_log(pspace->slog_d , SL_ERR , "<%s> failed! alloc members:%d err:%s" , __FUNCTION__ , size , strerror(errno));
+    return -1;
+  }
 
-  return pstEnv->flag;
+  //open members first. the first open may init global space
+  for(i=0; i<size; i++)
+  {
+    rd = _redis_open(ip , port , log_level , 1);
+    if(rd>=0 && _redis_connect(rd , ip , port , timeout*1000)<0)
+    {
+      redis_close(rd);
+      rd = -1;
+    }
+    if(rd < 0)
+    {
+      slog_log(pspace->slog_d , SL_ERR , "<%s> failed for open member:%d %s:%d!", __FUNCTION__ , i , ip , port);
+      goto _fail;
+    }
+    rds[i] = rd;
+  }
+
+  //search empty pool
+  for(pd=0; pd<pspace->pool_len; pd++)
+  {
+    if(pspace->pool_list[pd].size == 0)
+      break;
+  }
+  if(pd >= pspace->pool_len)
+  {
+    new_len = pspace->pool_len? pspace->pool_len*2 : 4;
+    new_list = (REDISPOOL *)realloc(pspace->pool_list , new_len*sizeof(REDISPOOL));
+    if(!new_list)
+    {
+      slog_log(pspace->slog_d , SL_ERR , "<%s> failed! alloc pool list err:%s" , __FUNCTION__ , strerror(errno));
+      goto _fail;
+    }
+    memset(&new_list[pspace->pool_len] , 0 , (new_len-pspace->pool_len)*sizeof(REDISPOOL));
+    pspace->pool_list = new_list;
+    pspace->pool_len = new_len;
+  }
+
+  ppool = &pspace->pool_list[pd];
+  ppool->rds = rds;
+  ppool->size = size;
+  ppool->rr = 0;
+  for(i=0; i<size; i++)
+    pspace->env_list[rds[i]].pool = pd + 1;
+  pspace->pool_count++;
+
+  slog_log(pspace->slog_d , SL_INFO, "<%s> %s:%d:%d size:%d success! pd:%d", __FUNCTION__ , ip , port , timeout , 
+    size , pd);
+  return pd;
+
+_fail:
+  while(i > 0)
+    redis_close(rds[--i]);
+  free(rds);
+  return -1;
 }
 
-//Activated by main_process tick or circle
-int redis_tick()
+int redis_pool_rd(int pd , int affinity)
 {
-  REDIS_GLOBALSPACE *pspace = &redis_global_space;
-  int i = -1;
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISPOOL *ppool = NULL;
+  REDISENV *penv = NULL;
   int real_len = 0;
-  int valid_check = 0;
-  REDISENV *env_list[REDIS_MAX_OPEN_NUM] = {NULL};
-  
-  //empty list
-  if(!pspace->env_list || pspace->list_len < 0)
-    return 0;
+  int best = -1;
+  int least = 0;
+  int rd = -1;
+  int i = 0;
 
-  //each rd tick  
+  if(pd<0 || pd>=pspace->pool_len || pspace->pool_list[pd].size<=0 || !pspace->env_list)
+    return -1;
+  ppool = &pspace->pool_list[pd];
   real_len = (int)pow(2 , pspace->list_len);
-  for(i=0; i<real_len && valid_check<pspace->valid_count; i++)
+
+  //fixed member while it is connected. else picked as below
+  if(affinity >= 0)
   {
-    if(pspace->env_list[i].stat == REDIS_ENV_STAT_EMPTY)
-      continue;
+    rd = ppool->rds[affinity % ppool->size];
+    if(rd>=0 && rd<real_len && pspace->env_list[rd].stat!=REDIS_ENV_STAT_EMPTY && pspace->env_list[rd].pool==pd+1 && 
+      pspace->env_list[rd].flag==REDIS_CONN_FLG_CONNECTED)
+      return rd;
+  }
 
-    //_redis_tick(&pspace->env_list[i]);
-    env_list[valid_check] = &pspace->env_list[i];
-    valid_check++;
+  //least outstanding among connected members
+  for(i=0; i<ppool->size; i++)
+  {
+    rd = ppool->rds[(ppool->rr+i) % ppool->size];
+    if(rd<0 || rd>=real_len)
+      continue;
+    penv = &pspace->env_list[rd];
+    if(penv->stat==REDIS_ENV_STAT_EMPTY || penv->pool!=pd+1 || penv->flag!=REDIS_CONN_FLG_CONNECTED)
+      continue;
+    if(best<0 || penv->cb_count<least)
+    {
+      best = rd;
+      least = penv->cb_count;
+      if(least == 0)
+        break;
+    }
   }
+  ppool->rr++;
+  return best;
+}
 
-  //multiple
-  _redis_tick_multi(env_list, valid_check);
+int redis_pool_exec(int pd , char *cmd , REDIS_CALLBACK callback , char *private , int private_len)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  int rd = -1;
 
-  return 0;
+  rd = redis_pool_rd(pd , -1);
+  if(rd < 0)
+  {
+    slog_log(pspace->slog_d , SL_ERR , "<%s>:%s failed! no member connected! pd:%d" , __FUNCTION__ , cmd , pd);
+    return -1;
+  }
+  return redis_exec(rd , cmd , callback , private , private_len);
 }
 
-int redis_exec(int rd , char *cmd , REDIS_CALLBACK callback , char *private , int private_len)
-{ 
-  int ret = -1;
-  REDISENV *pstEnv = NULL;
-  char *ptr = NULL;
-
-  int sld = -1;
-  REDIS_GLOBALSPACE *pspace = &redis_global_space;
+int redis_pool_close(int pd)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISPOOL *ppool = NULL;
+  REDISENV *penv = NULL;
+  int i = 0;
 
-  /***Check Basic*/
-  sld = pspace->slog_d;
-  if(sld < 0)
+  if(pd<0 || pd>=pspace->pool_len || pspace->pool_list[pd].size<=0)
     return -1;
+  ppool = &pspace->pool_list[pd];
 
-  /***Get Env*/
-  pstEnv = _rd2env(rd, __FUNCTION__);
-  if(!pstEnv)
-    return -1;
+  //members closed by app are skipped
+  for(i=0; i<ppool->size; i++)
+  {
+    penv = _rd2env(ppool->rds[i] , __FUNCTION__);
+    if(penv && penv->pool==pd+1)
+      redis_close(ppool->rds[i]);
+  }
 
-  slog_log(sld, SL_DEBUG, "<%s> starts. rd:%d cmd:%s",__FUNCTION__ , rd , cmd);
-  /***Env Check*/
-  if(pstEnv->flag!=REDIS_CONN_FLG_CONNECTED || !pstEnv->hiredis_cxt)
+  free(ppool->rds);
+  ppool->rds = NULL;
+  ppool->size = 0;
+  pspace->pool_count--;
+  if(pspace->pool_count <= 0)
   {
-    slog_log(sld , SL_ERR , "<%s>:%s failed! not connected!rd:%d flag:%d" , __FUNCTION__ , cmd , rd , 
-      pstEnv->flag);
-    return -1;
+    free(pspace->pool_list);
+    pspace->pool_list = NULL;
+    pspace->pool_len = 0;
+    pspace->pool_count = 0;
   }
+  return 0;
+}
 
-  /***Save CallBack*/
-  CBINFO *pstCBInfo = (CBINFO *)calloc(1 , sizeof(CBINFO));
-  if(!pstCBInfo)
+int redis_cluster_open(char *ip , int port , int timeout , REDIS_LOG_LEVEL log_level)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISCLUSTER *pcluster = NULL;
+  REDISCLUSTER *new_list = NULL;
+  int *slots = NULL;
+  int *nodes = NULL;
+  int new_len = 0;
+  int cd = -1;
+  int rd = -1;
+  int i = 0;
+
+  //seed node first. the first open may init global space
+  rd = _redis_open(ip , port , log_level , 1);
+  if(rd < 0)
   {
-    slog_log(sld , SL_ERR , "<%s> failed! Alloc CBINFO FAIL! rd:%d err:%s" , __FUNCTION__ , rd , strerror(errno));
+    slog_log(pspace->slog_d , SL_ERR , "<%s> failed for open seed %s:%d!", __FUNCTION__ , ip , port);
     return -1;
   }
-  do
+  if(_redis_connect(rd , ip , port , timeout*1000) < 0)
   {
-    //NO CALLBACK
-    if(!callback)
-      break;
+    slog_log(pspace->slog_d , SL_ERR , "<%s> failed for connect seed %s:%d!", __FUNCTION__ , ip , port);
+    redis_close(rd);
+    return -1;
+  }
 
-    pstCBInfo->stat = CB_INFO_STAT_VALID;
-    pstCBInfo->func = callback;
-    pstCBInfo->private_len = private_len;
-    //NO PRIVATE DATA
-    if(!private || private_len<=0)
-    {
-      slog_log(sld , SL_DEBUG , "<%s> no private stored! rd:%d" , __FUNCTION__ , rd);      
-      break;
-    }
+  slots = (int *)malloc(REDIS_CLUSTER_SLOTS*sizeof(int));
+  nodes = (int *)malloc(REDIS_CLUSTER_NODE_INIT*sizeof(int));
+  if(!slots || !nodes)
+  {
+    slog_log(pspace->slog_d , SL_ERR , "<%s> failed! alloc slot table err:%s" , __FUNCTION__ , strerror(errno));
+    goto _fail;
+  }
+  for(i=0; i<REDIS_CLUSTER_SLOTS; i++)
+    slots[i] = -1;
 
-    //PRIVATE LEN <= DEFAULT_CB_PRIVATE_LEN
-    if(private_len <= DEFAULT_CB_PRIVATE_LEN)
-    {
-      slog_log(sld , SL_VERBOSE , "<%s> default private len enough! rd:%d" , __FUNCTION__ , rd);
-      pstCBInfo->private = pstCBInfo->private_data;
-      memcpy(pstCBInfo->private , private , private_len);      
+  //search empty cluster
+  for(cd=0; cd<pspace->cluster_len; cd++)
+  {
+    if(!pspace->cluster_list[cd].slots)
       break;
-    }
-
-    //PRIVATE_LEN > DEFAULT_CB_PRIVATE_LEN
-    slog_log(sld , SL_VERBOSE , "<%s> calloc private data! rd:%d" , __FUNCTION__ , rd);
-    pstCBInfo->private = (char *)calloc(1 , private_len);
-    if(!pstCBInfo->private)
+  }
+  if(cd >= pspace->cluster_len)
+  {
+    new_len = pspace->cluster_len? pspace->cluster_len*2 : 4;
+    new_list = (REDISCLUSTER *)realloc(pspace->cluster_list , new_len*sizeof(REDISCLUSTER));
+    if(!new_list)
     {
-      slog_log(sld , SL_ERR , "<%s> failed! Alloc CBINFO PRIVATE DATA:%d FAIL! err:%s rd:%d cmd:%s" , __FUNCTION__ , 
-        private_len , strerror(errno) , rd , cmd);
-      return -1;
+      slog_log(pspace->slog_d , SL_ERR , "<%s> failed! alloc cluster list err:%s" , __FUNCTION__ , strerror(errno));
+      goto _fail;
     }
-    memcpy(pstCBInfo->private , private , private_len);
-    break;
+    memset(&new_list[pspace->cluster_len] , 0 , (new_len-pspace->cluster_len)*sizeof(REDISCLUSTER));
+    pspace->cluster_list = new_list;
+    pspace->cluster_len = new_len;
   }
-  while(0);
 
-  if(_tpush_cbi(pstEnv , pstCBInfo) < 0 )
+  pcluster = &pspace->cluster_list[cd];
+  pcluster->slots = slots;
+  pcluster->timeout_ms = timeout*1000;
+  pcluster->log_level = log_level;
+  pcluster->nodes = nodes;
+  pcluster->node_size = REDIS_CLUSTER_NODE_INIT;
+  pcluster->nodes[0] = rd;
+  pcluster->node_cnt = 1;
+  pcluster->refresh = 1; //loaded when seed connected
+  pcluster->load_ms = 0;
+  pspace->env_list[rd].cluster = cd + 1;
+  pspace->cluster_count++;
+
+  slog_log(pspace->slog_d , SL_INFO, "<%s> seed %s:%d success! cd:%d rd:%d", __FUNCTION__ , ip , port , cd , rd);
+  return cd;
+
+_fail:
+  free(slots);
+  free(nodes);
+  redis_close(rd);
+  return -1;
+}
+
+int redis_cluster_rd(int cd , const char *key , int keylen)
+{
+  REDISCLUSTER *pcluster = NULL;
+  REDISENV *penv = NULL;
+  int rd = -1;
+
+  pcluster = _cluster_get(cd);
+  if(!pcluster || !key || keylen<0)
     return -1;
-  
-  //Append Command
-  ret = redisAppendCommand(pstEnv->hiredis_cxt, cmd);
-  if(ret != REDIS_OK)
+
+  rd = pcluster->slots[_cluster_slot(key , keylen)];
+  penv = _cluster_env(cd , rd);
+  if(penv && penv->flag==REDIS_CONN_FLG_CONNECTED)
+    return rd;
+
+  //unknown or down. reload map and let any connected node redirect it
+  if(!penv || penv->flag==REDIS_CONN_FLG_FAIL || penv->flag==REDIS_CONN_FLG_CLOSED)
+    pcluster->refresh = 1;
+  return _cluster_any(pcluster , cd);
+}
+
+int redis_cluster_exec(int cd , char *cmd , REDIS_CALLBACK callback , char *private , int private_len)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISCLUSTER *pcluster = NULL;
+  const char *name = NULL;
+  const char *key = NULL;
+  const char *num = NULL;
+  int name_len = 0;
+  int num_len = 0;
+  int keylen = 0;
+  int rd = -1;
+
+  if(!cmd || !(name=_cmd_token(cmd , 0 , &name_len)))
   {
-    slog_log(sld , SL_ERR , "<%s>:%s failed! err:%s rd:%d" , __FUNCTION__ , cmd , pstEnv->hiredis_cxt->errstr, rd);
+    slog_log(pspace->slog_d , SL_ERR , "<%s> failed! cmd empty! cd:%d" , __FUNCTION__ , cd);
     return -1;
   }
 
-  return 0;
+  //keyless cmd goes to any node. so does EVAL/FCALL with numkeys 0
+  key = _cmd_token(cmd , _cluster_keypos(name , name_len) , &keylen);
+  if(key && _cluster_keypos(name , name_len)==3 && (num=_cmd_token(cmd , 2 , &num_len)) && num_len==1 && num[0]=='0')
+    key = NULL;
+
+  pcluster = _cluster_get(cd);
+  rd = key? redis_cluster_rd(cd , key , keylen) : (pcluster? _cluster_any(pcluster , cd) : -1);
+  if(rd < 0)
+  {
+    slog_log(pspace->slog_d , SL_ERR , "<%s>:%s failed! no node connected! cd:%d" , __FUNCTION__ , cmd , cd);
+    return -1;
+  }
+  return redis_exec(rd , cmd , callback , private , private_len);
 }
 
-/************INNER FUNC DEFINE*****************/
-//open a redis_descriptor for process
-//return >=0:success -1:failed
-static int _redis_open(char *ip , int port , REDIS_LOG_LEVEL log_level)
+int redis_cluster_execv(int cd , int argc , const char *argv[] , const size_t argvlen[] , 
+  REDIS_CALLBACK callback , char *private , int private_len)
 {
-  char msg[1024] = {0};
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISCLUSTER *pcluster = NULL;
+  int pos = 0;
   int rd = -1;
-  int slog = -1;
-  int real_len = 0;
-  int new_len = 0;
-  REDIS_GLOBALSPACE *pspace = &redis_global_space;
-  REDISENV *penv = NULL;
-
-  SLOG_OPTION log_option;
-  int i = 0;
 
+  if(argc<=0 || !argv)
+  {
+    slog_log(pspace->slog_d , SL_ERR , "<%s> failed! arg illegal! cd:%d argc:%d" , __FUNCTION__ , cd , argc);
+    return -1;
+  }
 
-  //Open Log(Only Once)
-  if(pspace->slog_d < 0)
-  {            
-    //Basic Check And Init
-    memset(pspace , 0 , sizeof(REDIS_GLOBALSPACE));
-    pspace->slog_d = -1;
-    if(log_level<REDIS_LOG_DEBUG || log_level>REDIS_LOG_ERR)
-    {
-      printf("<%s> log level err! log_level:%d\n" , __FUNCTION__ , log_level);
-      return -1;
-    }    
+  //keyless cmd goes to any node. so does EVAL/FCALL with numkeys 0
+  pos = _cluster_keypos(argv[0] , argvlen? (int)argvlen[0] : (int)strlen(argv[0]));
+  if(pos==3 && pos<argc && (argvlen? argvlen[2]==1 : argv[2][1]==0) && argv[2][0]=='0')
+    pos = argc;
 
-    //Open
-    memset(&log_option , 0 , sizeof(SLOG_OPTION));
-    strncpy(log_option.type_value._local.log_name , REDIS_LOG , sizeof(log_option.type_value._local.log_name));
-    log_option.log_degree = REDIS_LOG_DEGREE;
-    log_option.log_size = REDIS_LOG_SIZE;
-    log_option.rotate = REDIS_LOG_ROTATE;
-    log_option.format = REDIS_LOG_FORMAT;
-    
-    pspace->slog_d = slog_open(SLT_LOCAL , log_level , &log_option , msg);
-    if(pspace->slog_d < 0)
-    {
-      printf("[%s] failed! slog_open error! msg:%s\n" , __FUNCTION__ , msg);
-      return -1;
-    }
-    slog = pspace->slog_d;  
-    slog_log(slog, SL_INFO, "<%s> slog_open success!",__FUNCTION__);
-  }
+  pcluster = _cluster_get(cd);
+  if(pos < argc)
+    rd = redis_cluster_rd(cd , argv[pos] , argvlen? (int)argvlen[pos] : (int)strlen(argv[pos]));
   else
-    slog = pspace->slog_d;
-
-  //Empty List
-  if(!pspace->env_list || pspace->list_len < 0)
+    rd = pcluster? _cluster_any(pcluster , cd) : -1;
+  if(rd < 0)
   {
-    slog_log(slog , SL_INFO , "<%s> try to alloc in an empty list!" , __FUNCTION__);
-    penv = (REDISENV *)calloc(1 , sizeof(REDISENV));
-    if(!penv)
-    {
-      slog_log(slog , SL_ERR , "<%s> failed! calloc error! err:%s" , __FUNCTION__ , strerror(errno));
-      return -1;
-    }
+    slog_log(pspace->slog_d , SL_ERR , "<%s> failed! no node connected! cd:%d" , __FUNCTION__ , cd);
+    return -1;
+  }
+  return redis_execv(rd , argc , argv , argvlen , callback , private , private_len);
+}
 
-    rd = 0;
-    //set space info
-    pspace->valid_count = 1;
-    pspace->list_len = 0;//(log2(1))
-    pspace->env_list = penv;
+int redis_cluster_mexec(int cd , int argc , const char *argv[] , const size_t argvlen[] , 
+  REDIS_CALLBACK callback , char *private , int private_len)
+{
+  return _scatter(cd , 1 , argc , argv , argvlen , callback , private , private_len);
+}
 
-    //set env info
-    penv->stat = REDIS_ENV_STATA_VALID;
-    penv->id = rd;
+int redis_cluster_close(int cd)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISCLUSTER *pcluster = NULL;
+  int i = 0;
 
-    //print
-    _print_space();
-    return rd;
+  pcluster = _cluster_get(cd);
+  if(!pcluster)
+    return -1;
+
+  //nodes closed by app are skipped
+  for(i=0; i<pcluster->node_cnt; i++)
+  {
+    if(_cluster_env(cd , pcluster->nodes[i]))
+      redis_close(pcluster->nodes[i]);
   }
 
-  //No-Full List
-  real_len = (int)pow(2 , pspace->list_len);
+  pcluster = &pspace->cluster_list[cd];
+  free(pcluster->slots);
+  free(pcluster->nodes);
+  memset(pcluster , 0 , sizeof(REDISCLUSTER));
+  pspace->cluster_count--;
+  if(pspace->cluster_count <= 0)
+  {
+    free(pspace->cluster_list);
+    pspace->cluster_list = NULL;
+    pspace->cluster_len = 0;
+    pspace->cluster_count = 0;
+  }
+  return 0;
+}
 
-  //check ip:port duplicate
-  for(i=0; i<real_len; i++)
+int redis_shard_open(int count , int rds[] , int vnodes , int rebalance)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISSHARD *pshard = NULL;
+  REDISSHARD *new_list = NULL;
+  REDISSHARD shard;
+  REDISENV *penv = NULL;
+  char name[96];
+  int new_len = 0;
+  int len = 0;
+  int sd = -1;
+  int i = 0;
+  int v = 0;
+
+  if(count<=0 || !rds)
+    return -1;
+  if(vnodes <= 0)
+    vnodes = REDIS_SHARD_VNODES;
+
+  memset(&shard , 0 , sizeof(shard));
+  shard.count = count;
+  shard.rebalance = rebalance? 1 : 0;
+  shard.point_cnt = count * vnodes;
+  shard.rds = (int *)malloc(count*sizeof(int));
+  shard.down = (char *)calloc(count , sizeof(char));
+  shard.points = (SHARDPOINT *)malloc(shard.point_cnt*sizeof(SHARDPOINT));
+  shard.live = (SHARDPOINT *)malloc(shard.point_cnt*sizeof(SHARDPOINT));
+  if(!shard.rds || !shard.down || !shard.points || !shard.live)
   {
-    if(pspace->env_list[i].stat == REDIS_ENV_STAT_EMPTY)
-      continue;
+    slog_log(pspace->slog_d , SL_ERR , "<%s> failed! alloc points:%d err:%s" , __FUNCTION__ , shard.point_cnt , 
+      strerror(errno));
+    goto _fail;
+  }
 
-    penv = &pspace->env_list[i];
-    if(strcasecmp(penv->ip , ip)==0 && penv->port==port)
+  //points named by endpoint so that ring is same across processes
+  for(i=0; i<count; i++)
+  {
+    penv = _rd2env(rds[i] , __FUNCTION__);
+    if(!penv)
+      goto _fail;
+    shard.rds[i] = rds[i];
+    for(v=0; v<vnodes; v++)
     {
-      slog_log(slog, SL_ERR, "<%s> failed! ip:port[%s:%d] duplicate!", __FUNCTION__ , ip , port);
-      return -1;
+      len = snprintf(name , sizeof(name) , "%s:%d-%d" , penv->ip , penv->port , v);
+      shard.points[i*vnodes+v].hash = _shard_hash(name , len);
+      shard.points[i*vnodes+v].member = i;
     }
   }
-  
+  qsort(shard.points , shard.point_cnt , sizeof(SHARDPOINT) , _shard_point_cmp);
+  memset(shard.down , 2 , count); //unknown. ring built below
 
-  //search
-  if(pspace->valid_count < real_len)
+  //search empty group
+  for(sd=0; sd<pspace->shard_len; sd++)
   {
-    for(i=0; i<real_len; i++)
+    if(pspace->shard_list[sd].count == 0)
+      break;
+  }
+  if(sd >= pspace->shard_len)
+  {
+    new_len = pspace->shard_len? pspace->shard_len*2 : 4;
+    new_list = (REDISSHARD *)realloc(pspace->shard_list , new_len*sizeof(REDISSHARD));
+    if(!new_list)
     {
-      if(pspace->env_list[i].stat == REDIS_ENV_STAT_EMPTY)
-        break;
+      slog_log(pspace->slog_d , SL_ERR , "<%s> failed! alloc shard list err:%s" , __FUNCTION__ , strerror(errno));
+      goto _fail;
     }
-    if(i<real_len)
-    {
-      //set env
-      penv = &pspace->env_list[i];
-      penv->stat = REDIS_ENV_STATA_VALID;
-      penv->id = i;
+    memset(&new_list[pspace->shard_len] , 0 , (new_len-pspace->shard_len)*sizeof(REDISSHARD));
+    pspace->shard_list = new_list;
+    pspace->shard_len = new_len;
+  }
 
-      //set space
-      pspace->valid_count++;
-      rd = i;
+  pshard = &pspace->shard_list[sd];
+  memcpy(pshard , &shard , sizeof(REDISSHARD));
+  _shard_build(pshard);
+  pspace->shard_count++;
 
-      //print
-      _print_space();
-      return rd;
-    }
-    else //should not happen
-    {
-      slog_log(slog, SL_FATAL, "<%s> No-FUll List alloc Failed!valid_count:%d real_len:%d list_len:%d", 
-        __FUNCTION__ , pspace->valid_count , real_len , pspace->list_len);
-    }
-  }
+  slog_log(pspace->slog_d , SL_INFO, "<%s> success! sd:%d members:%d vnodes:%d rebalance:%d", __FUNCTION__ , sd , count , 
+    vnodes , pshard->rebalance);
+  return sd;
 
-  //ALLOC NEW
-  slog_log(slog, SL_INFO, "<%s> try to alloc new list",__FUNCTION__);
-  new_len = (int)pow(2 , pspace->list_len+1);
-  penv = (REDISENV *)calloc(new_len , sizeof(REDISENV));
-  if(!penv)
-  {
-    slog_log(slog, SL_ERR, "<%s> alloc new list failed! new_len:%d list_len:%d",__FUNCTION__ , 
-      new_len , pspace->list_len);
+_fail:
+  free(shard.rds);
+  free(shard.down);
+  free(shard.points);
+  free(shard.live);
+  return -1;
+}
+
+int redis_shard_rd(int sd , const char *key , int keylen)
+{
+  REDISSHARD *pshard = NULL;
+  SHARDPOINT *ring = NULL;
+  unsigned int hash = 0;
+  int cnt = 0;
+  int low = 0;
+  int high = 0;
+  int mid = 0;
+  int member = 0;
+  int retry = 0;
+
+  pshard = _shard_get(sd);
+  if(!pshard || !key || keylen<0)
     return -1;
-  }
+  hash = _shard_hash(key , keylen);
 
-    //cpy old
-  memcpy(penv , pspace->env_list , real_len*sizeof(REDISENV));
-    //free old
-  free(pspace->env_list);
-    //new
-  pspace->env_list = penv;
-  pspace->list_len++;
-    //search
-  for(i=0; i<new_len; i++)
+  for(retry=0; retry<2; retry++)
   {
-    if(pspace->env_list[i].stat == REDIS_ENV_STAT_EMPTY)
+    ring = pshard->rebalance? pshard->live : pshard->points;
+    cnt = pshard->rebalance? pshard->live_cnt : pshard->point_cnt;
+    if(cnt <= 0)
+      return -1;
+
+    //first point clockwise from hash
+    low = 0;
+    high = cnt;
+    while(low < high)
+    {
+      mid = (low + high) / 2;
+      if(ring[mid].hash < hash)
+        low = mid + 1;
+      else
+        high = mid;
+    }
+    member = ring[low<cnt? low : 0].member;
+
+    //state changed since ring built. rebuild at once instead of waiting for tick
+    if(_shard_down(pshard->rds[member]) == pshard->down[member])
       break;
+    _shard_build(pshard);
   }
-  if(i >= new_len)
+
+  if(pshard->down[member])
+    return -1;
+  return pshard->rds[member];
+}
+
+int redis_shard_exec(int sd , const char *key , int keylen , char *cmd , REDIS_CALLBACK callback , 
+  char *private , int private_len)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  int rd = -1;
+
+  rd = redis_shard_rd(sd , key , keylen);
+  if(rd < 0)
   {
-    slog_log(slog, SL_FATAL, "<%s> alloc failed! Even In the New List! old_len:%d new_len:%d " 
-      "list_len:%d" , __FUNCTION__ , real_len , new_len , pspace->list_len);
+    slog_log(pspace->slog_d , SL_ERR , "<%s>:%s failed! no member for key! sd:%d" , __FUNCTION__ , cmd , sd);
     return -1;
   }
-  penv = &pspace->env_list[i];
-  penv->stat = REDIS_ENV_STATA_VALID;
-  penv->id = i;
-  pspace->valid_count++;
-  
-    //print
-  _print_space();
-
-    //return
-  rd = i;
-  return rd;  
+  return redis_exec(rd , cmd , callback , private , private_len);
 }
 
+int redis_shard_mexec(int sd , int argc , const char *argv[] , const size_t argvlen[] , 
+  REDIS_CALLBACK callback , char *private , int private_len)
+{
+  return _scatter(sd , 0 , argc , argv , argvlen , callback , private , private_len);
+}
 
-static int _redis_connect(int rd , char *ip , int port , int timeout)
+int redis_shard_close(int sd)
 {
-  REDIS_GLOBALSPACE *pspace = &redis_global_space;
-  REDISENV *pstEnv = NULL;
-  //pstEnv = &redis_env;
-  int i = 0;
-  int sld = -1;
-  int ret = -1;
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISSHARD *pshard = NULL;
 
-  /***Check Basic*/
-  sld = pspace->slog_d;
-  if(sld < 0)
+  pshard = _shard_get(sd);
+  if(!pshard)
     return -1;
 
-  /***Get Env*/
-  pstEnv = _rd2env(rd, __FUNCTION__);
-  if(!pstEnv)
-    return -1;
-  
-  /***Start Connect*/
-  pstEnv->flag = REDIS_CONN_FLG_CONNECTING;
-  pstEnv->hiredis_cxt = redisConnectNonBlock(ip , port);
-  if(!pstEnv->hiredis_cxt)
+  free(pshard->rds);
+  free(pshard->down);
+  free(pshard->points);
+  free(pshard->live);
+  memset(pshard , 0 , sizeof(REDISSHARD));
+  pspace->shard_count--;
+  if(pspace->shard_count <= 0)
   {
-    slog_log(sld , SL_ERR , "<%s> failed! rd:%d ip:%s port:%d" , __FUNCTION__ , rd , ip , port);
-    return -1;
+    free(pspace->shard_list);
+    pspace->shard_list = NULL;
+    pspace->shard_len = 0;
+    pspace->shard_count = 0;
   }
-
-  //set info
-  long curr_ts = time(NULL);
-  pstEnv->connect_end_ts = curr_ts + timeout;
-
-  strncpy(pstEnv->ip , ip , sizeof(pstEnv->ip));
-  pstEnv->port = port; 
-  pstEnv->timeout = timeout;
-
-  slog_log(sld , SL_INFO , "<%s> to %s:%d in progessing and will expire at:%ld rd:%d" , __FUNCTION__ , ip , port , 
-    pstEnv->connect_end_ts , rd);
   return 0;
 }
 
-
-static int _check_connect(REDISENV *penv)
+int redis_repl_open(int master , int count , int replicas[] , int hedge)
 {
-  fd_set rfds;
-  fd_set wfds;
-  int ret = 0;
-  long curr_ts;
-  int fd = -1;
-  int sld = -1;
-  int opt_value = 0;
-  int opt_len = 0;
-
-  curr_ts = time(NULL);
-  REDIS_GLOBALSPACE *pspace = &redis_global_space;
-  REDISENV *pstEnv = penv;
-  
-  sld = pspace->slog_d;
-  fd = pstEnv->hiredis_cxt->fd;
-  
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISREPL *prepl = NULL;
+  REDISREPL *new_list = NULL;
+  REDISREPL repl;
+  REDISENV *penv = NULL;
+  int new_len = 0;
+  int gd = -1;
+  int rd = -1;
+  int i = 0;
 
-  //if time out  
-  if(curr_ts >= pstEnv->connect_end_ts)  
+  if(count<0 || (count>0 && !replicas))
+    return -1;
+  if(count > REDIS_REPL_MAX_REPLICAS)
   {
-    slog_log(sld , SL_ERR , "<%s> connect timeout!rd:%d fd:%d" , __FUNCTION__ , pstEnv->id , fd);
+    slog_log(pspace->slog_d , SL_ERR , "<%s> failed! replicas:%d exceed max:%d" , __FUNCTION__ , count , 
+      REDIS_REPL_MAX_REPLICAS);
     return -1;
   }
 
-  //check fd stat
-  FD_ZERO(&rfds);
-  FD_ZERO(&wfds);
-  FD_SET(fd , &rfds);
-  FD_SET(fd , &wfds);
-
-  ret = select(fd+1 , &rfds , &wfds , NULL , NULL);
-  if(ret < 0)
+  memset(&repl , 0 , sizeof(repl));
+  repl.master = master;
+  repl.count = count;
+  repl.hedge = hedge? 1 : 0;
+  repl.replicas = (int *)malloc((count>0? count : 1)*sizeof(int));
+  repl.samples = (int *)calloc(REDIS_REPL_SAMPLES , sizeof(int));
+  if(!repl.replicas || !repl.samples)
   {
-    slog_log(sld , SL_ERR , "<%s> select failed!rd:%d fd:%d , err:%s" , __FUNCTION__ , pstEnv->id , fd , strerror(errno));
-    return -1;
+    slog_log(pspace->slog_d , SL_ERR , "<%s> failed! alloc replicas:%d err:%s" , __FUNCTION__ , count , strerror(errno));
+    goto _fail;
   }
 
-  if(ret == 0)
+  //members must be opened and free
+  for(i=-1; i<count; i++)
   {
-    slog_log(sld , SL_INFO , "<%s> connect not ready! rd%d fd:%d" , __FUNCTION__ , pstEnv->id , fd);
-    return 0;
+    rd = i<0? master : replicas[i];
+    penv = _rd2env(rd , __FUNCTION__);
+    if(!penv)
+      goto _fail;
+    if(penv->repl)
+    {
+      slog_log(pspace->slog_d , SL_ERR , "<%s> failed! rd:%d already in group:%d" , __FUNCTION__ , rd , penv->repl-1);
+      goto _fail;
+    }
+    if(i >= 0)
+      repl.replicas[i] = rd;
   }
 
-  //only write good!
-  if(!FD_ISSET(fd , &rfds) && FD_ISSET(fd , &wfds))
+  //search empty group
+  for(gd=0; gd<pspace->repl_len; gd++)
   {
-    slog_log(sld , SL_INFO , "<%s> connect success! rd:%d fd:%d" , __FUNCTION__ , pstEnv->id , fd);
-    pstEnv->flag = REDIS_CONN_FLG_CONNECTED;
-    return 0;
+    if(!pspace->repl_list[gd].samples)
+      break;
   }
- 
-  //read and write  
-  if(FD_ISSET(fd , &rfds) && FD_ISSET(fd , &wfds))
+  if(gd >= pspace->repl_len)
   {
-    //getsockopt
-    slog_log(sld , SL_INFO , "<%s> sock_fd is r&w! rd:%d fd:%d" , __FUNCTION__ , pstEnv->id , fd);
-    ret = getsockopt(fd , SOL_SOCKET , SO_ERROR , &opt_value , &opt_len);
-    if(ret < 0)
-    {
-      slog_log(sld , SL_ERR , "<%s> getsockopt failed! rd:%d fd:%d err:%s" , __FUNCTION__ , pstEnv->id , fd , strerror(errno));
-      return -1; 
-    }   
-
-    //connect meets an error[linux opt_value may always 0 whenever wrong]
-    if(opt_value != 0)
-    {
-      slog_log(sld , SL_ERR , "<%s> connect meets an error!rd:%d fd:%d errno:%d" , __FUNCTION__ , pstEnv->id , fd , opt_value);
-      return -1;
-    }
-
-    
-    //option 1
-    /*
-    //try read[[server may not push valid data firstly. except port illegal]] 
-    ret = read(fd , &opt_value , sizeof(opt_value));
-    if(ret < 0)
-    {
-      slog_log(sld , SL_ERR , "<%s> connect failed!rd:%d fd:%d err:%s" , __FUNCTION__ , pstEnv->id , fd , strerror(errno));
-      return -1;
-    }
-
-    if(ret == 0)
-    {
-      slog_log(sld , SL_ERR , "<%s> connect failed! rd:%d fd:%d peer closed!" , __FUNCTION__ , pstEnv->id , fd);
-      return -1;
-    }*/
-
-    //option 2 reconnect
-    ret = connect(fd , (struct sockaddr *)pstEnv->hiredis_cxt->saddr , pstEnv->hiredis_cxt->addrlen);
-    if(ret < 0)
-    {      
-      if(ret != EISCONN) //EISCONN shows connection is established!
-      {
-        slog_log(sld , SL_ERR , "<%s> connect failed! rd:%d fd:%d err:%s" , __FUNCTION__ , 
-          pstEnv->id , pstEnv->hiredis_cxt->fd ,strerror(errno));
-        return -1;
-      }
-    }
-    if(ret == 0) //should not happen here
+    new_len = pspace->repl_len? pspace->repl_len*2 : 4;
+    new_list = (REDISREPL *)realloc(pspace->repl_list , new_len*sizeof(REDISREPL));
+    if(!new_list)
     {
-      slog_log(sld , SL_FATAL , "<%s> connect meets a strange problem! please reconnect it" , __FUNCTION__);
-      return -1;
+      slog_log(pspace->slog_d , SL_ERR , "<%s> failed! alloc repl list err:%s" , __FUNCTION__ , strerror(errno));
+      goto _fail;
     }
+    memset(&new_list[pspace->repl_len] , 0 , (new_len-pspace->repl_len)*sizeof(REDISREPL));
+    pspace->repl_list = new_list;
+    pspace->repl_len = new_len;
+  }
 
-    //connected
-    slog_log(sld , SL_INFO , "<%s> connect success! rd:%d fd:%d" , __FUNCTION__ , pstEnv->id , fd);
-    //pstEnv->run = pstEnv->conn;
-    //pstEnv->conn = NULL;
-    pstEnv->flag = REDIS_CONN_FLG_CONNECTED;
-    return 0;
+  prepl = &pspace->repl_list[gd];
+  memcpy(prepl , &repl , sizeof(REDISREPL));
+  for(i=-1; i<count; i++)
+  {
+    penv = &pspace->env_list[i<0? master : replicas[i]];
+    penv->repl = gd + 1;
+    penv->rtt_us = REDIS_RTT_INIT_US;
   }
+  pspace->repl_count++;
 
-  slog_log(sld , SL_FATAL , "<%s> connect in some trouble! rd:%d fd:%d" , __FUNCTION__ , pstEnv->id , fd);
+  slog_log(pspace->slog_d , SL_INFO, "<%s> success! gd:%d master:%d replicas:%d hedge:%d", __FUNCTION__ , gd , master , 
+    count , prepl->hedge);
+  return gd;
+
+_fail:
+  free(repl.replicas);
+  free(repl.samples);
   return -1;
 }
 
+int redis_repl_rd(int gd , int read)
+{
+  REDISREPL *prepl = NULL;
+
+  prepl = _repl_get(gd);
+  if(!prepl)
+    return -1;
+  if(!read)
+    return prepl->master;
+  return _repl_pick(prepl , -1);
+}
 
-static int _redis_reconnect(REDISENV *penv)
+int redis_repl_exec(int gd , char *cmd , REDIS_CALLBACK callback , char *private , int private_len)
 {
-  REDIS_GLOBALSPACE *pspace = &redis_global_space;
-  REDISENV *pstEnv = NULL;
-  pstEnv = penv;
-  int sld = pspace->slog_d;
-  int ret = -1;
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISREPL *prepl = NULL;
+  const char *name = NULL;
+  char *buf = NULL;
+  int name_len = 0;
+  int len = 0;
 
-  pstEnv->hiredis_cxt = redisConnectNonBlock(pstEnv->ip , pstEnv->port);
-  if(!pstEnv->hiredis_cxt)
-  {
-    slog_log(sld , SL_ERR , "%s failed! ip:%s port:%d" , __FUNCTION__ , pstEnv->ip , pstEnv->port);
+  prepl = _repl_get(gd);
+  if(!prepl || !cmd)
     return -1;
-  }
+  name = _cmd_token(cmd , 0 , &name_len);
 
-  //set info
-  long curr_ts = time(NULL);
-  pstEnv->connect_end_ts = curr_ts + pstEnv->timeout;
-  pstEnv->flag = REDIS_CONN_FLG_CONNECTING;
+  //writes take normal path of master
+  if(!name || !_repl_readonly(name , name_len))
+    return _exec_str(prepl->master , cmd , callback , NULL , private , private_len);
 
-  slog_log(pspace->slog_d , SL_INFO , "<%s> to %s:%d in progessing and will expire at:%ld" , __FUNCTION__ , pstEnv->ip , pstEnv->port , 
-    pstEnv->connect_end_ts);
-  return 0;
+  //formatted once. a hedged read is sent twice
+  len = redisFormatCommand(&buf , cmd);
+  if(len <= 0)
+  {
+    slog_log(pspace->slog_d , SL_ERR , "<%s>:%s failed! format illegal! gd:%d" , __FUNCTION__ , cmd , gd);
+    return -1;
+  }
+  return _repl_send(gd , buf , len , callback , private , private_len);
 }
 
-
-static int _redis_tick(REDISENV *penv)
+int redis_repl_execv(int gd , int argc , const char *argv[] , const size_t argvlen[] , REDIS_CALLBACK callback , 
+  char *private , int private_len)
 {
-  REDISENV *pstEnv = NULL;
-  REDIS_GLOBALSPACE *pspace = &redis_global_space;
-  int sld = -1;
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISREPL *prepl = NULL;
+  char *buf = NULL;
   int len = 0;
-  /***Check Basic*/
-  sld = pspace->slog_d;
-  if(sld < 0)
+
+  prepl = _repl_get(gd);
+  if(!prepl)
+    return -1;
+  if(argc<=0 || !argv)
+  {
+    slog_log(pspace->slog_d , SL_ERR , "<%s> failed! arg illegal! gd:%d argc:%d" , __FUNCTION__ , gd , argc);
     return -1;
+  }
 
-  /***Get Env*/
-  pstEnv = penv;
+  //writes take normal path of master
+  if(!_repl_readonly(argv[0] , argvlen? (int)argvlen[0] : (int)strlen(argv[0])))
+    return _exec_argv(prepl->master , argc , argv , argvlen , callback , NULL , private , private_len);
 
-  /***Handle*/
-  redisReply* reply = NULL;
-  int done = -1;
-  int ret = -1;
-  int i = 0;
-  
-  //printf("%s [%d]starts\n" , __FUNCTION__ , pstEnv->id);
-  //is connecting
-  if(pstEnv->flag == REDIS_CONN_FLG_CONNECTING)
+  len = redisFormatCommandArgv(&buf , argc , argv , argvlen);
+  if(len <= 0)
   {
-    if(_check_connect(pstEnv) < 0) //connect failed
-    {
-      _redis_disconnect(pstEnv->id);
-      pstEnv->flag = REDIS_CONN_FLG_FAIL;
-    }
-    return 0;
-  }  
-  
-  if(pstEnv->flag != REDIS_CONN_FLG_CONNECTED)
-    return 0;
+    slog_log(pspace->slog_d , SL_ERR , "<%s> failed! format argv err! gd:%d" , __FUNCTION__ , gd);
+    return -1;
+  }
+  return _repl_send(gd , buf , len , callback , private , private_len);
+}
 
-  //flush output buff
-  while(1)
-  {
-    //if(_fd_writable(pstEnv->hiredis_cxt->fd , 0) == 0)
-    //{
-    //  break;
-    //}
-    
-    //printf("flush output buff\n");
-    ret = redisBufferWrite(pstEnv->hiredis_cxt , &done);
-    if(ret != REDIS_OK)
-    {
-      slog_log(sld , SL_ERR , "<%s> flush output buff failed! err:%s" , __FUNCTION__ , pstEnv->hiredis_cxt->errstr);
-      break;
-    }
-    
-    if(done == 1) //outbuff empty or clear outbuff done==1
-    {      
-      break;
-    }
+int redis_repl_close(int gd)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISREPL *prepl = NULL;
+  REDISENV *penv = NULL;
+  int rd = -1;
+  int i = 0;
 
-    if(done==0 && errno == EAGAIN) //rediusBuffWrite write,but not all(done==0) because send buff full(errno==EAGAIN)
-    {
-      slog_log(sld , SL_INFO , "<%s> sendbuff full and will write again!" , __FUNCTION__);
-      break;
-    }
-    
-  }
+  prepl = _repl_get(gd);
+  if(!prepl)
+    return -1;
 
-  //check fd readable
-  if(_fd_readable(pstEnv->hiredis_cxt->fd, 0) == 0)
+  //members closed by app are skipped quietly
+  for(i=-1; i<prepl->count; i++)
   {
-    return 0;
+    rd = i<0? prepl->master : prepl->replicas[i];
+    if(rd<0 || !pspace->env_list || pspace->list_len<0 || rd>=(int)pow(2 , pspace->list_len))
+      continue;
+    penv = &pspace->env_list[rd];
+    if(penv->stat!=REDIS_ENV_STAT_EMPTY && penv->repl==gd+1)
+      penv->repl = 0;
   }
 
-  //read response from server
-  while(1)
+  free(prepl->replicas);
+  free(prepl->samples);
+  memset(prepl , 0 , sizeof(REDISREPL));
+  pspace->repl_count--;
+  if(pspace->repl_count <= 0)
   {
-    //check input data available
-    //if(_fd_readable(pstEnv->hiredis_cxt->fd, 0) == 0)
-    //    break;
-
-    //printf("%s read sock!\n" , __FUNCTION__);
-    //read
-    ret = redisBufferRead(pstEnv->hiredis_cxt);
-    if(ret != REDIS_OK)
-    {
-      slog_log(sld , SL_ERR , "<%s> read response failed! err:%s" , __FUNCTION__ , pstEnv->hiredis_cxt->errstr);
-      break;
-    }
-    if(errno == EAGAIN) //redisBufferRead will return REDIS_OK even errno==EAGAIN
-    {
-      //printf("%s no more data!\n" , __FUNCTION__);
-      break;
-    }
-    
+    free(pspace->repl_list);
+    pspace->repl_list = NULL;
+    pspace->repl_len = 0;
+    pspace->repl_count = 0;
+  }
+  return 0;
+}
 
-    //try to construct a full package consistly
-    for(;;)
-    {
-      ret = redisGetReplyFromReader(pstEnv->hiredis_cxt, (void**)&reply);
-      if(ret != REDIS_OK)
-      {
-        slog_log(sld , SL_ERR , "<%s> get reply error! err:%s" , __FUNCTION__ , pstEnv->hiredis_cxt->errstr);        
-        break;
-      }
+int redis_subscribe(int rd , int count , const char *channels[] , REDIS_SUB_CALLBACK callback , 
+  char *private , int private_len)
+{
+  return _sub_add(rd , 0 , count , channels , callback , private , private_len);
+}
 
-      if(!reply)
-      {
-        slog_log(sld , SL_DEBUG , "<%s> no full reply is recved!" , __FUNCTION__);
-        break;
-      }
+int redis_psubscribe(int rd , int count , const char *patterns[] , REDIS_SUB_CALLBACK callback , 
+  char *private , int private_len)
+{
+  return _sub_add(rd , 1 , count , patterns , callback , private , private_len);
+}
 
-      //handle reply
-      _handle_reply(pstEnv, reply);
-      
-      
-      //destroy reply
-      freeReplyObject(reply);
-      
-    } //end for:get reply
-        
-  } //end while:reading
-  
-  return 0;
+int redis_unsubscribe(int rd , int count , const char *channels[])
+{
+  return _sub_del(rd , 0 , count , channels);
 }
 
+int redis_punsubscribe(int rd , int count , const char *patterns[])
+{
+  return _sub_del(rd , 1 , count , patterns);
+}
 
-//Activated by main_process tick or circle
-static int _redis_tick_multi(REDISENV *env_list[] , int env_count)
+REDIS_CONN_FLAG redis_isconnect(int rd)
 {
-  REDISENV *handle_env[REDIS_MAX_OPEN_NUM] = {NULL};
-  int fd_count = 0;
   REDISENV *pstEnv = NULL;
-  REDIS_GLOBALSPACE *pspace = &redis_global_space;
-  int sld = -1;
-  fd_set rset; // only check read fd
-  
-  struct timeval tv = {0 , 1000}; //1ms  
-  redisReply* reply = NULL;
-  int done = -1;
-  int ret = -1;
-  int i = 0;
-  int max_fd = 0;
-  int ready = 0;
-  int checked = 0;
+  pstEnv = NULL;
 
-  char buf[1024*16];
-  int nread;
+  /***Get Env*/
+  pstEnv = _rd2env(rd, __FUNCTION__);
+  if(!pstEnv)
+    return REDIS_CONN_FLG_FAIL;
+
+  //if(!pstEnv->conn && pstEnv->run)
+  //  return 1;
+  //if(pstEnv->flag == REDIS_ENV_FLG_CONNECTED)
+  //  return 1;
   
+
+  return pstEnv->flag;
+}
+
+//Activated by main_process tick or circle
+int redis_set_flush(int rd , REDIS_FLUSH_POLICY policy , int flush_bytes)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISENV *penv = NULL;
+
   /***Check Basic*/
-  sld = pspace->slog_d;
-  if(sld < 0)
+  if(pspace->slog_d < 0)
     return -1;
 
-  if(env_count <= 0)
-    return 0;
+  if(policy<REDIS_FLUSH_TICK || policy>REDIS_FLUSH_BYTES || (policy==REDIS_FLUSH_BYTES && flush_bytes<=0))
+  {
+    slog_log(pspace->slog_d , SL_ERR , "<%s> failed! arg illegal! rd:%d policy:%d bytes:%d" , __FUNCTION__ , rd , 
+      policy , flush_bytes);
+    return -1;
+  }
 
+  /***Get Env*/
+  penv = _rd2env(rd, __FUNCTION__);
+  if(!penv)
+    return -1;
 
-  /***Init*/    
-  FD_ZERO(&rset);
-  
-  /***Check Eeach Env*/
-  for(i=0; i<env_count; i++)
-  {
-    pstEnv = env_list[i];
-    //printf("%s [%d] 1st starts\n" , __FUNCTION__ , pstEnv->id);
-    slog_log(sld , SL_VERBOSE , "<%s> 1st [%d] starts" , __FUNCTION__ , pstEnv->id);
-    //is connecting
-    if(pstEnv->flag == REDIS_CONN_FLG_CONNECTING)
-    {
-      if(_check_connect(pstEnv) < 0) //connect failed
-      {
-        _redis_disconnect(pstEnv->id);
-        pstEnv->flag = REDIS_CONN_FLG_FAIL;
-      }
-      continue;
-    }
+  penv->flush_policy = policy;
+  penv->flush_bytes = flush_bytes;
+  return 0;
+}
 
-    //check connected
-    if(pstEnv->flag != REDIS_CONN_FLG_CONNECTED)
-      continue;
-    
-    //check fd
-    handle_env[fd_count] = pstEnv;
-    FD_SET(pstEnv->hiredis_cxt->fd , &rset);    
-    fd_count++;
+int redis_set_reconnect(int rd , int min_ms , int max_ms)
+{
+  REDISENV *penv = NULL;
 
-    //max fd
-    if(pstEnv->hiredis_cxt->fd > max_fd)
-      max_fd = pstEnv->hiredis_cxt->fd;
+  /***Get Env*/
+  penv = _rd2env(rd, __FUNCTION__);
+  if(!penv)
+    return -1;
 
-    //flush output buff
-    while(1)
-    {
-      //printf("flush output buff\n");
-      ret = redisBufferWrite(pstEnv->hiredis_cxt , &done);
-      if(ret != REDIS_OK)
-      {
-        slog_log(sld , SL_ERR , "<%s> flush output buff failed! rd:%d fd:%d err:%s" , __FUNCTION__ , 
-          pstEnv->id , pstEnv->hiredis_cxt->fd , pstEnv->hiredis_cxt->errstr);
-        break;
-      }
-      
-      if(done == 1) //outbuff empty or clear outbuff done==1
-      {
-        //printf("buffer empty!\n");
-        slog_log(sld , SL_VERBOSE , "<%s> output buffer empty! rd:%d" , __FUNCTION__ , pstEnv->id);
-        break;
-      }
-  
-      if(done==0 && errno == EAGAIN) //rediusBuffWrite write,but not all(done==0) because of send buff full(errno==EAGAIN)
-      {
-        slog_log(sld , SL_INFO , "<%s> sendbuff full and will write again! rd:%d" , __FUNCTION__ , 
-          pstEnv->id);
-        break;
-      }      
-    }  
+  if(min_ms <= 0)
+  {
+    penv->reconn_min = 0;
+    penv->reconn_max = 0;
+    penv->reconn_at_ms = 0;
+    return 0;
   }
 
-  /***check valid fd*/
-  if(fd_count <= 0)
-    return 0;
-    
-  /***Select All Connected FD*/  
-  ready = select(max_fd+1 , &rset , NULL , NULL , &tv);
-  slog_log(sld, SL_VERBOSE, "<%s> 2nd select return:%d" , __FUNCTION__ , ready);
-  if(ready < 0)
+  penv->reconn_min = min_ms;
+  penv->reconn_max = max_ms<min_ms? min_ms : max_ms;
+  return 0;
+}
+
+int redis_set_limit(int rd , REDIS_LIMIT *limit)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISENV *penv = NULL;
+
+  /***Check Basic*/
+  if(pspace->slog_d < 0)
+    return -1;
+
+  if(limit && (limit->max_pending<0 || limit->max_obuf<0 || limit->max_ibuf<0 || limit->max_queue<0 || 
+    limit->policy<REDIS_LIMIT_FAIL || limit->policy>REDIS_LIMIT_SHED))
   {
-    slog_log(sld, SL_ERR, "<%s> 2nd select failed! err:%s", __FUNCTION__ , strerror(errno));
+    slog_log(pspace->slog_d , SL_ERR , "<%s> failed! arg illegal! rd:%d" , __FUNCTION__ , rd);
     return -1;
   }
 
-  /***For Each FD*/
-  for(i=0; i<fd_count && checked<ready; i++)
-  {
-    pstEnv = handle_env[i];
-    if(!FD_ISSET(pstEnv->hiredis_cxt->fd , &rset))
-      continue;
+  /***Get Env*/
+  penv = _rd2env(rd, __FUNCTION__);
+  if(!penv)
+    return -1;
 
-    checked++;    
-    //read response from server
-    while(1)
-    {
-    
-      //printf("%s read sock:%d!\n" , __FUNCTION__ , pstEnv->hiredis_cxt->fd);
-      slog_log(sld , SL_VERBOSE , "%s read rd:%d sock:%d!" , __FUNCTION__ , pstEnv->id , pstEnv->hiredis_cxt->fd);
+  if(limit)
+    memcpy(&penv->limit , limit , sizeof(REDIS_LIMIT));
+  else
+    memset(&penv->limit , 0 , sizeof(REDIS_LIMIT));
 
-      //read fd[mainly from redisBufferRead]
-      nread = read(pstEnv->hiredis_cxt->fd,buf,sizeof(buf));
-      if(nread == -1) //
-      {
-        if(errno==EAGAIN) //no more data
-        {
-          slog_log(sld , SL_VERBOSE , "<%s> read no more data! rd:%d msg:%s" , __FUNCTION__ , pstEnv->id , strerror(errno));
-        }
-        else
-        {
-          slog_log(sld , SL_VERBOSE , "<%s> read failed! rd:%d msg:%s" , __FUNCTION__ , pstEnv->id , strerror(errno));  
-        }
-        break;
-      }
-      else if(nread == 0) //server closed. 
-      {
-        slog_log(sld, SL_INFO, "<%s> server shutdown connection! rd:%d", __FUNCTION__ , pstEnv->id);
-        _redis_disconnect(pstEnv->id);
-        pstEnv->flag = REDIS_CONN_FLG_CLOSED;
-        break;
-      }
-      else //read some data
-      {
-        if (redisReaderFeed(pstEnv->hiredis_cxt->reader,buf,nread) != REDIS_OK) 
-        {
-            slog_log(sld , SL_ERR , "%s call redisReaderFeed failed! rd:%d fd:%d" , __FUNCTION__ , pstEnv->id , 
-              pstEnv->hiredis_cxt->fd);
-            break;
-        }
-      }
-      
-      /* old code
-      //read
-      ret = redisBufferRead(pstEnv->hiredis_cxt);
-      if(ret != REDIS_OK)
-      {
-        slog_log(sld , SL_ERR , "<%s> read response failed! rd:%d fd:%d err:%s" , __FUNCTION__ , 
-          pstEnv->id , pstEnv->hiredis_cxt->fd , pstEnv->hiredis_cxt->errstr);
-        break;
-      }
-      if(errno == EAGAIN) //redisBufferRead will return REDIS_OK even errno==EAGAIN
-      {
-        printf("%s no more data!\n" , __FUNCTION__);
-        slog_log(sld , SL_VERBOSE , "%s no more data! rd:%d fd:%d" , __FUNCTION__ , pstEnv->id , 
-          pstEnv->hiredis_cxt->fd);
-        break;
-      }*/
-      
-  
-      //try to construct a full package consistly
-      for(;;)
-      {
-        ret = redisGetReplyFromReader(pstEnv->hiredis_cxt, (void**)&reply);
-        if(ret != REDIS_OK)
-        {
-          slog_log(sld , SL_ERR , "<%s> get reply error! rd:%d fd:%d err:%s" , __FUNCTION__ , 
-            pstEnv->id , pstEnv->hiredis_cxt->fd , pstEnv->hiredis_cxt->errstr);        
-          break;
-        }
-  
-        if(!reply)
-        {
-          slog_log(sld , SL_DEBUG , "<%s> no full reply is recved! rd:%d" , __FUNCTION__ , 
-            pstEnv->id);
-          break;
-        }
+  //limits may be raised
+  if(penv->hiredis_cxt && penv->ov_cnt>0)
+    _ov_release(penv);
+  return 0;
+}
 
-        slog_log(sld , SL_VERBOSE , "<%s> full reply is recved! rd:%d" , __FUNCTION__ , 
-            pstEnv->id);
-        //handle reply
-        _handle_reply(pstEnv, reply);
-                
-        //destroy reply
-        freeReplyObject(reply);
-        
-      } //end for:get reply
-          
-    } //end while:reading
-    
+int redis_get_fill(int rd , REDIS_FILL *fill)
+{
+  REDISENV *penv = NULL;
+
+  if(!fill)
+    return -1;
+
+  /***Get Env*/
+  penv = _rd2env(rd, __FUNCTION__);
+  if(!penv)
+    return -1;
+
+  memset(fill , 0 , sizeof(REDIS_FILL));
+  fill->pending = penv->cb_count - penv->ov_cnt;
+  fill->queued = penv->ov_cnt;
+  if(penv->hiredis_cxt)
+  {
+    fill->obuf = (int)_env_obuf(penv);
+    fill->ibuf = (int)_env_ibuf(penv);
   }
-    
   return 0;
 }
 
+int redis_set_exec_flag(int rd , int flags)
+{
+  REDISENV *penv = NULL;
+
+  /***Get Env*/
+  penv = _rd2env(rd, __FUNCTION__);
+  if(!penv)
+    return -1;
 
+  penv->exec_flags = flags;
+  return 0;
+}
 
+int redis_tick()
+{
+  return redis_tick_budget(0 , 0)<0? -1 : 0;
+}
 
-static int _handle_reply(REDISENV *pstEnv , redisReply *pstReply)
+int redis_tick_budget(int max_replies , int max_usec)
 {
-  REDIS_GLOBALSPACE *pspace = &redis_global_space;
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISENV *pstEnv = NULL;
+  int i = -1;
+  int real_len = 0;
+  int valid_check = 0;
+  long long curr_ms = 0;
 
-  int result = CB_RET_SUCCESS;
-  int argc = 0;
-  char *_argv[DEFAULT_ARG_COUNT] = {0};
-  char **argv = _argv;
+  if(max_replies<0 || max_usec<0)
+    return -1;
+  pspace->budget_max = max_replies;
+  pspace->budget_used = 0;
+  pspace->budget_end_us = max_usec>0? _now_us()+max_usec : 0;
+  pspace->budget_out = 0;
   
-  int _arglen[DEFAULT_ARG_COUNT] = {0};
-  int *arglen = _arglen;
+  //gathers and hedges whose cmds were dropped by close or disconnect
+  if(pspace->gather_done)
+    _gather_flush();
+  if(pspace->hedge_done)
+    _hedge_flush();
 
-  char buff[128] = {0};
-  CBINFO *pstCBInfo = NULL;
-  int i = 0;
-  char alloc = 0; //if use calloc function
-  int sld = pspace->slog_d;
-  
-  /***Arg Check*/
-  if(!pstEnv || !pstReply)
+  //empty list. sends of closed rds may still be in flight
+  if(!pspace->env_list || pspace->list_len < 0)
+  {
+    if(pspace->uring && pspace->uring->orphans>0)
+      _redis_tick_uring();
+    else if(pspace->waiting && pspace->epfd>=0 && pspace->wait_ms!=0) //only wakeup may come
+    {
+      if(epoll_wait(pspace->epfd , pspace->ev_list , REDIS_MAX_OPEN_NUM , pspace->wait_ms) > 0)
+        _wake_drain();
+    }
+    return 0;
+  }
+
+  //connecting deadline check.[no syscall. completion reported by epoll]
+  curr_ms = _now_ms();
+  real_len = (int)pow(2 , pspace->list_len);
+  for(i=0; i<real_len && valid_check<pspace->valid_count; i++)
+  {
+    if(!pspace->env_list) //all closed by callback
+      return 0;
+    pstEnv = &pspace->env_list[i];
+    if(pstEnv->stat == REDIS_ENV_STAT_EMPTY)
+      continue;
+    valid_check++;
+
+    //managed reconnect
+    if(pstEnv->reconn_min>0 && (pstEnv->flag==REDIS_CONN_FLG_FAIL || pstEnv->flag==REDIS_CONN_FLG_CLOSED))
+    {
+      _env_backoff(pstEnv , curr_ms);
+      continue;
+    }
+
+    if(pstEnv->flag != REDIS_CONN_FLG_CONNECTING)
+      continue;
+
+    if(curr_ms >= pstEnv->connect_end_ms)
+    {
+      slog_log(pspace->slog_d , SL_ERR , "<%s> connect timeout!rd:%d" , __FUNCTION__ , pstEnv->id);
+      _redis_disconnect(pstEnv->id);
+      pstEnv->flag = REDIS_CONN_FLG_FAIL;
+    }
+  }
+
+  //replies left by budget of last tick go first
+  if(pspace->backlog_cnt > 0)
+    _env_resume();
+  if(!pspace->env_list) //all closed by callback
+    return 0;
+
+  //connecting and connected rd only handled when ready
+  if(pspace->uring)
+    _redis_tick_uring();
+  else
+    _redis_tick_epoll();
+
+  //reload slot map of clusters
+  if(pspace->cluster_count > 0)
+    _cluster_tick(curr_ms);
+
+  //rebalance shard groups on member down or back
+  if(pspace->shard_count > 0)
+    _shard_tick();
+
+  //cmd timeouts
+  if(pspace->wheel.active > 0)
+    _timer_advance(_now_ms());
+  else
+    pspace->wheel.now_ms = curr_ms;
+
+  //reactor of exported epfd wakes on next deadline
+  if(pspace->pollfd_on)
+    _pollfd_arm();
+
+  //completions not reaped count as work too
+  if(pspace->backlog_cnt > 0)
+    return 1;
+  if(pspace->uring && (pspace->uring->stash_len>0 || 
+    *pspace->uring->cq_head!=__atomic_load_n(pspace->uring->cq_tail , __ATOMIC_ACQUIRE)))
+    return 1;
+  return 0;
+}
+
+int redis_wait(int timeout_ms)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  int ret = 0;
+
+  if(pspace->waiting) //from callback of a wait
     return -1;
+  pspace->waiting = 1;
+  pspace->wait_ms = timeout_ms<0? -1 : timeout_ms;
+  ret = redis_tick_budget(0 , 0);
+  pspace->waiting = 0;
+  return ret<0? -1 : 0;
+}
 
-  /***POP CBFUNC*/
-  pstCBInfo = _hpop_cbi(pstEnv);
-  if(!pstCBInfo)
+int redis_wakeup(redis_ctx_t *ctx)
+{
+  REDIS_GLOBALSPACE *pspace = ctx? ctx : &redis_global_space;
+
+  //wake_fd is stored before epfd is published
+  if(__atomic_load_n(&pspace->epfd , __ATOMIC_ACQUIRE) < 0)
+    return -1;
+  return _wake(pspace);
+}
+
+int redis_get_pollfd()
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  struct epoll_event ev;
+
+  if(pspace->epfd < 0)
+    return -1;
+  if(pspace->pollfd_on)
+    return pspace->epfd;
+
+  //deadlines of timers and connecting make epfd readable too
+  memset(&ev , 0 , sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.u32 = REDIS_TIMER_EVENT;
+  pspace->timer_fd = timerfd_create(CLOCK_MONOTONIC , TFD_NONBLOCK|TFD_CLOEXEC);
+  if(pspace->timer_fd<0 || epoll_ctl(pspace->epfd , EPOLL_CTL_ADD , pspace->timer_fd , &ev)<0)
   {
-    slog_log(sld , SL_ERR , "<%s>:drop response for cb null! rd:%d fd:%d" , __FUNCTION__ , pstEnv->id , 
-      pstEnv->hiredis_cxt->fd);
+    slog_log(pspace->slog_d , SL_ERR , "<%s> failed! create timerfd error! err:%s" , __FUNCTION__ , strerror(errno));
+    if(pspace->timer_fd >= 0)
+      close(pspace->timer_fd);
     return -1;
   }
-  
-  /***Construct Args*/
-  slog_log(sld , SL_VERBOSE , "<%s> reply type:%d rd:%d" , __FUNCTION__ , pstReply->type , pstEnv->id);
-  switch(pstReply->type)
+
+  //completions of io_uring signal wake_fd which is in epfd
+  if(pspace->uring && _uring_notify(pspace)<0)
   {
-    case REDIS_REPLY_STRING:
-    case REDIS_REPLY_STATUS:    
-      slog_log(sld , SL_VERBOSE , "result:%s" , pstReply->str);
-      argv[argc] = pstReply->str;
-      arglen[argc] = pstReply->len;
-      argc++;
-    break;
+    epoll_ctl(pspace->epfd , EPOLL_CTL_DEL , pspace->timer_fd , NULL);
+    close(pspace->timer_fd);
+    return -1;
+  }
 
-    case REDIS_REPLY_INTEGER:
-      slog_log(sld , SL_VERBOSE , "result:%d" , pstReply->integer);
-      snprintf(buff , sizeof(buff) , "%lld" , pstReply->integer);
-      argv[argc] = buff;
-      arglen[argc] = strlen(buff);
-      argc++;
-    break;
+  pspace->pollfd_on = 1;
+  pspace->timer_at = -1;
+  _pollfd_arm();
+  slog_log(pspace->slog_d , SL_INFO , "<%s> success! epfd:%d" , __FUNCTION__ , pspace->epfd);
+  return pspace->epfd;
+}
 
-    case REDIS_REPLY_ERROR:    
-      slog_log(sld , SL_VERBOSE , "result:%s" , pstReply->str);
-      result = CB_RET_ERROR;
-      argv[argc] = pstReply->str; //error info
-      arglen[argc] = pstReply->len;
-      argc++;
-    break;
+int redis_set_exec_timeout(int rd , int timeout_ms , int recycle)
+{
+  REDISENV *penv = NULL;
 
-    case REDIS_REPLY_NIL:
-      slog_log(sld , SL_VERBOSE , "result empty");
-      result = CB_RET_NO_NIL;
-    break;
- 
-    case REDIS_REPLY_ARRAY:
-      //check if need alloc mem for argv and arglen
-      if(pstReply->elements > DEFAULT_ARG_COUNT) 
-      {
-        argv = NULL;
-        arglen = NULL;
+  if(timeout_ms < 0)
+    return -1;
 
-        alloc = 1;
-        argv = (char **)calloc(pstReply->elements , sizeof(char *));
-        if(!argv)
-        {
-          slog_log(sld , SL_ERR , "<%s> calloc argv failed! rd:%d fd:%d err:%s" , __FUNCTION__ , pstEnv->id , 
-            pstEnv->hiredis_cxt->fd , strerror(errno));
-          goto _destroy;
-        }
+  /***Get Env*/
+  penv = _rd2env(rd, __FUNCTION__);
+  if(!penv)
+    return -1;
 
-        arglen = (int *)calloc(pstReply->elements , sizeof(int));
-        if(!argv)
-        {
-          slog_log(sld , SL_ERR , "<%s> calloc arglen failed! rd:%d fd:%d err:%s" , __FUNCTION__ , pstEnv->id , 
-            pstEnv->hiredis_cxt->fd , strerror(errno));
-          goto _destroy;
-        }
-      }
+  penv->exec_timeout = timeout_ms;
+  penv->timeout_recycle = recycle? 1 : 0;
+  return 0;
+}
 
-      //construct argc , argv and arglen
-      for(i=0; i<pstReply->elements; i++)
-      {
-        slog_log(sld , SL_VERBOSE , "[%d] %s" , i , pstReply->element[i]->str);
-        argv[argc] = pstReply->element[i]->str;
-        arglen[argc] = pstReply->element[i]->len;
-        argc++;
-      }
-    break;
-    default:
-      snprintf(buff , sizeof(buff) , "illegal reply type:%d" , pstReply->type);
-      result = CB_RET_ERROR;
-      argv[argc] = buff; //error info
-      arglen[argc] = strlen(buff);
-      argc++;
-      slog_log(sld , SL_FATAL , "<%s> can not handle it right now! rd:%d fd:%d" , __FUNCTION__ , pstEnv->id , 
-        pstEnv->hiredis_cxt->fd);
-    break;
+int redis_exec(int rd , char *cmd , REDIS_CALLBACK callback , char *private , int private_len)
+{
+  return _exec_str(rd , cmd , callback , NULL , private , private_len);
+}
+
+int redis_execv(int rd , int argc , const char *argv[] , const size_t argvlen[] , REDIS_CALLBACK callback , 
+  char *private , int private_len)
+{
+  return _exec_argv(rd , argc , argv , argvlen , callback , NULL , private , private_len);
+}
+
+int redis_exec_typed(int rd , char *cmd , REDIS_REPLY_CALLBACK callback , char *private , int private_len)
+{
+  return _exec_str(rd , cmd , NULL , callback , private , private_len);
+}
+
+int redis_execv_typed(int rd , int argc , const char *argv[] , const size_t argvlen[] , 
+  REDIS_REPLY_CALLBACK callback , char *private , int private_len)
+{
+  return _exec_argv(rd , argc , argv , argvlen , NULL , callback , private , private_len);
+}
+
+int redis_exec_cmd_typed(int rd , redis_cmd_t *cmd , REDIS_REPLY_CALLBACK callback , char *private , 
+  int private_len)
+{
+  return _exec_built(rd , cmd , NULL , callback , private , private_len);
+}
+
+//exec of cmd string. callback or reply_func is set when cmd is queued
+//return 0:success -1:failed
+static int _exec_str(int rd , char *cmd , REDIS_CALLBACK callback , REDIS_REPLY_CALLBACK reply_func , 
+  char *private , int private_len)
+{ 
+  int ret = -1;
+  REDISENV *pstEnv = NULL;
+  char *ptr = NULL;
+
+  int sld = -1;
+  REDIS_GLOBALSPACE *pspace = redis_space;
+
+  /***Check Basic*/
+  sld = pspace->slog_d;
+  if(sld < 0)
+    return -1;
+
+  /***Get Env*/
+  pstEnv = _rd2env(rd, __FUNCTION__);
+  if(!pstEnv)
+    return -1;
+
+  slog_log(sld, SL_DEBUG, "<%s> starts. rd:%d cmd:%s",__FUNCTION__ , rd , cmd);
+  /***Env Check*/
+  if(pstEnv->flag!=REDIS_CONN_FLG_CONNECTED || !pstEnv->hiredis_cxt)
+  {
+    slog_log(sld , SL_ERR , "<%s>:%s failed! not connected!rd:%d flag:%d" , __FUNCTION__ , cmd , rd , 
+      pstEnv->flag);
+    return -1;
   }
+
+  /***Save CallBack*/
+  if(!_save_cb(pstEnv , callback , reply_func , private , private_len))
+    return -1;
   
-  /***Call CallBack Function*/
-  if(pstCBInfo->stat == CB_INFO_STAT_VALID)
+  //Append Command
+  ret = redisAppendCommand(pstEnv->hiredis_cxt, cmd);
+  if(ret != REDIS_OK)
   {
-    slog_log(sld , SL_VERBOSE , "exe call back! rd:%d" , pstEnv->id);
-    (*pstCBInfo->func)(pstCBInfo->private , pstCBInfo->private_len , result , argc , argv , arglen);
+    slog_log(sld , SL_ERR , "<%s>:%s failed! err:%s rd:%d" , __FUNCTION__ , cmd , pstEnv->hiredis_cxt->errstr, rd);
+    _tcancel_cbi(pstEnv);
+    return -1;
   }
-  else
-    slog_log(sld , SL_VERBOSE , "no call back! rd:%d" , pstEnv->id);
 
-  /***Destroy ALLOCTED MEM*/
-_destroy:
-  if(alloc)
+  _env_appended(pstEnv);
+  return 0;
+}
+
+//exec of binary safe args
+//return 0:success -1:failed
+static int _exec_argv(int rd , int argc , const char *argv[] , const size_t argvlen[] , REDIS_CALLBACK callback , 
+  REDIS_REPLY_CALLBACK reply_func , char *private , int private_len)
+{
+  REDISENV *pstEnv = NULL;
+  int sld = -1;
+  REDIS_GLOBALSPACE *pspace = redis_space;
+
+  /***Check Basic*/
+  sld = pspace->slog_d;
+  if(sld < 0)
+    return -1;
+
+  if(argc<=0 || !argv)
+  {
+    slog_log(sld , SL_ERR , "<%s> failed! arg illegal! rd:%d argc:%d" , __FUNCTION__ , rd , argc);
+    return -1;
+  }
+
+  /***Get Env*/
+  pstEnv = _rd2env(rd, __FUNCTION__);
+  if(!pstEnv)
+    return -1;
+
+  /***Env Check*/
+  if(pstEnv->flag!=REDIS_CONN_FLG_CONNECTED || !pstEnv->hiredis_cxt)
+  {
+    slog_log(sld , SL_ERR , "<%s> failed! not connected!rd:%d flag:%d" , __FUNCTION__ , rd , pstEnv->flag);
+    return -1;
+  }
+
+  /***Save CallBack*/
+  if(!_save_cb(pstEnv , callback , reply_func , private , private_len))
+    return -1;
+
+  //Encode Into Output Buff Directly
+  if(_append_argv(pstEnv , argc , argv , argvlen) < 0)
+  {
+    _tcancel_cbi(pstEnv);
+    return -1;
+  }
+
+  _env_appended(pstEnv);
+  return 0;
+}
+
+int redis_reply_type(const redis_reply_t *reply)
+{
+  return reply? reply->type : REDIS_REPLY_NIL;
+}
+
+long long redis_reply_integer(const redis_reply_t *reply)
+{
+  if(!reply)
+    return 0;
+  if(reply->type==REDIS_REPLY_INTEGER || reply->type==REDIS_REPLY_BOOL)
+    return reply->integer;
+  return 0;
+}
+
+double redis_reply_double(const redis_reply_t *reply)
+{
+  if(!reply)
+    return 0;
+  if(reply->type == REDIS_REPLY_DOUBLE)
+    return reply->dval;
+  if(reply->type == REDIS_REPLY_INTEGER)
+    return (double)reply->integer;
+  return 0;
+}
+
+const char *redis_reply_str(const redis_reply_t *reply , int *len)
+{
+  if(!reply || !reply->str)
+  {
+    if(len)
+      *len = 0;
+    return NULL;
+  }
+  if(len)
+    *len = reply->len;
+  return reply->str;
+}
+
+int redis_reply_count(const redis_reply_t *reply)
+{
+  if(!reply || !reply->element)
+    return 0;
+  return reply->len;
+}
+
+const redis_reply_t *redis_reply_elem(const redis_reply_t *reply , int idx)
+{
+  if(idx<0 || idx>=redis_reply_count(reply))
+    return NULL;
+  return reply->element[idx];
+}
+
+void redis_reply_iter_init(redis_reply_iter_t *iter , const redis_reply_t *reply)
+{
+  iter->reply = reply;
+  iter->idx = 0;
+}
+
+const redis_reply_t *redis_reply_next(redis_reply_iter_t *iter)
+{
+  if(iter->idx >= redis_reply_count(iter->reply))
+    return NULL;
+  return iter->reply->element[iter->idx++];
+}
+
+int redis_reply_next_pair(redis_reply_iter_t *iter , const redis_reply_t **key , const redis_reply_t **value)
+{
+  if(iter->idx+1 >= redis_reply_count(iter->reply))
+    return 0;
+  *key = iter->reply->element[iter->idx++];
+  *value = iter->reply->element[iter->idx++];
+  return 1;
+}
+
+redis_cmd_t *redis_cmd_new(int init_size)
+{
+  redis_cmd_t *cmd = NULL;
+
+  if(init_size <= 0)
+    init_size = REDIS_CMD_DEFAULT_SIZE;
+
+  cmd = (redis_cmd_t *)calloc(1 , sizeof(redis_cmd_t));
+  if(!cmd)
+    return NULL;
+
+  cmd->size = REDIS_CMD_HEAD_LEN + init_size;
+  cmd->buf = (char *)malloc(cmd->size);
+  if(!cmd->buf)
+  {
+    free(cmd);
+    return NULL;
+  }
+  return cmd;
+}
+
+void redis_cmd_reset(redis_cmd_t *cmd)
+{
+  if(!cmd)
+    return;
+  cmd->len = 0;
+  cmd->argc = 0;
+}
+
+void redis_cmd_free(redis_cmd_t *cmd)
+{
+  if(!cmd)
+    return;
+  free(cmd->buf);
+  free(cmd);
+}
+
+int redis_cmd_append_bulk(redis_cmd_t *cmd , const char *data , int len)
+{
+  char *p = NULL;
+  char num[32];
+  int nlen = 0;
+
+  if(!cmd || (!data && len>0) || len<0)
+    return -1;
+
+  //$<len>\r\n<data>\r\n
+  nlen = _ll2str(num , len);
+  if(_cmd_reserve(cmd , 1+nlen+2+len+2) < 0)
+    return -1;
+
+  p = cmd->buf + REDIS_CMD_HEAD_LEN + cmd->len;
+  *p++ = '$';
+  memcpy(p , num , nlen);
+  p += nlen;
+  *p++ = '\r';
+  *p++ = '\n';
+  if(len > 0)
+    memcpy(p , data , len);
+  p += len;
+  *p++ = '\r';
+  *p++ = '\n';
+
+  cmd->len += 1+nlen+2+len+2;
+  cmd->argc++;
+  return 0;
+}
+
+int redis_cmd_append_str(redis_cmd_t *cmd , const char *str)
+{
+  if(!str)
+    return -1;
+  return redis_cmd_append_bulk(cmd , str , strlen(str));
+}
+
+int redis_cmd_append_int(redis_cmd_t *cmd , long long value)
+{
+  char num[32];
+  return redis_cmd_append_bulk(cmd , num , _ll2str(num , value));
+}
+
+int redis_exec_cmd(int rd , redis_cmd_t *cmd , REDIS_CALLBACK callback , char *private , int private_len)
+{
+  return _exec_built(rd , cmd , callback , NULL , private , private_len);
+}
+
+//exec of built cmd
+//return 0:success -1:failed
+static int _exec_built(int rd , redis_cmd_t *cmd , REDIS_CALLBACK callback , REDIS_REPLY_CALLBACK reply_func , 
+  char *private , int private_len)
+{
+  REDISENV *pstEnv = NULL;
+  int sld = -1;
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  char *head = NULL;
+  int nlen = 0;
+
+  /***Check Basic*/
+  sld = pspace->slog_d;
+  if(sld < 0)
+    return -1;
+
+  if(!cmd || cmd->argc<=0)
+  {
+    slog_log(sld , SL_ERR , "<%s> failed! cmd empty! rd:%d" , __FUNCTION__ , rd);
+    return -1;
+  }
+
+  /***Get Env*/
+  pstEnv = _rd2env(rd, __FUNCTION__);
+  if(!pstEnv)
+    return -1;
+
+  /***Env Check*/
+  if(pstEnv->flag!=REDIS_CONN_FLG_CONNECTED || !pstEnv->hiredis_cxt)
+  {
+    slog_log(sld , SL_ERR , "<%s> failed! not connected!rd:%d flag:%d" , __FUNCTION__ , rd , pstEnv->flag);
+    return -1;
+  }
+
+  /***Save CallBack*/
+  if(!_save_cb(pstEnv , callback , reply_func , private , private_len))
+    return -1;
+
+  //one copy into output buff
+  head = _cmd_head(cmd , &nlen);
+  if(redisAppendFormattedCommand(pstEnv->hiredis_cxt , head , nlen) != REDIS_OK)
+  {
+    slog_log(sld , SL_ERR , "<%s> failed! err:%s rd:%d" , __FUNCTION__ , pstEnv->hiredis_cxt->errstr, rd);
+    _tcancel_cbi(pstEnv);
+    return -1;
+  }
+
+  _env_appended(pstEnv);
+  return 0;
+}
+
+int redis_exec_batch(int rd , int count , redis_cmd_t *cmds[] , REDIS_BATCH_CALLBACK callback , char *private , 
+  int private_len)
+{
+  REDISENV *pstEnv = NULL;
+  int sld = -1;
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  CBINFO *pstCBInfo = NULL;
+  REPLYNODE **replies = NULL;
+  sds obuf = NULL;
+  char *head = NULL;
+  size_t total = 0;
+  int len = 0;
+  int i = 0;
+
+  /***Check Basic*/
+  sld = pspace->slog_d;
+  if(sld < 0)
+    return -1;
+
+  if(count<=0 || !cmds)
+  {
+    slog_log(sld , SL_ERR , "<%s> failed! arg illegal! rd:%d count:%d" , __FUNCTION__ , rd , count);
+    return -1;
+  }
+
+  for(i=0; i<count; i++)
+  {
+    if(!cmds[i] || cmds[i]->argc<=0)
+    {
+      slog_log(sld , SL_ERR , "<%s> failed! cmd %d empty! rd:%d" , __FUNCTION__ , i , rd);
+      return -1;
+    }
+    _cmd_head(cmds[i] , &len);
+    total += len;
+  }
+  if(total > INT_MAX) //batch is appended and queued as one cmd
+  {
+    slog_log(sld , SL_ERR , "<%s> failed! batch too large! rd:%d len:%lu" , __FUNCTION__ , rd , (unsigned long)total);
+    return -1;
+  }
+
+  /***Get Env*/
+  pstEnv = _rd2env(rd, __FUNCTION__);
+  if(!pstEnv)
+    return -1;
+
+  /***Env Check*/
+  if(pstEnv->flag!=REDIS_CONN_FLG_CONNECTED || !pstEnv->hiredis_cxt)
+  {
+    slog_log(sld , SL_ERR , "<%s> failed! not connected!rd:%d flag:%d" , __FUNCTION__ , rd , pstEnv->flag);
+    return -1;
+  }
+
+  //replies kept here until the last one arrives
+  replies = (REPLYNODE **)calloc(count , sizeof(REPLYNODE *));
+  if(!replies)
+  {
+    slog_log(sld , SL_ERR , "<%s> failed! alloc replies:%d err:%s rd:%d" , __FUNCTION__ , count , strerror(errno) , rd);
+    return -1;
+  }
+
+  /***Save CallBack. one slot for whole batch*/
+  pstCBInfo = _save_cb(pstEnv , NULL , NULL , private , private_len);
+  if(!pstCBInfo)
+  {
+    free(replies);
+    return -1;
+  }
+  if(callback)
+    pstCBInfo->stat = CB_INFO_STAT_VALID;
+  pstCBInfo->batch_func = callback;
+  pstCBInfo->batch_n = count;
+  pstCBInfo->batch_reply = replies;
+
+  //whole batch into output buff
+  obuf = sdsMakeRoomFor(pstEnv->hiredis_cxt->obuf , total);
+  if(!obuf)
+  {
+    slog_log(sld , SL_ERR , "<%s> failed! out of memory! rd:%d" , __FUNCTION__ , rd);
+    _tcancel_cbi(pstEnv);
+    return -1;
+  }
+  pstEnv->hiredis_cxt->obuf = obuf;
+  for(i=0; i<count; i++)
+  {
+    head = _cmd_head(cmds[i] , &len);
+    memcpy(obuf+sdslen(obuf) , head , len);
+    sdsIncrLen(obuf , len);
+  }
+
+  _env_appended(pstEnv);
+  return 0;
+}
+
+redis_tpl_t *redis_tpl_compile(const char *tpl)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  redis_tpl_t *ptpl = NULL;
+  TPLOP *pop = NULL;
+  const char *p = NULL;
+  const char *tok = NULL;
+  char lit[1024]; //literal of current token
+  char num[32];
+  int raw_size = 0;
+  int lit_len = 0;
+  int static_len = 0;
+  int first_slot = 0;
+  int argc = 0;
+  int len_op = 0;
+  int type = 0;
+
+  if(!tpl)
+    return NULL;
+
+  ptpl = (redis_tpl_t *)calloc(1 , sizeof(redis_tpl_t));
+  if(!ptpl)
+    return NULL;
+
+  //count args for header
+  for(p=tpl; *p; )
+  {
+    while(*p == ' ')
+      p++;
+    if(!*p)
+      break;
+    argc++;
+    while(*p && *p!=' ')
+      p++;
+  }
+  if(argc <= 0)
+    goto _failed;
+
+  lit[0] = '*';
+  lit_len = 1 + _ll2str(lit+1 , argc);
+  lit[lit_len++] = '\r';
+  lit[lit_len++] = '\n';
+  if(_tpl_raw(ptpl , &raw_size , lit , lit_len) < 0)
+    goto _failed;
+
+  //each token
+  for(p=tpl; *p; )
+  {
+    while(*p == ' ')
+      p++;
+    if(!*p)
+      break;
+
+    //scan token once to know if it has placeholder
+    tok = p;
+    first_slot = ptpl->nslot;
+    static_len = 0;
+    len_op = -1;
+    while(*p && *p!=' ')
+    {
+      if(*p == '%')
+      {
+        if(p[1] != '%')
+          break;
+        p++; //%%
+      }
+      p++;
+    }
+
+    //static token. pre-encode it totally
+    if(!*p || *p==' ')
+    {
+      lit_len = 0;
+      for(p=tok; *p && *p!=' '; p++)
+      {
+        if(lit_len >= (int)sizeof(lit))
+          goto _failed;
+        lit[lit_len++] = *p;
+        if(*p == '%') //%%
+          p++;
+      }
+      num[0] = '$';
+      static_len = 1 + _ll2str(num+1 , lit_len);
+      num[static_len++] = '\r';
+      num[static_len++] = '\n';
+      if(_tpl_raw(ptpl , &raw_size , num , static_len)<0 || _tpl_raw(ptpl , &raw_size , lit , lit_len)<0 || 
+        _tpl_raw(ptpl , &raw_size , "\r\n" , 2)<0)
+        goto _failed;
+      continue;
+    }
+
+    //token with placeholder:$<len> computed when exec
+    if(ptpl->nop+1 >= REDIS_TPL_MAX_OP)
+      goto _failed;
+    len_op = ptpl->nop++;
+    ptpl->ops[len_op].op = TPL_OP_LEN;
+    ptpl->ops[len_op].off = first_slot;
+
+    lit_len = 0;
+    for(p=tok; *p && *p!=' '; p++)
+    {
+      if(*p != '%')
+      {
+        if(lit_len >= (int)sizeof(lit))
+          goto _failed;
+        lit[lit_len++] = *p;
+        continue;
+      }
+
+      //%%
+      if(p[1] == '%')
+      {
+        if(lit_len >= (int)sizeof(lit))
+          goto _failed;
+        lit[lit_len++] = '%';
+        p++;
+        continue;
+      }
+
+      //placeholder
+      if(p[1] == 's')
+      {
+        type = TPL_ARG_S;
+        p += 1;
+      }
+      else if(p[1] == 'b')
+      {
+        type = TPL_ARG_B;
+        p += 1;
+      }
+      else if(p[1] == 'd')
+      {
+        type = TPL_ARG_D;
+        p += 1;
+      }
+      else if(p[1]=='l' && p[2]=='l' && p[3]=='d')
+      {
+        type = TPL_ARG_LLD;
+        p += 3;
+      }
+      else
+      {
+        slog_log(pspace->slog_d , SL_ERR , "<%s> failed! illegal placeholder at:%s tpl:%s" , __FUNCTION__ , p , tpl);
+        goto _failed;
+      }
+
+      if(ptpl->nslot>=REDIS_TPL_MAX_SLOT || ptpl->nop+2>=REDIS_TPL_MAX_OP)
+        goto _failed;
+
+      //literal before placeholder
+      if(lit_len > 0)
+      {
+        if(_tpl_raw(ptpl , &raw_size , lit , lit_len) < 0)
+          goto _failed;
+        static_len += lit_len;
+        lit_len = 0;
+      }
+
+      pop = &ptpl->ops[ptpl->nop++];
+      pop->op = TPL_OP_ARG;
+      pop->type = type;
+      pop->off = ptpl->nslot;
+      ptpl->slot_type[ptpl->nslot++] = type;
+    }
+
+    //literal tail
+    if(lit_len > 0)
+    {
+      if(_tpl_raw(ptpl , &raw_size , lit , lit_len) < 0)
+        goto _failed;
+      static_len += lit_len;
+    }
+    if(_tpl_raw(ptpl , &raw_size , "\r\n" , 2) < 0)
+      goto _failed;
+
+    ptpl->ops[len_op].len = static_len;
+    ptpl->ops[len_op].nslot = ptpl->nslot - first_slot;
+  }
+
+  return ptpl;
+
+_failed:
+  slog_log(pspace->slog_d , SL_ERR , "<%s> failed! tpl:%s" , __FUNCTION__ , tpl);
+  redis_tpl_free(ptpl);
+  return NULL;
+}
+
+void redis_tpl_free(redis_tpl_t *tpl)
+{
+  if(!tpl)
+    return;
+  free(tpl->raw);
+  free(tpl);
+}
+
+int redis_exec_tpl(int rd , redis_tpl_t *tpl , REDIS_CALLBACK callback , char *private , int private_len , ...)
+{
+  REDISENV *pstEnv = NULL;
+  int sld = -1;
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  TPLOP *pop = NULL;
+  va_list ap;
+  const char *slot_ptr[REDIS_TPL_MAX_SLOT];
+  size_t slot_len[REDIS_TPL_MAX_SLOT];
+  char slot_num[REDIS_TPL_MAX_SLOT][24];
+  char num[32];
+  size_t total = 0;
+  size_t len = 0;
+  sds obuf = NULL;
+  char *w = NULL;
+  int i = 0;
+  int j = 0;
+
+  /***Check Basic*/
+  sld = pspace->slog_d;
+  if(sld < 0)
+    return -1;
+
+  if(!tpl)
+    return -1;
+
+  /***Get Env*/
+  pstEnv = _rd2env(rd, __FUNCTION__);
+  if(!pstEnv)
+    return -1;
+
+  /***Env Check*/
+  if(pstEnv->flag!=REDIS_CONN_FLG_CONNECTED || !pstEnv->hiredis_cxt)
+  {
+    slog_log(sld , SL_ERR , "<%s> failed! not connected!rd:%d flag:%d" , __FUNCTION__ , rd , pstEnv->flag);
+    return -1;
+  }
+
+  //fetch variable parts
+  va_start(ap , private_len);
+  for(i=0; i<tpl->nslot; i++)
+  {
+    switch(tpl->slot_type[i])
+    {
+      case TPL_ARG_S:
+        slot_ptr[i] = va_arg(ap , const char *);
+        slot_len[i] = slot_ptr[i]? strlen(slot_ptr[i]) : 0;
+      break;
+      case TPL_ARG_B:
+        slot_ptr[i] = va_arg(ap , const char *);
+        slot_len[i] = va_arg(ap , size_t);
+      break;
+      case TPL_ARG_D:
+        slot_ptr[i] = slot_num[i];
+        slot_len[i] = _ll2str(slot_num[i] , va_arg(ap , int));
+      break;
+      default:
+        slot_ptr[i] = slot_num[i];
+        slot_len[i] = _ll2str(slot_num[i] , va_arg(ap , long long));
+      break;
+    }
+  }
+  va_end(ap);
+
+  //total length
+  total = tpl->raw_len;
+  for(i=0; i<tpl->nop; i++)
+  {
+    pop = &tpl->ops[i];
+    if(pop->op != TPL_OP_LEN)
+      continue;
+    len = pop->len;
+    for(j=0; j<pop->nslot; j++)
+      len += slot_len[pop->off+j];
+    total += 1 + _ll2str(num , (long long)len) + 2 + (len - pop->len);
+  }
+  if(total > INT_MAX) //sdsIncrLen takes int
+  {
+    slog_log(sld , SL_ERR , "<%s> failed! cmd too large! rd:%d len:%lu" , __FUNCTION__ , rd , (unsigned long)total);
+    return -1;
+  }
+
+  /***Save CallBack*/
+  if(!_save_cb(pstEnv , callback , NULL , private , private_len))
+    return -1;
+
+  obuf = sdsMakeRoomFor(pstEnv->hiredis_cxt->obuf , total);
+  if(!obuf)
+  {
+    slog_log(sld , SL_ERR , "<%s> failed! out of memory! rd:%d" , __FUNCTION__ , rd);
+    _tcancel_cbi(pstEnv);
+    return -1;
+  }
+  pstEnv->hiredis_cxt->obuf = obuf;
+
+  //splice static and variable parts
+  w = obuf + sdslen(obuf);
+  for(i=0; i<tpl->nop; i++)
+  {
+    pop = &tpl->ops[i];
+    switch(pop->op)
+    {
+      case TPL_OP_RAW:
+        memcpy(w , tpl->raw+pop->off , pop->len);
+        w += pop->len;
+      break;
+      case TPL_OP_LEN:
+        len = pop->len;
+        for(j=0; j<pop->nslot; j++)
+          len += slot_len[pop->off+j];
+        *w++ = '$';
+        w += _ll2str(w , (long long)len);
+        *w++ = '\r';
+        *w++ = '\n';
+      break;
+      default:
+        memcpy(w , slot_ptr[pop->off] , slot_len[pop->off]);
+        w += slot_len[pop->off];
+      break;
+    }
+  }
+  sdsIncrLen(obuf , (int)total);
+
+  _env_appended(pstEnv);
+  return 0;
+}
+
+/************INNER FUNC DEFINE*****************/
+//open a redis_descriptor for process
+//return >=0:success -1:failed
+//pooled:skip ip:port duplicate check for pool or cluster member or subscriber
+static int _redis_open(char *ip , int port , REDIS_LOG_LEVEL log_level , int pooled)
+{
+  char msg[1024] = {0};
+  int rd = -1;
+  int slog = -1;
+  int real_len = 0;
+  int new_len = 0;
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISENV *penv = NULL;
+  struct epoll_event ev;
+  int ctx_id = 0;
+  char use_uring = 0;
+  int epfd = -1;
+
+  SLOG_OPTION log_option;
+  int i = 0;
+
+
+  //Open Log(Only Once)
+  if(pspace->slog_d < 0)
+  {            
+    //Basic Check And Init. identity and backend chosen before kept
+    ctx_id = pspace->ctx_id;
+    use_uring = pspace->use_uring;
+    memset(pspace , 0 , sizeof(REDIS_GLOBALSPACE));
+    pspace->slog_d = -1;
+    pspace->epfd = -1;
+    pspace->ctx_id = ctx_id;
+    pspace->use_uring = use_uring;
+    if(log_level<REDIS_LOG_DEBUG || log_level>REDIS_LOG_ERR)
+    {
+      printf("<%s> log level err! log_level:%d\n" , __FUNCTION__ , log_level);
+      return -1;
+    }    
+
+    //Open
+    memset(&log_option , 0 , sizeof(SLOG_OPTION));
+    //own file per context. handles of one file would rotate it apart
+    if(ctx_id > 0)
+      snprintf(log_option.type_value._local.log_name , sizeof(log_option.type_value._local.log_name) , "%s.ctx%d" , 
+        REDIS_LOG , ctx_id);
+    else
+      strncpy(log_option.type_value._local.log_name , REDIS_LOG , sizeof(log_option.type_value._local.log_name)-1);
+    log_option.log_degree = REDIS_LOG_DEGREE;
+    log_option.log_size = REDIS_LOG_SIZE;
+    log_option.rotate = REDIS_LOG_ROTATE;
+    log_option.format = REDIS_LOG_FORMAT;
+    
+    pspace->slog_d = slog_open(SLT_LOCAL , log_level , &log_option , msg);
+    if(pspace->slog_d < 0)
+    {
+      printf("[%s] failed! slog_open error! msg:%s\n" , __FUNCTION__ , msg);
+      return -1;
+    }
+    slog = pspace->slog_d;  
+    slog_log(slog, SL_INFO, "<%s> slog_open success!",__FUNCTION__);
+  }
+  else
+    slog = pspace->slog_d;
+
+  //Create Epoll(Only Once)
+  if(pspace->epfd < 0)
+  {
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    if(epfd < 0)
+    {
+      slog_log(slog , SL_ERR , "<%s> failed! epoll_create1 error! err:%s" , __FUNCTION__ , strerror(errno));
+      return -1;
+    }
+    slog_log(slog, SL_INFO, "<%s> epoll_create1 success! epfd:%d",__FUNCTION__ , epfd);
+
+    //wakeup of redis_wait from other threads
+    memset(&ev , 0 , sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = REDIS_WAKE_EVENT;
+    pspace->wake_fd = eventfd(0 , EFD_NONBLOCK|EFD_CLOEXEC);
+    if(pspace->wake_fd<0 || epoll_ctl(epfd , EPOLL_CTL_ADD , pspace->wake_fd , &ev)<0)
+    {
+      slog_log(slog , SL_ERR , "<%s> failed! create wakeup eventfd error! err:%s" , __FUNCTION__ , strerror(errno));
+      if(pspace->wake_fd >= 0)
+        close(pspace->wake_fd);
+      close(epfd);
+      return -1;
+    }
+    //published after wake_fd. redis_wakeup of other threads loads epfd first
+    __atomic_store_n(&pspace->epfd , epfd , __ATOMIC_RELEASE);
+
+    //io_uring for connected fds if chosen and kernel supports it
+    if(pspace->use_uring)
+      _uring_init(pspace);
+  }
+
+  //Empty List
+  if(!pspace->env_list || pspace->list_len < 0)
+  {
+    slog_log(slog , SL_INFO , "<%s> try to alloc in an empty list!" , __FUNCTION__);
+    penv = (REDISENV *)calloc(1 , sizeof(REDISENV));
+    if(!penv)
+    {
+      slog_log(slog , SL_ERR , "<%s> failed! calloc error! err:%s" , __FUNCTION__ , strerror(errno));
+      return -1;
+    }
+
+    rd = 0;
+    //set space info
+    pspace->valid_count = 1;
+    pspace->list_len = 0;//(log2(1))
+    pspace->env_list = penv;
+
+    //set env info
+    penv->stat = REDIS_ENV_STATA_VALID;
+    penv->id = rd;
+    penv->gen = ++pspace->gen_seq;
+
+    //print
+    _print_space();
+    return rd;
+  }
+
+  //No-Full List
+  real_len = (int)pow(2 , pspace->list_len);
+
+  //check ip:port duplicate. pool and cluster members and subscribers are excluded
+  for(i=0; i<real_len && !pooled; i++)
+  {
+    if(pspace->env_list[i].stat==REDIS_ENV_STAT_EMPTY || pspace->env_list[i].pool || 
+      pspace->env_list[i].cluster || pspace->env_list[i].sub)
+      continue;
+
+    penv = &pspace->env_list[i];
+    if(strcasecmp(penv->ip , ip)==0 && penv->port==port)
+    {
+      slog_log(slog, SL_ERR, "<%s> failed! ip:port[%s:%d] duplicate!", __FUNCTION__ , ip , port);
+      return -1;
+    }
+  }
+  
+
+  //search
+  if(pspace->valid_count < real_len)
+  {
+    for(i=0; i<real_len; i++)
+    {
+      if(pspace->env_list[i].stat == REDIS_ENV_STAT_EMPTY)
+        break;
+    }
+    if(i<real_len)
+    {
+      //set env
+      penv = &pspace->env_list[i];
+      penv->stat = REDIS_ENV_STATA_VALID;
+      penv->id = i;
+      penv->gen = ++pspace->gen_seq;
+
+      //set space
+      pspace->valid_count++;
+      rd = i;
+
+      //print
+      _print_space();
+      return rd;
+    }
+    else //should not happen
+    {
+      slog_log(slog, SL_FATAL, "<%s> No-FUll List alloc Failed!valid_count:%d real_len:%d list_len:%d", 
+        __FUNCTION__ , pspace->valid_count , real_len , pspace->list_len);
+    }
+  }
+
+  //ALLOC NEW
+  slog_log(slog, SL_INFO, "<%s> try to alloc new list",__FUNCTION__);
+  new_len = (int)pow(2 , pspace->list_len+1);
+  penv = (REDISENV *)calloc(new_len , sizeof(REDISENV));
+  if(!penv)
+  {
+    slog_log(slog, SL_ERR, "<%s> alloc new list failed! new_len:%d list_len:%d",__FUNCTION__ , 
+      new_len , pspace->list_len);
+    return -1;
+  }
+
+    //cpy old
+  memcpy(penv , pspace->env_list , real_len*sizeof(REDISENV));
+    //free old
+  free(pspace->env_list);
+    //new
+  pspace->env_list = penv;
+  pspace->list_len++;
+    //search
+  for(i=0; i<new_len; i++)
+  {
+    if(pspace->env_list[i].stat == REDIS_ENV_STAT_EMPTY)
+      break;
+  }
+  if(i >= new_len)
+  {
+    slog_log(slog, SL_FATAL, "<%s> alloc failed! Even In the New List! old_len:%d new_len:%d " 
+      "list_len:%d" , __FUNCTION__ , real_len , new_len , pspace->list_len);
+    return -1;
+  }
+  penv = &pspace->env_list[i];
+  penv->stat = REDIS_ENV_STATA_VALID;
+  penv->id = i;
+  penv->gen = ++pspace->gen_seq;
+  pspace->valid_count++;
+  
+    //print
+  _print_space();
+
+    //return
+  rd = i;
+  return rd;  
+}
+
+
+static int _redis_connect(int rd , char *ip , int port , int timeout_ms)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISENV *pstEnv = NULL;
+  //pstEnv = &redis_env;
+  int i = 0;
+  int sld = -1;
+  int ret = -1;
+
+  /***Check Basic*/
+  sld = pspace->slog_d;
+  if(sld < 0)
+    return -1;
+
+  /***Get Env*/
+  pstEnv = _rd2env(rd, __FUNCTION__);
+  if(!pstEnv)
+    return -1;
+  
+  /***Start Connect*/
+  pstEnv->flag = REDIS_CONN_FLG_CONNECTING;
+  pstEnv->hiredis_cxt = redisConnectNonBlock(ip , port);
+  if(!pstEnv->hiredis_cxt)
+  {
+    slog_log(sld , SL_ERR , "<%s> failed! rd:%d ip:%s port:%d" , __FUNCTION__ , rd , ip , port);
+    return -1;
+  }
+  if(_env_reader(pstEnv) < 0)
+    return -1;
+  if(_env_watch(pstEnv , EPOLLOUT) < 0) //writable when connect completes
+    return -1;
+
+  //set info
+  pstEnv->connect_end_ms = _now_ms() + timeout_ms;
+
+  strncpy(pstEnv->ip , ip , sizeof(pstEnv->ip));
+  pstEnv->port = port; 
+  pstEnv->timeout_ms = timeout_ms;
+
+  slog_log(sld , SL_INFO , "<%s> to %s:%d in progessing and will expire at:%lld rd:%d" , __FUNCTION__ , ip , port , 
+    pstEnv->connect_end_ms , rd);
+  return 0;
+}
+
+
+//check a connecting env reported by epoll.never block
+//events: epoll events of fd
+//return 0:connected or still in progress -1:failed
+static int _check_connect(REDISENV *penv , unsigned int events)
+{
+  int ret = 0;
+  int fd = -1;
+  int sld = -1;
+  int opt_value = 0;
+  socklen_t opt_len = sizeof(opt_value);
+
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISENV *pstEnv = penv;
+  
+  sld = pspace->slog_d;
+  fd = pstEnv->hiredis_cxt->fd;
+
+  //not ready
+  if(!(events & (EPOLLOUT|EPOLLERR|EPOLLHUP)))
+  {
+    slog_log(sld , SL_INFO , "<%s> connect not ready! rd%d fd:%d" , __FUNCTION__ , pstEnv->id , fd);
+    return 0;
+  }
+
+  //result of connect stored in SO_ERROR
+  ret = getsockopt(fd , SOL_SOCKET , SO_ERROR , &opt_value , &opt_len);
+  if(ret < 0)
+  {
+    slog_log(sld , SL_ERR , "<%s> getsockopt failed! rd:%d fd:%d err:%s" , __FUNCTION__ , pstEnv->id , fd , strerror(errno));
+    return -1; 
+  }
+
+  if(opt_value != 0)
+  {
+    slog_log(sld , SL_ERR , "<%s> connect meets an error!rd:%d fd:%d err:%s" , __FUNCTION__ , pstEnv->id , fd , 
+      strerror(opt_value));
+    return -1;
+  }
+
+  if(events & (EPOLLERR|EPOLLHUP))
+  {
+    slog_log(sld , SL_ERR , "<%s> connect in some trouble! rd:%d fd:%d events:0x%x" , __FUNCTION__ , pstEnv->id , fd , 
+      events);
+    return -1;
+  }
+
+  //connected
+  slog_log(sld , SL_INFO , "<%s> connect success! rd:%d fd:%d" , __FUNCTION__ , pstEnv->id , fd);
+  pstEnv->flag = REDIS_CONN_FLG_CONNECTED;
+  pstEnv->reconn_attempt = 0;
+  if(pspace->uring)
+  {
+    if(_uring_attach(pstEnv) < 0)
+      return -1;
+  }
+  else if(_env_watch(pstEnv , EPOLLIN) < 0)
+    return -1;
+
+  //resend held cmds
+  if(pstEnv->cb_count > 0)
+    _env_replay(pstEnv);
+
+  //subscriptions lost with old connection
+  if(pstEnv->sub)
+    _sub_resume(pstEnv);
+  return 0;
+}
+
+
+static int _redis_reconnect(REDISENV *penv)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISENV *pstEnv = NULL;
+  pstEnv = penv;
+  int sld = pspace->slog_d;
+  int ret = -1;
+  int rd = pstEnv->id;
+  unsigned int gen = pstEnv->gen;
+
+  //fail cmds not replayable before connecting again
+  if(pstEnv->hold)
+  {
+    _env_hold(pstEnv);
+    pstEnv = _env_alive(rd , gen);
+    if(!pstEnv || pstEnv->hiredis_cxt)
+      return -1;
+  }
+
+  pstEnv->hiredis_cxt = redisConnectNonBlock(pstEnv->ip , pstEnv->port);
+  if(!pstEnv->hiredis_cxt)
+  {
+    slog_log(sld , SL_ERR , "%s failed! ip:%s port:%d" , __FUNCTION__ , pstEnv->ip , pstEnv->port);
+    pstEnv->flag = REDIS_CONN_FLG_FAIL;
+    return -1;
+  }
+  if(_env_reader(pstEnv) < 0)
+    goto _fail;
+  if(_env_watch(pstEnv , EPOLLOUT) < 0) //writable when connect completes
+    goto _fail;
+
+  //set info
+  pstEnv->connect_end_ms = _now_ms() + pstEnv->timeout_ms;
+  pstEnv->flag = REDIS_CONN_FLG_CONNECTING;
+
+  slog_log(pspace->slog_d , SL_INFO , "<%s> to %s:%d in progessing and will expire at:%lld" , __FUNCTION__ , pstEnv->ip , pstEnv->port , 
+    pstEnv->connect_end_ms);
+  return 0;
+
+_fail:
+  //context is not watched yet. a retry starts from a clean env
+  redisFree(pstEnv->hiredis_cxt);
+  pstEnv->hiredis_cxt = NULL;
+  pstEnv->flag = REDIS_CONN_FLG_FAIL;
+  return -1;
+}
+
+
+//Activated by main_process tick or circle
+//only connections reported by epoll are touched
+static int _redis_tick_epoll()
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  long long start_us = 0;
+  int sld = -1;
+  int ready = 0;
+
+  /***Check Basic*/
+  sld = pspace->slog_d;
+  if(sld<0 || pspace->epfd<0)
+    return -1;
+
+  if(!pspace->env_list || pspace->list_len < 0)
+    return 0;
+
+  /***Flush Output Appended In This Tick*/
+  _flush_wqueue();
+
+  /***Wait Ready FD*/
+  start_us = pspace->budget_end_us>0? _now_us() : 0;
+  ready = epoll_wait(pspace->epfd , pspace->ev_list , REDIS_MAX_OPEN_NUM , _wait_ms());
+  _budget_waited(start_us);
+  slog_log(sld, SL_VERBOSE, "<%s> epoll_wait return:%d" , __FUNCTION__ , ready);
+  if(ready < 0)
+  {
+    if(errno == EINTR)
+      return 0;
+    slog_log(sld, SL_ERR, "<%s> epoll_wait failed! err:%s", __FUNCTION__ , strerror(errno));
+    return -1;
+  }
+
+  /***For Each Ready FD*/
+  _epoll_events(ready);
+  return 0;
+}
+
+//flush envs in pending-write queue of this tick
+static void _flush_wqueue()
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISENV *pstEnv = NULL;
+  int i = 0;
+  int rd = -1;
+  int real_len = (int)pow(2 , pspace->list_len);
+
+  for(i=0; i<pspace->wqueue_len; i++)
+  {
+    rd = pspace->wqueue[i];
+    if(rd<0 || rd>=real_len)
+      continue;
+
+    pstEnv = &pspace->env_list[rd];
+    pstEnv->wqueued = 0;
+    if(pstEnv->stat==REDIS_ENV_STAT_EMPTY || pstEnv->flag!=REDIS_CONN_FLG_CONNECTED || !pstEnv->hiredis_cxt)
+      continue;
+    if(_flush_env(pstEnv) < 0) //socket broken. pending cmds failed
+    {
+      _redis_disconnect(rd);
+      pstEnv->flag = REDIS_CONN_FLG_CLOSED;
+    }
+  }
+  pspace->wqueue_len = 0;
+}
+
+//handle fds reported by epoll_wait in ev_list
+static void _epoll_events(int ready)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISENV *pstEnv = NULL;
+  int i = 0;
+  int rd = -1;
+  int real_len = 0;
+  unsigned int events = 0;
+
+  for(i=0; i<ready; i++)
+  {
+    if(!pspace->env_list) //all closed by callback
+      break;
+    real_len = (int)pow(2 , pspace->list_len);
+    rd = (int)pspace->ev_list[i].data.u32;
+    events = pspace->ev_list[i].events;
+    //wait ended. nothing else to do
+    if(pspace->ev_list[i].data.u32==REDIS_WAKE_EVENT || pspace->ev_list[i].data.u32==REDIS_TIMER_EVENT)
+    {
+      _wake_drain();
+      continue;
+    }
+    if(rd<0 || rd>=real_len)
+      continue;
+
+    //may be closed by callback of former fd
+    pstEnv = &pspace->env_list[rd];
+    if(pstEnv->stat==REDIS_ENV_STAT_EMPTY || !pstEnv->hiredis_cxt)
+      continue;
+
+    //connect completed or failed
+    if(pstEnv->flag == REDIS_CONN_FLG_CONNECTING)
+    {
+      if(_check_connect(pstEnv , events) < 0) //connect failed
+      {
+        _redis_disconnect(pstEnv->id);
+        pstEnv->flag = REDIS_CONN_FLG_FAIL;
+      }
+      continue;
+    }
+
+    if(pstEnv->flag != REDIS_CONN_FLG_CONNECTED)
+      continue;
+
+    //write backpressure released
+    if((events & EPOLLOUT) && _flush_env(pstEnv)<0)
+    {
+      _redis_disconnect(rd);
+      pstEnv->flag = REDIS_CONN_FLG_CLOSED;
+      continue;
+    }
+
+    if(events & (EPOLLIN|EPOLLERR|EPOLLHUP))
+    {
+      if(pspace->budget_out) //read first in next tick
+        _env_backlog(pstEnv);
+      else if(_read_env(pstEnv) < 0) //disconnected by read error or reader limit
+        continue;
+    }
+  }
+  return;
+}
+
+//timeout of wait in this tick. redis_tick waits REDIS_EPOLL_WAIT_MS and redis_wait until nearest deadline
+//return ms; -1:until event
+static int _wait_ms()
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  long long curr_ms = 0;
+  long long deadline = 0;
+
+  if(pspace->budget_out || pspace->backlog_cnt>0 || pspace->gather_done || pspace->hedge_done)
+    return 0;
+  if(!pspace->waiting)
+    return REDIS_EPOLL_WAIT_MS;
+  if(pspace->wait_ms == 0)
+    return 0;
+
+  curr_ms = _now_ms();
+  deadline = _next_deadline(curr_ms);
+  if(deadline < 0)
+    return pspace->wait_ms;
+  if(deadline <= curr_ms)
+    return 0;
+  if(pspace->wait_ms>=0 && deadline-curr_ms>pspace->wait_ms)
+    return pspace->wait_ms;
+  return deadline-curr_ms>0x7fffffff? 0x7fffffff : (int)(deadline-curr_ms);
+}
+
+//nearest deadline of connecting,managed reconnect,cmd timers and slot reload
+//return monotonic ms; -1:none
+static long long _next_deadline(long long curr_ms)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISENV *penv = NULL;
+  REDISCLUSTER *pcluster = NULL;
+  long long next = -1;
+  long long at = 0;
+  int real_len = 0;
+  int valid_check = 0;
+  int i = 0;
+
+  if(pspace->env_list && pspace->list_len>=0)
+  {
+    real_len = (int)pow(2 , pspace->list_len);
+    for(i=0; i<real_len && valid_check<pspace->valid_count; i++)
+    {
+      penv = &pspace->env_list[i];
+      if(penv->stat == REDIS_ENV_STAT_EMPTY)
+        continue;
+      valid_check++;
+
+      if(penv->reconn_min>0 && (penv->flag==REDIS_CONN_FLG_FAIL || penv->flag==REDIS_CONN_FLG_CLOSED))
+        at = penv->reconn_at_ms>0? penv->reconn_at_ms : curr_ms; //not scheduled yet
+      else if(penv->flag == REDIS_CONN_FLG_CONNECTING)
+        at = penv->connect_end_ms;
+      else
+        continue;
+      if(next<0 || at<next)
+        next = at;
+    }
+  }
+
+  at = _timer_next();
+  if(at>=0 && (next<0 || at<next))
+    next = at;
+
+  for(i=0; i<pspace->cluster_len; i++)
+  {
+    pcluster = &pspace->cluster_list[i];
+    if(!pcluster->slots || !pcluster->refresh)
+      continue;
+    at = pcluster->load_ms + REDIS_CLUSTER_RELOAD_MS;
+    if(at <= curr_ms) //no node connected yet
+      at = curr_ms + REDIS_EPOLL_WAIT_MS;
+    if(next<0 || at<next)
+      next = at;
+  }
+  return next;
+}
+
+//wake redis_wait or reactor of exported epfd. safe from any thread
+//return 0:success -1:failed
+static int _wake(REDIS_GLOBALSPACE *pspace)
+{
+  return _efd_write(pspace->wake_fd);
+}
+
+//clear wakeup and expired deadline so that epfd is quiet again
+static void _wake_drain()
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+
+  _efd_read(pspace->wake_fd);
+  if(pspace->pollfd_on)
+    _efd_read(pspace->timer_fd); //expirations of timerfd read as eventfd counter
+}
+
+//keep exported epfd readable while work is left and arm timer_fd to nearest deadline
+static void _pollfd_arm()
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  struct itimerspec its;
+  long long curr_ms = _now_ms();
+  long long at = 0;
+
+  if(pspace->backlog_cnt>0 || pspace->gather_done || pspace->hedge_done || pspace->wqueue_len>0)
+    _wake(pspace);
+  else if(pspace->uring && (pspace->uring->stash_len>0 || 
+    *pspace->uring->cq_head!=__atomic_load_n(pspace->uring->cq_tail , __ATOMIC_ACQUIRE)))
+    _wake(pspace);
+
+  at = _next_deadline(curr_ms);
+  if(at==pspace->timer_at && (at<0 || at>curr_ms)) //unchanged. no deadline or not expired
+    return;
+
+  //absolute monotonic time. zero value disarms
+  memset(&its , 0 , sizeof(its));
+  if(at >= 0)
+  {
+    its.it_value.tv_sec = at / 1000;
+    its.it_value.tv_nsec = (at % 1000) * 1000000;
+    if(at == 0)
+      its.it_value.tv_nsec = 1;
+  }
+  if(timerfd_settime(pspace->timer_fd , TFD_TIMER_ABSTIME , &its , NULL) < 0)
+  {
+    slog_log(pspace->slog_d , SL_ERR , "<%s> timerfd_settime failed! at:%lld err:%s" , __FUNCTION__ , at , 
+      strerror(errno));
+    return;
+  }
+  pspace->timer_at = at;
+}
+
+//whether work budget of this tick is used up
+static int _budget_out()
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+
+  if(pspace->budget_out)
+    return 1;
+  if(pspace->budget_max>0 && pspace->budget_used>=pspace->budget_max)
+    pspace->budget_out = 1;
+  else if(pspace->budget_end_us>0 && _now_us()>=pspace->budget_end_us)
+    pspace->budget_out = 1;
+  return pspace->budget_out;
+}
+
+//time blocked in wait is not spent on replies. deadline of budget moves by it
+static void _budget_waited(long long start_us)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+
+  if(pspace->budget_end_us > 0)
+    pspace->budget_end_us += _now_us() - start_us;
+}
+
+//mark env to be served in next tick
+static void _env_backlog(REDISENV *penv)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+
+  if(penv->backlog)
+    return;
+  penv->backlog = 1;
+  pspace->backlog_cnt++;
+}
+
+//serve envs left by budget round-robin
+static void _env_resume()
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISENV *pstEnv = NULL;
+  int real_len = (int)pow(2 , pspace->list_len);
+  int rd = pspace->resume_rd;
+  unsigned int gen = 0;
+  int n = 0;
+
+  for(n=0; n<real_len; n++ , rd++)
+  {
+    if(!pspace->env_list || pspace->backlog_cnt<=0 || pspace->budget_out)
+      break;
+    real_len = (int)pow(2 , pspace->list_len);
+    rd %= real_len;
+    pstEnv = &pspace->env_list[rd];
+    if(!pstEnv->backlog)
+      continue;
+    pstEnv->backlog = 0;
+    pspace->backlog_cnt--;
+    if(pstEnv->stat==REDIS_ENV_STAT_EMPTY || pstEnv->flag!=REDIS_CONN_FLG_CONNECTED || !pstEnv->hiredis_cxt)
+      continue;
+
+    //epoll:socket of reader drained. io_uring:reader only and the rest is in completion ring
+    if(!pstEnv->usend && pstEnv->hiredis_cxt->reader->pos>=pstEnv->hiredis_cxt->reader->len)
+    {
+      _read_env(pstEnv);
+      continue;
+    }
+    gen = pstEnv->gen;
+    if(_parse_env(pstEnv)==1 || !(pstEnv=_env_alive(rd , gen)))
+      continue;
+    if(pstEnv->hiredis_cxt && pstEnv->ov_cnt>0)
+      _ov_release(pstEnv);
+  }
+
+  //next call starts after the one cut off
+  if(pspace->budget_out)
+    pspace->resume_rd = rd;
+}
+
+//flush output buff of a connected env. 
+//EPOLLOUT is only registered while output remains
+//return 0:success -1:failed
+static int _flush_env(REDISENV *penv)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISENV *pstEnv = penv;
+  redisContext *c = pstEnv->hiredis_cxt;
+  int sld = pspace->slog_d;
+  ssize_t nwritten = 0;
+  size_t len = 0;
+
+  //(un)subscribes of this tick in one cmd
+  if(pstEnv->sub && pstEnv->sub->pend_cnt>0)
+    _sub_flush(pstEnv);
+  if(pstEnv->usend) //io_uring backend
+    return _uring_send(pstEnv);
+  len = sdslen(c->obuf) - pstEnv->ov_bytes; //queued cmds not written
+
+  //whole pending output in one syscall. obuf is contiguous so no writev needed
+  while(len > 0)
+  {
+    nwritten = write(c->fd , c->obuf , len);
+    if(nwritten>=0 || errno!=EINTR)
+      break;
+  }
+
+  if(nwritten < 0)
+  {
+    if(errno==EAGAIN || errno==EWOULDBLOCK) //send buff full
+    {
+      slog_log(sld , SL_INFO , "<%s> sendbuff full and will write again! rd:%d" , __FUNCTION__ , pstEnv->id);
+      return _env_watch(pstEnv , EPOLLIN|EPOLLOUT);
+    }
+    slog_log(sld , SL_ERR , "<%s> flush output buff failed! rd:%d fd:%d err:%s" , __FUNCTION__ , 
+      pstEnv->id , c->fd , strerror(errno));
+    return -1;
+  }
+
+  //all written
+  if((size_t)nwritten == len)
+  {
+    slog_log(sld , SL_VERBOSE , "<%s> output buffer empty! rd:%d" , __FUNCTION__ , pstEnv->id);
+    if(pstEnv->ov_bytes > 0)
+      sdsrange(c->obuf , nwritten , -1);
+    else
+      sdsclear(c->obuf);
+    _ov_release(pstEnv);
+    return _env_watch(pstEnv , EPOLLIN);
+  }
+
+  //partly written. socket buffer is full so wait writable instead of retrying
+  sdsrange(c->obuf , nwritten , -1);
+  _ov_release(pstEnv);
+  slog_log(sld , SL_INFO , "<%s> sendbuff full and will write again! rd:%d left:%d" , __FUNCTION__ , 
+    pstEnv->id , (int)sdslen(c->obuf));
+  return _env_watch(pstEnv , EPOLLIN|EPOLLOUT);
+}
+
+//read and handle replies of a ready env
+//return 0:success -1:failed
+static int _read_env(REDISENV *penv)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISENV *pstEnv = penv;
+  int sld = pspace->slog_d;
+  int nread;
+  int size = REDIS_READ_MIN;
+  int pending = 0;
+  int ret = -1;
+  int rd = pstEnv->id;
+  unsigned int gen = pstEnv->gen;
+
+  //read response from server
+  while(1)
+  {
+    slog_log(sld , SL_VERBOSE , "%s read rd:%d sock:%d!" , __FUNCTION__ , pstEnv->id , pstEnv->hiredis_cxt->fd);
+
+    //read into spare space of reader buffer directly
+    nread = _read_reader(pstEnv , size);
+    if(nread == -1) //
+    {
+      if(errno == EINTR)
+        continue;
+      if(errno==EAGAIN || errno==EWOULDBLOCK) //no more data
+      {
+        slog_log(sld , SL_VERBOSE , "<%s> read no more data! rd:%d msg:%s" , __FUNCTION__ , pstEnv->id , strerror(errno));
+        break;
+      }
+
+      //connection broken. pending cmds failed
+      slog_log(sld , SL_ERR , "<%s> read failed! rd:%d msg:%s" , __FUNCTION__ , pstEnv->id , strerror(errno));
+      _redis_disconnect(pstEnv->id);
+      pstEnv->flag = REDIS_CONN_FLG_CLOSED;
+      return -1;
+    }
+    else if(nread == 0) //server closed. 
+    {
+      slog_log(sld, SL_INFO, "<%s> server shutdown connection! rd:%d", __FUNCTION__ , pstEnv->id);
+      _redis_disconnect(pstEnv->id);
+      pstEnv->flag = REDIS_CONN_FLG_CLOSED;
+      break;
+    }
+
+    //closed by callback or reader limit
+    ret = _parse_env(pstEnv);
+    if(ret==1 || ret<0)
+      return ret<0? -1 : 0;
+    pstEnv = _env_alive(rd , gen);
+
+    //budget used up. rest is read in next tick
+    if(ret == 2)
+      break;
+
+    //short read means socket drained. epoll is level triggered
+    if(nread < size)
+      break;
+
+    //size next read by backlog
+    if(ioctl(pstEnv->hiredis_cxt->fd , FIONREAD , &pending)<0 || pending<=0)
+      break;
+    size = pending<REDIS_READ_MIN? REDIS_READ_MIN : (pending>REDIS_READ_MAX? REDIS_READ_MAX : pending);
+        
+  } //end while:reading
+
+  //replies received. send queued cmds
+  if(pstEnv->hiredis_cxt && pstEnv->ov_cnt>0)
+    _ov_release(pstEnv);
+  return 0;
+}
+
+//handle full replies in reader buffer
+//return 0:success 1:env closed or reopened by callback 2:budget of tick used up -1:closed for reader limit
+static int _parse_env(REDISENV *penv)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISENV *pstEnv = penv;
+  int sld = pspace->slog_d;
+  REPLYNODE *reply = NULL;
+  int ret = -1;
+  int rd = pstEnv->id;
+  unsigned int gen = pstEnv->gen;
+  int n = 0;
+
+  //try to construct a full package consistly
+  for(;;)
+  {
+    //rest of reader handled first in next tick
+    if(_budget_out())
+    {
+      if(pstEnv->hiredis_cxt->reader->pos < pstEnv->hiredis_cxt->reader->len)
+      {
+        _env_backlog(pstEnv);
+        if(n > 0) //served this time. next one goes first
+          pspace->resume_rd = rd + 1;
+      }
+      return 2;
+    }
+
+    ret = redisGetReplyFromReader(pstEnv->hiredis_cxt, (void**)&reply);
+    if(ret != REDIS_OK)
+    {
+      slog_log(sld , SL_ERR , "<%s> get reply error! rd:%d fd:%d err:%s" , __FUNCTION__ , 
+        pstEnv->id , pstEnv->hiredis_cxt->fd , pstEnv->hiredis_cxt->errstr);        
+      break;
+    }
+
+    if(!reply)
+    {
+      slog_log(sld , SL_DEBUG , "<%s> no full reply is recved! rd:%d" , __FUNCTION__ , 
+        pstEnv->id);
+      break;
+    }
+
+    slog_log(sld , SL_VERBOSE , "<%s> full reply is recved! rd:%d" , __FUNCTION__ , 
+        pstEnv->id);
+    //handle reply
+    ret = _handle_reply(pstEnv, reply);
+    pspace->budget_used++;
+    n++;
+
+    //closed or moved by callback
+    pstEnv = _env_alive(rd , gen);
+    if(!pstEnv || !pstEnv->hiredis_cxt)
+      return 1;
+
+    //reuse arena if reply not kept by batch
+    if(ret != 1)
+      _arena_reset(pstEnv->arena);
+    
+  } //end for:get reply
+
+  //reader limit. a reply larger than it can never complete
+  if(pstEnv->limit.max_ibuf>0 && _env_ibuf(pstEnv)>(size_t)pstEnv->limit.max_ibuf)
+  {
+    slog_log(sld , SL_ERR , "<%s> reader buffer exceeds limit:%d! close it. rd:%d" , __FUNCTION__ , 
+      pstEnv->limit.max_ibuf , pstEnv->id);
+    _redis_disconnect(pstEnv->id);
+    pstEnv->flag = REDIS_CONN_FLG_CLOSED;
+    return -1;
+  }
+  return 0;
+}
+
+//read from socket into spare space of hiredis reader buffer. no extra copy like redisReaderFeed
+//return same as read()
+static int _read_reader(REDISENV *penv , int size)
+{
+  redisReader *r = penv->hiredis_cxt->reader;
+  sds buf = NULL;
+  int nread = 0;
+
+  buf = _reader_room(penv , size);
+  if(!buf)
+    return -1;
+
+  nread = read(penv->hiredis_cxt->fd , buf+sdslen(buf) , size);
+  if(nread > 0)
+  {
+    sdsIncrLen(buf , nread);
+    r->len = sdslen(buf);
+  }
+  return nread;
+}
+
+//make room of size bytes at end of hiredis reader buffer
+//return buffer or NULL if no memory
+static char *_reader_room(REDISENV *penv , int size)
+{
+  redisReader *r = penv->hiredis_cxt->reader;
+  sds buf = NULL;
+
+  //destroy large empty buffer like redisReaderFeed
+  if(r->len==0 && r->maxbuf!=0 && sdsavail(r->buf)>r->maxbuf && (size_t)size<=r->maxbuf)
+  {
+    sdsfree(r->buf);
+    r->buf = sdsempty();
+    r->pos = 0;
+    if(!r->buf)
+    {
+      errno = ENOMEM;
+      return NULL;
+    }
+  }
+
+  buf = sdsMakeRoomFor(r->buf , size);
+  if(!buf)
+  {
+    errno = ENOMEM;
+    return NULL;
+  }
+  r->buf = buf;
+  return buf;
+}
+
+//register env fd into epoll or modify its events
+//return 0:success -1:failed
+static int _env_watch(REDISENV *penv , unsigned int events)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  struct epoll_event ev;
+  int op = EPOLL_CTL_ADD;
+
+  if(!penv || !penv->hiredis_cxt || pspace->epfd<0)
+    return -1;
+
+  if(penv->events == events)
+    return 0;
+
+  if(penv->events != 0)
+    op = EPOLL_CTL_MOD;
+
+  memset(&ev , 0 , sizeof(ev));
+  ev.events = events;
+  ev.data.u32 = (unsigned int)penv->id;
+  if(epoll_ctl(pspace->epfd , op , penv->hiredis_cxt->fd , &ev) < 0)
+  {
+    slog_log(pspace->slog_d , SL_ERR , "<%s> epoll_ctl failed! op:%d rd:%d fd:%d err:%s" , __FUNCTION__ , op , 
+      penv->id , penv->hiredis_cxt->fd , strerror(errno));
+    return -1;
+  }
+
+  penv->events = events;
+  return 0;
+}
+
+//remove env fd from epoll.[before redisFree]
+static int _env_unwatch(REDISENV *penv)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+
+  if(!penv || !penv->hiredis_cxt || pspace->epfd<0 || penv->events==0)
+    return 0;
+
+  if(epoll_ctl(pspace->epfd , EPOLL_CTL_DEL , penv->hiredis_cxt->fd , NULL) < 0)
+    slog_log(pspace->slog_d , SL_ERR , "<%s> epoll_ctl failed! rd:%d fd:%d err:%s" , __FUNCTION__ , penv->id , 
+      penv->hiredis_cxt->fd , strerror(errno));
+
+  penv->events = 0;
+  return 0;
+}
+
+#ifdef REDIS_URING
+/***IO_URING BACKEND*/
+//create io_uring with provided recv buffers. context stays on epoll if any feature is missing
+//return 0:success -1:not available
+static int _uring_init(REDIS_GLOBALSPACE *pspace)
+{
+  REDISURING *puring = NULL;
+  struct io_uring_params params;
+  struct io_uring_probe *probe = NULL;
+  struct io_uring_buf_reg reg;
+  int sld = pspace->slog_d;
+  int fd = -1;
+  int i = 0;
+
+  memset(&params , 0 , sizeof(params));
+  params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_COOP_TASKRUN;
+  params.cq_entries = URING_CQ_ENTRIES;
+  fd = (int)syscall(__NR_io_uring_setup , URING_SQ_ENTRIES , &params);
+  if(fd < 0)
+  {
+    slog_log(sld , SL_INFO , "<%s> io_uring not available and use epoll! err:%s" , __FUNCTION__ , strerror(errno));
+    return -1;
+  }
+
+  probe = (struct io_uring_probe *)calloc(1 , sizeof(struct io_uring_probe) + 
+    IORING_OP_LAST*sizeof(struct io_uring_probe_op));
+  if(!probe)
+    goto _fail;
+  if(syscall(__NR_io_uring_register , fd , IORING_REGISTER_PROBE , probe , IORING_OP_LAST) < 0 || 
+    probe->last_op<IORING_OP_RECV || !(probe->ops[IORING_OP_RECV].flags & IO_URING_OP_SUPPORTED) || 
+    !(probe->ops[IORING_OP_SEND].flags & IO_URING_OP_SUPPORTED) || 
+    !(probe->ops[IORING_OP_POLL_ADD].flags & IO_URING_OP_SUPPORTED) || 
+    !(params.features & IORING_FEAT_EXT_ARG) || !(params.features & IORING_FEAT_NODROP))
+  {
+    slog_log(sld , SL_INFO , "<%s> io_uring lacks recv/send/poll ops and use epoll! features:0x%x" , __FUNCTION__ , 
+      params.features);
+    goto _fail;
+  }
+  free(probe);
+  probe = NULL;
+
+  puring = (REDISURING *)calloc(1 , sizeof(REDISURING));
+  if(!puring)
+    goto _fail;
+  puring->fd = fd;
+
+  //map rings
+  puring->sq_len = params.sq_off.array + params.sq_entries*sizeof(unsigned int);
+  puring->cq_len = params.cq_off.cqes + params.cq_entries*sizeof(struct io_uring_cqe);
+  puring->sqe_len = params.sq_entries * sizeof(struct io_uring_sqe);
+  puring->sq_ptr = mmap(NULL , puring->sq_len , PROT_READ|PROT_WRITE , MAP_SHARED|MAP_POPULATE , fd , IORING_OFF_SQ_RING);
+  puring->cq_ptr = mmap(NULL , puring->cq_len , PROT_READ|PROT_WRITE , MAP_SHARED|MAP_POPULATE , fd , IORING_OFF_CQ_RING);
+  puring->sqes = (struct io_uring_sqe *)mmap(NULL , puring->sqe_len , PROT_READ|PROT_WRITE , MAP_SHARED|MAP_POPULATE , 
+    fd , IORING_OFF_SQES);
+  if(puring->sq_ptr==MAP_FAILED || puring->cq_ptr==MAP_FAILED || (void *)puring->sqes==MAP_FAILED)
+  {
+    slog_log(sld , SL_ERR , "<%s> mmap ring failed! err:%s" , __FUNCTION__ , strerror(errno));
+    goto _fail;
+  }
+  puring->sq_head = (unsigned int *)((char *)puring->sq_ptr + params.sq_off.head);
+  puring->sq_tail = (unsigned int *)((char *)puring->sq_ptr + params.sq_off.tail);
+  puring->sq_mask = *(unsigned int *)((char *)puring->sq_ptr + params.sq_off.ring_mask);
+  puring->sq_array = (unsigned int *)((char *)puring->sq_ptr + params.sq_off.array);
+  puring->cq_head = (unsigned int *)((char *)puring->cq_ptr + params.cq_off.head);
+  puring->cq_tail = (unsigned int *)((char *)puring->cq_ptr + params.cq_off.tail);
+  puring->cq_flags = (unsigned int *)((char *)puring->cq_ptr + params.cq_off.flags);
+  puring->cq_mask = *(unsigned int *)((char *)puring->cq_ptr + params.cq_off.ring_mask);
+  puring->cqes = (struct io_uring_cqe *)((char *)puring->cq_ptr + params.cq_off.cqes);
+  for(i=0; i<(int)params.sq_entries; i++) //sqe of each slot is fixed
+    puring->sq_array[i] = i;
+
+  //provided buffers shared by multishot recvs of all connections
+  puring->br = (struct io_uring_buf_ring *)mmap(NULL , URING_BUF_COUNT*sizeof(struct io_uring_buf) , 
+    PROT_READ|PROT_WRITE , MAP_PRIVATE|MAP_ANONYMOUS , -1 , 0);
+  puring->bufs = (char *)malloc((size_t)URING_BUF_COUNT * URING_BUF_SIZE);
+  if((void *)puring->br==MAP_FAILED || !puring->bufs)
+  {
+    slog_log(sld , SL_ERR , "<%s> alloc recv buffers failed! err:%s" , __FUNCTION__ , strerror(errno));
+    goto _fail;
+  }
+  memset(&reg , 0 , sizeof(reg));
+  reg.ring_addr = (unsigned long long)(unsigned long)puring->br;
+  reg.ring_entries = URING_BUF_COUNT;
+  reg.bgid = URING_BGID;
+  if(syscall(__NR_io_uring_register , fd , IORING_REGISTER_PBUF_RING , &reg , 1) < 0)
+  {
+    slog_log(sld , SL_INFO , "<%s> register buffer ring failed and use epoll! err:%s" , __FUNCTION__ , strerror(errno));
+    goto _fail;
+  }
+  for(i=0; i<URING_BUF_COUNT; i++)
+    _uring_buf_put(puring , (unsigned short)i);
+
+  //multishot is a flag of recv and not shown by probe
+  if(_uring_probe_recv(puring) < 0)
+  {
+    slog_log(sld , SL_INFO , "<%s> io_uring lacks multishot recv and use epoll!" , __FUNCTION__);
+    goto _fail;
+  }
+
+  pspace->uring = puring;
+  slog_log(sld , SL_INFO , "<%s> success! fd:%d sq:%u cq:%u" , __FUNCTION__ , fd , params.sq_entries , params.cq_entries);
+  return 0;
+
+_fail:
+  free(probe);
+  if(puring)
+  {
+    if(puring->sq_ptr && puring->sq_ptr!=MAP_FAILED)
+      munmap(puring->sq_ptr , puring->sq_len);
+    if(puring->cq_ptr && puring->cq_ptr!=MAP_FAILED)
+      munmap(puring->cq_ptr , puring->cq_len);
+    if(puring->sqes && (void *)puring->sqes!=MAP_FAILED)
+      munmap(puring->sqes , puring->sqe_len);
+    if(puring->br && (void *)puring->br!=MAP_FAILED)
+      munmap(puring->br , URING_BUF_COUNT*sizeof(struct io_uring_buf));
+    free(puring->bufs);
+    free(puring);
+  }
+  close(fd);
+  return -1;
+}
+
+//arm a multishot recv with provided buffers on a socketpair. kernels without it fail the recv with EINVAL
+//return 0:supported -1:not
+static int _uring_probe_recv(REDISURING *puring)
+{
+  struct io_uring_sqe *sqe = NULL;
+  struct io_uring_cqe *cqe = NULL;
+  unsigned int head = 0;
+  int sv[2] = {-1 , -1};
+  int ret = -1;
+  int ended = 0;
+  int i = 0;
+
+  if(socketpair(AF_UNIX , SOCK_STREAM|SOCK_CLOEXEC , 0 , sv) < 0)
+    return -1;
+  if(write(sv[1] , "p" , 1) != 1)
+    goto _end;
+
+  sqe = _uring_sqe(puring);
+  if(!sqe)
+    goto _end;
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = sv[0];
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = URING_BGID;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->user_data = URING_UD_RECV;
+  _uring_enter(puring , 0);
+  shutdown(sv[0] , SHUT_RDWR); //ends multishot after the data
+
+  //data with more flag then the end
+  for(i=0; i<100 && !ended; i++)
+  {
+    _uring_enter(puring , REDIS_EPOLL_WAIT_MS);
+    head = *puring->cq_head;
+    while(head != __atomic_load_n(puring->cq_tail , __ATOMIC_ACQUIRE))
+    {
+      cqe = &puring->cqes[head & puring->cq_mask];
+      if(cqe->res>0 && (cqe->flags & IORING_CQE_F_MORE))
+        ret = 0;
+      if(cqe->flags & IORING_CQE_F_BUFFER)
+        _uring_buf_put(puring , (unsigned short)(cqe->flags>>IORING_CQE_BUFFER_SHIFT));
+      if(!(cqe->flags & IORING_CQE_F_MORE))
+        ended = 1;
+      head++;
+    }
+    __atomic_store_n(puring->cq_head , head , __ATOMIC_RELEASE);
+  }
+
+_end:
+  close(sv[0]);
+  close(sv[1]);
+  return ended? ret : -1;
+}
+
+//close io_uring of a context whose rds are all closed
+static void _uring_free(REDIS_GLOBALSPACE *pspace)
+{
+  REDISURING *puring = pspace->uring;
+  int i = 0;
+
+  //sends of closed envs end soon after shutdown. buffers are freed by their completions
+  for(i=0; i<100 && puring->orphans>0; i++)
+  {
+    _uring_enter(puring , REDIS_EPOLL_WAIT_MS);
+    _uring_reap();
+  }
+  if(puring->orphans > 0)
+    slog_log(pspace->slog_d , SL_ERR , "<%s> %d sends not completed!" , __FUNCTION__ , puring->orphans);
+
+  close(puring->fd);
+  munmap(puring->sq_ptr , puring->sq_len);
+  munmap(puring->cq_ptr , puring->cq_len);
+  munmap(puring->sqes , puring->sqe_len);
+  munmap(puring->br , URING_BUF_COUNT*sizeof(struct io_uring_buf));
+  free(puring->bufs);
+  free(puring->stash);
+  free(puring);
+  pspace->uring = NULL;
+}
+
+//signal wake_fd on completions so that epfd exported alone shows io_uring work
+//return 0:success -1:failed
+static int _uring_notify(REDIS_GLOBALSPACE *pspace)
+{
+  if(syscall(__NR_io_uring_register , pspace->uring->fd , IORING_REGISTER_EVENTFD , &pspace->wake_fd , 1) < 0)
+  {
+    slog_log(pspace->slog_d , SL_ERR , "<%s> register eventfd failed! err:%s" , __FUNCTION__ , strerror(errno));
+    return -1;
+  }
+  return 0;
+}
+
+//Activated by main_process tick
+//sends of all envs and the wait are done by one io_uring_enter
+static int _redis_tick_uring()
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISURING *puring = pspace->uring;
+  struct io_uring_sqe *sqe = NULL;
+  long long start_us = 0;
+  int ready = 0;
+
+  /***Queue Output Appended In This Tick*/
+  puring->batch = 1;
+  //completions reaped here need no signal to reactor of exported epfd
+  if(pspace->pollfd_on)
+    __atomic_store_n(puring->cq_flags , *puring->cq_flags|IORING_CQ_EVENTFD_DISABLED , __ATOMIC_RELEASE);
+  _flush_wqueue();
+
+  /***Watch Epoll*/
+  //connecting fds and eventfd stay in epoll
+  if(!puring->poll_armed)
+  {
+    sqe = _uring_sqe(puring);
+    if(sqe)
+    {
+      sqe->opcode = IORING_OP_POLL_ADD;
+      sqe->fd = pspace->epfd;
+      sqe->poll32_events = POLLIN;
+      sqe->user_data = URING_UD_POLL;
+      puring->poll_armed = 1;
+    }
+  }
+
+  /***Submit And Wait*/
+  start_us = pspace->budget_end_us>0? _now_us() : 0;
+  _uring_enter(puring , _wait_ms());
+  _budget_waited(start_us);
+
+  /***Handle Completions*/
+  _uring_reap();
+
+  /***Ready FD Of Epoll*/
+  if(puring->poll_ready && pspace->env_list)
+  {
+    puring->poll_ready = 0;
+    ready = epoll_wait(pspace->epfd , pspace->ev_list , REDIS_MAX_OPEN_NUM , 0);
+    if(ready > 0)
+      _epoll_events(ready);
+  }
+
+  //sqes queued by callbacks are submitted in next tick
+  puring->batch = 0;
+  if(pspace->pollfd_on) //left in ring is checked by _pollfd_arm after this
+    __atomic_store_n(puring->cq_flags , *puring->cq_flags&~IORING_CQ_EVENTFD_DISABLED , __ATOMIC_RELEASE);
+  return 0;
+}
+
+//get a free sqe. queued sqes are submitted if ring is full
+static struct io_uring_sqe *_uring_sqe(REDISURING *puring)
+{
+  struct io_uring_sqe *sqe = NULL;
+  unsigned int tail = *puring->sq_tail;
+
+  if(tail - __atomic_load_n(puring->sq_head , __ATOMIC_ACQUIRE) > puring->sq_mask)
+  {
+    _uring_enter(puring , 0);
+    if(tail - __atomic_load_n(puring->sq_head , __ATOMIC_ACQUIRE) > puring->sq_mask)
+      return NULL;
+  }
+
+  sqe = &puring->sqes[tail & puring->sq_mask];
+  memset(sqe , 0 , sizeof(struct io_uring_sqe));
+  //published at once. kernel only consumes it in enter
+  __atomic_store_n(puring->sq_tail , tail+1 , __ATOMIC_RELEASE);
+  puring->pending++;
+  return sqe;
+}
+
+//submit queued sqes and wait for completions at most wait_ms. 0:no wait -1:until one completes
+//return 0:success -1:failed
+static int _uring_enter(REDISURING *puring , int wait_ms)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  struct io_uring_getevents_arg arg;
+  struct __kernel_timespec ts;
+  unsigned int flags = 0;
+  int ret = 0;
+
+  if(wait_ms==0 && puring->pending==0)
+    return 0;
+
+  memset(&arg , 0 , sizeof(arg));
+  if(wait_ms != 0)
+  {
+    if(wait_ms > 0) //no ts waits until completion
+    {
+      ts.tv_sec = wait_ms / 1000;
+      ts.tv_nsec = (wait_ms % 1000) * 1000000LL;
+      arg.ts = (unsigned long long)(unsigned long)&ts;
+    }
+    arg.sigmask_sz = _NSIG / 8;
+    flags = IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+  }
+
+  ret = (int)syscall(__NR_io_uring_enter , puring->fd , puring->pending , wait_ms? 1 : 0 , flags , 
+    wait_ms? &arg : NULL , wait_ms? sizeof(arg) : 0);
+  if(ret < 0)
+  {
+    if(errno==ETIME || errno==EINTR || errno==EAGAIN || errno==EBUSY)
+      return 0;
+    slog_log(pspace->slog_d , SL_ERR , "<%s> io_uring_enter failed! pending:%u err:%s" , __FUNCTION__ , 
+      puring->pending , strerror(errno));
+    return -1;
+  }
+
+  puring->pending -= ((unsigned int)ret>puring->pending)? puring->pending : (unsigned int)ret;
+  return 0;
+}
+
+//take over a connected env from epoll
+//return 0:success -1:failed
+static int _uring_attach(REDISENV *penv)
+{
+  URINGSEND *psend = NULL;
+
+  _env_unwatch(penv);
+  if(!penv->usend)
+  {
+    psend = (URINGSEND *)calloc(1 , sizeof(URINGSEND));
+    if(!psend)
+      return -1;
+    psend->buf = sdsempty();
+    if(!psend->buf)
+    {
+      free(psend);
+      return -1;
+    }
+    psend->rd = penv->id;
+    penv->usend = psend;
+  }
+  return _uring_recv(penv);
+}
+
+//release ring state of env before its fd is closed
+static void _uring_detach(REDISENV *penv)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISURING *puring = pspace->uring;
+  URINGSEND *psend = penv->usend;
+
+  if(!puring || (!psend && !penv->urecv))
+    return;
+
+  //sqes must take the file before fd number is reused. then shutdown ends recv and send in flight
+  _uring_enter(puring , 0);
+  shutdown(penv->hiredis_cxt->fd , SHUT_RDWR);
+  penv->urecv = 0;
+  penv->usend = NULL;
+  if(!psend)
+    return;
+
+  if(psend->busy)
+  {
+    psend->rd = -1;
+    puring->orphans++;
+    return;
+  }
+  sdsfree(psend->buf);
+  free(psend);
+}
+
+//arm multishot recv of env. data lands in provided buffers
+//return 0:success -1:failed
+static int _uring_recv(REDISENV *penv)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISURING *puring = pspace->uring;
+  struct io_uring_sqe *sqe = NULL;
+
+  sqe = _uring_sqe(puring);
+  if(!sqe)
+  {
+    slog_log(pspace->slog_d , SL_ERR , "<%s> no sqe! rd:%d" , __FUNCTION__ , penv->id);
+    return -1;
+  }
+
+  if(++puring->seq == 0) //0 means not armed
+    puring->seq = 1;
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = penv->hiredis_cxt->fd;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = URING_BGID;
+  sqe->user_data = ((unsigned long long)puring->seq<<32) | ((unsigned long long)penv->id<<3) | URING_UD_RECV;
+  penv->urecv = puring->seq;
+
+  if(!puring->batch)
+    _uring_enter(puring , 0);
+  return 0;
+}
+
+//send output of env. only one send in flight so that order is kept
+//return 0:success -1:failed
+static int _uring_send(REDISENV *penv)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISURING *puring = pspace->uring;
+  URINGSEND *psend = penv->usend;
+  redisContext *c = penv->hiredis_cxt;
+  struct io_uring_sqe *sqe = NULL;
+  sds tmp = NULL;
+  size_t len = 0;
+
+  //rest is sent when former one completes
+  if(psend->busy)
+    return 0;
+
+  //whole obuf handed to kernel without copy unless queued cmds are at tail
+  if(psend->off == 0)
+  {
+    len = sdslen(c->obuf) - penv->ov_bytes;
+    if(len == 0)
+      return 0;
+    if(penv->ov_bytes == 0)
+    {
+      tmp = psend->buf;
+      psend->buf = c->obuf;
+      c->obuf = tmp;
+    }
+    else
+    {
+      tmp = sdscatlen(psend->buf , c->obuf , len);
+      if(!tmp)
+        return -1;
+      psend->buf = tmp;
+      sdsrange(c->obuf , len , -1);
+    }
+  }
+
+  sqe = _uring_sqe(puring);
+  if(!sqe)
+  {
+    slog_log(pspace->slog_d , SL_ERR , "<%s> no sqe and send in next tick! rd:%d" , __FUNCTION__ , penv->id);
+    return _wqueue_push(penv);
+  }
+  sqe->opcode = IORING_OP_SEND;
+  sqe->fd = c->fd;
+  sqe->addr = (unsigned long long)(unsigned long)(psend->buf + psend->off);
+  sqe->len = (unsigned int)(sdslen(psend->buf) - psend->off);
+  sqe->msg_flags = MSG_NOSIGNAL;
+  sqe->user_data = (unsigned long long)(unsigned long)psend | URING_UD_SEND;
+  psend->busy = 1;
+
+  if(!puring->batch)
+    _uring_enter(puring , 0);
+  return 0;
+}
+
+//handle completions in ring
+static void _uring_reap()
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISURING *puring = pspace->uring;
+  struct io_uring_cqe *cqe = NULL;
+  URINGCQE stcqe;
+  unsigned long long ud = 0;
+  unsigned int head = 0;
+  unsigned int flags = 0;
+  int res = 0;
+  int i = 0;
+  int kept = 0;
+  int stash = -1;
+
+  //put aside by budget before. kept again while env is still cut off
+  for(i=0; i<puring->stash_len; i++)
+  {
+    memcpy(&stcqe , &puring->stash[i] , sizeof(URINGCQE));
+    if(_uring_stash(puring , &stcqe , kept) == 0)
+    {
+      kept++;
+      continue;
+    }
+    _uring_recv_done(stcqe.ud , stcqe.res , stcqe.flags);
+  }
+  puring->stash_len = kept;
+
+  //cqe copied and consumed first. callbacks may queue sqes or enter again
+  head = *puring->cq_head;
+  while(head != __atomic_load_n(puring->cq_tail , __ATOMIC_ACQUIRE))
+  {
+    cqe = &puring->cqes[head & puring->cq_mask];
+    ud = cqe->user_data;
+    res = cqe->res;
+    flags = cqe->flags;
+    stash = -1;
+    if((ud & URING_UD_MASK) == URING_UD_RECV)
+    {
+      stcqe.ud = ud;
+      stcqe.res = res;
+      stcqe.flags = flags;
+      stash = _uring_stash(puring , &stcqe , puring->stash_len);
+      if(stash == -2) //no room. rest left in ring till next tick
+        break;
+    }
+    head++;
+    __atomic_store_n(puring->cq_head , head , __ATOMIC_RELEASE);
+
+    switch(ud & URING_UD_MASK)
+    {
+      case URING_UD_SEND:
+        _uring_send_done((URINGSEND *)(unsigned long)ud , res);
+      break;
+      case URING_UD_RECV:
+        if(stash == 0)
+          puring->stash_len++;
+        else
+          _uring_recv_done(ud , res , flags);
+      break;
+      case URING_UD_POLL:
+        puring->poll_armed = 0;
+        puring->poll_ready = 1;
+      break;
+      default:
+      break;
+    }
+    head = *puring->cq_head;
+  }
+}
+
+//put recv completion aside at stash[pos] if budget is out and its env is cut off. one chunk is taken per env
+//so that envs rotate. the buffer held meanwhile throttles the socket. other completions go on
+//return 0:stashed -1:handle it now -2:stash can not grow
+static int _uring_stash(REDISURING *puring , URINGCQE *pcqe , int pos)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISENV *penv = NULL;
+  URINGCQE *new_stash = NULL;
+  int new_cap = 0;
+
+  if(!pspace->budget_out)
+    return -1;
+  penv = _uring_recv_env(pcqe->ud);
+  if(!penv || !penv->backlog)
+    return -1;
+
+  if(pos >= puring->stash_cap)
+  {
+    new_cap = puring->stash_cap? puring->stash_cap*2 : URING_BUF_COUNT;
+    new_stash = (URINGCQE *)realloc(puring->stash , new_cap*sizeof(URINGCQE));
+    if(!new_stash)
+      return -2;
+    puring->stash = new_stash;
+    puring->stash_cap = new_cap;
+  }
+  memcpy(&puring->stash[pos] , pcqe , sizeof(URINGCQE));
+  return 0;
+}
+
+//env owning a recv completion. NULL if closed or reconnected since
+static REDISENV *_uring_recv_env(unsigned long long ud)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISENV *penv = NULL;
+  int rd = (int)((ud>>3) & 0x1fffffff);
+  unsigned int seq = (unsigned int)(ud>>32);
+
+  if(!pspace->env_list || pspace->list_len<0 || rd>=(int)pow(2 , pspace->list_len))
+    return NULL;
+  penv = &pspace->env_list[rd];
+  if(penv->stat==REDIS_ENV_STAT_EMPTY || penv->urecv!=seq || !penv->hiredis_cxt)
+    return NULL;
+  return penv;
+}
+
+//data or end of multishot recv
+static void _uring_recv_done(unsigned long long ud , int res , unsigned int flags)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISURING *puring = pspace->uring;
+  REDISENV *penv = NULL;
+  int sld = pspace->slog_d;
+  int rd = (int)((ud>>3) & 0x1fffffff);
+  unsigned int gen = 0;
+  char *buf = NULL;
+  int ret = 0;
+
+  //stale completion of a closed or reconnected env is dropped
+  penv = _uring_recv_env(ud);
+  if(penv && !(flags & IORING_CQE_F_MORE)) //ended. armed again below
+    penv->urecv = 0;
+
+  //copy into reader and give buffer back at once
+  if(penv && res>0)
+  {
+    buf = _reader_room(penv , res);
+    if(buf)
+    {
+      memcpy(buf+sdslen(buf) , puring->bufs+(size_t)(flags>>IORING_CQE_BUFFER_SHIFT)*URING_BUF_SIZE , res);
+      sdsIncrLen(buf , res);
+      penv->hiredis_cxt->reader->len = sdslen(buf);
+    }
+  }
+  if(flags & IORING_CQE_F_BUFFER)
+    _uring_buf_put(puring , (unsigned short)(flags>>IORING_CQE_BUFFER_SHIFT));
+  if(!penv)
+    return;
+
+  if(res == 0) //server closed
+  {
+    slog_log(sld , SL_INFO , "<%s> server shutdown connection! rd:%d" , __FUNCTION__ , rd);
+    _redis_disconnect(rd);
+    penv->flag = REDIS_CONN_FLG_CLOSED;
+    return;
+  }
+
+  if((res<0 && res!=-ENOBUFS) || (res>0 && !buf))
+  {
+    slog_log(sld , SL_ERR , "<%s> recv failed! rd:%d err:%s" , __FUNCTION__ , rd , strerror(res<0? -res : ENOMEM));
+    _redis_disconnect(rd);
+    penv->flag = REDIS_CONN_FLG_CLOSED;
+    return;
+  }
+
+  //handle replies. rest of budget cut off is parsed in next tick
+  if(res > 0)
+  {
+    gen = penv->gen;
+    ret = _parse_env(penv);
+    if(ret==1 || ret<0)
+      return;
+    penv = _env_alive(rd , gen);
+    if(penv->ov_cnt > 0)
+      _ov_release(penv);
+  }
+
+  //buffers used up or recv ended by kernel
+  if(!penv->urecv && penv->hiredis_cxt && penv->flag==REDIS_CONN_FLG_CONNECTED)
+    _uring_recv(penv);
+}
+
+//send completed. partly sent bytes are sent again
+static void _uring_send_done(URINGSEND *psend , int res)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISURING *puring = pspace->uring;
+  REDISENV *penv = NULL;
+
+  psend->busy = 0;
+  if(psend->rd < 0) //env disconnected
+  {
+    puring->orphans--;
+    sdsfree(psend->buf);
+    free(psend);
+    return;
+  }
+  penv = &pspace->env_list[psend->rd];
+
+  if(res < 0)
+  {
+    slog_log(pspace->slog_d , SL_ERR , "<%s> send failed! rd:%d err:%s" , __FUNCTION__ , penv->id , strerror(-res));
+    _redis_disconnect(penv->id);
+    penv->flag = REDIS_CONN_FLG_CLOSED;
+    return;
+  }
+
+  psend->off += res;
+  if(psend->off < sdslen(psend->buf))
+  {
+    slog_log(pspace->slog_d , SL_INFO , "<%s> partly sent! rd:%d left:%d" , __FUNCTION__ , penv->id , 
+      (int)(sdslen(psend->buf)-psend->off));
+    _uring_send(penv);
+    return;
+  }
+
+  //all sent. output appended meanwhile goes next
+  psend->off = 0;
+  sdsclear(psend->buf);
+  _ov_release(penv);
+  if(sdslen(penv->hiredis_cxt->obuf) > penv->ov_bytes)
+    _flush_env(penv);
+}
+
+//give a recv buffer back to kernel
+static void _uring_buf_put(REDISURING *puring , unsigned short bid)
+{
+  struct io_uring_buf *pbuf = &puring->br->bufs[puring->br_tail & (URING_BUF_COUNT-1)];
+
+  pbuf->addr = (unsigned long long)(unsigned long)(puring->bufs + (size_t)bid*URING_BUF_SIZE);
+  pbuf->len = URING_BUF_SIZE;
+  pbuf->bid = bid;
+  puring->br_tail++;
+  __atomic_store_n(&puring->br->tail , puring->br_tail , __ATOMIC_RELEASE);
+}
+
+#else
+//io_uring headers not found when built. always epoll
+static int _uring_init(REDIS_GLOBALSPACE *pspace)
+{
+  return -1;
+}
+
+static void _uring_free(REDIS_GLOBALSPACE *pspace)
+{
+}
+
+static int _uring_notify(REDIS_GLOBALSPACE *pspace)
+{
+  return -1;
+}
+
+static int _redis_tick_uring()
+{
+  return -1;
+}
+
+static int _uring_attach(REDISENV *penv)
+{
+  return -1;
+}
+
+static void _uring_detach(REDISENV *penv)
+{
+}
+
+static int _uring_send(REDISENV *penv)
+{
+  return -1;
+}
+#endif
+
+//handle output appended by exec according to flush policy
+static int _env_appended(REDISENV *penv)
+{
+  CBINFO *pstCBInfo = &penv->cb_ring[(penv->cb_tail-1) & (penv->cb_size-1)];
+  int len = (int)(sdslen(penv->hiredis_cxt->obuf) - penv->obuf_mark);
+
+  //copy for replay or redirect. not resent if alloc failed
+  if((penv->exec_flags & REDIS_EXEC_IDEMPOTENT) && penv->reconn_min>0)
+    pstCBInfo->replay = 1;
+  if(!pstCBInfo->cmd && (pstCBInfo->replay || penv->cluster))
+  {
+    pstCBInfo->cmd = _slab_get(penv , len , &pstCBInfo->cmd_class);
+    if(pstCBInfo->cmd)
+    {
+      memcpy(pstCBInfo->cmd , penv->hiredis_cxt->obuf+penv->obuf_mark , len);
+      pstCBInfo->cmd_len = len;
+    }
+  }
+
+  //kept in overflow queue
+  if(pstCBInfo->queued)
+  {
+    pstCBInfo->qlen = len;
+    if(penv->ov_cnt == 0)
+      penv->ov_seq = penv->cb_tail - 1;
+    penv->ov_cnt++;
+    penv->ov_bytes += pstCBInfo->qlen;
+    return 0;
+  }
+
+  switch(penv->flush_policy)
+  {
+    case REDIS_FLUSH_IMMEDIATE:
+      if(!(penv->events & EPOLLOUT)) //not blocked by full sendbuff
+        return _flush_env(penv);
+    break;
+    case REDIS_FLUSH_BYTES:
+      //queued bytes at tail of obuf are not written
+      if(!(penv->events & EPOLLOUT) && sdslen(penv->hiredis_cxt->obuf)-penv->ov_bytes>=(size_t)penv->flush_bytes)
+        return _flush_env(penv);
+    break;
+    default:
+    break;
+  }
+
+  return _wqueue_push(penv);
+}
+
+//check backpressure limits before a cmd is pushed
+//return 0:send 1:queue -1:rejected
+static int _env_admit(REDISENV *penv)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDIS_LIMIT *plimit = &penv->limit;
+  long long pending = penv->cb_count - penv->ov_cnt;
+  long long obuf = (long long)_env_obuf(penv);
+  int over = 0;
+
+  //low priority shed earlier
+  if(plimit->policy==REDIS_LIMIT_SHED && (penv->exec_flags & REDIS_EXEC_LOWPRIO))
+  {
+    pending = pending * 100 / REDIS_SHED_PERCENT;
+    obuf = obuf * 100 / REDIS_SHED_PERCENT;
+  }
+
+  if(plimit->max_pending>0 && pending>=plimit->max_pending)
+    over = 1;
+  if(plimit->max_obuf>0 && obuf>=plimit->max_obuf)
+    over = 1;
+
+  //keep order behind queued cmds
+  if(plimit->policy==REDIS_LIMIT_QUEUE && (over || penv->ov_cnt>0))
+  {
+    if(penv->ov_cnt < plimit->max_queue)
+      return 1;
+    over = 1;
+  }
+
+  if(over)
+  {
+    slog_log(pspace->slog_d , SL_ERR , "<%s> rejected! pending:%d obuf:%d queued:%d rd:%d" , __FUNCTION__ , 
+      penv->cb_count-penv->ov_cnt , (int)_env_obuf(penv) , penv->ov_cnt , penv->id);
+    return -1;
+  }
+  return 0;
+}
+
+//bytes of output not written. queued cmds excluded
+static size_t _env_obuf(REDISENV *penv)
+{
+  size_t len = sdslen(penv->hiredis_cxt->obuf) - penv->ov_bytes;
+
+  if(penv->usend && penv->usend->busy)
+    len += sdslen(penv->usend->buf) - penv->usend->off;
+  return len;
+}
+
+//bytes of reader side:unparsed data and replies being built in arena
+static size_t _env_ibuf(REDISENV *penv)
+{
+  redisReader *r = penv->hiredis_cxt->reader;
+  return (r->len - r->pos) + (penv->arena? penv->arena->used : 0);
+}
+
+//move queued cmds into sending part of obuf while under limits
+//return number of released cmds
+static int _ov_release(REDISENV *penv)
+{
+  REDIS_LIMIT *plimit = &penv->limit;
+  CBINFO *pstCBInfo = NULL;
+  int count = 0;
+
+  while(penv->ov_cnt > 0)
+  {
+    if(plimit->max_pending>0 && penv->cb_count-penv->ov_cnt>=plimit->max_pending)
+      break;
+    if(plimit->max_obuf>0 && _env_obuf(penv)>=(size_t)plimit->max_obuf)
+      break;
+
+    pstCBInfo = &penv->cb_ring[penv->ov_seq & (penv->cb_size-1)];
+    pstCBInfo->queued = 0;
+    penv->ov_bytes -= pstCBInfo->qlen;
+    penv->ov_cnt--;
+    penv->ov_seq++;
+    count++;
+  }
+
+  if(count > 0)
+    _wqueue_push(penv);
+  return count;
+}
+
+static int _wqueue_push(REDISENV *penv)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+
+  if(penv->wqueued)
+    return 0;
+
+  //reactor of exported epfd comes back to flush
+  if(pspace->pollfd_on && pspace->wqueue_len==0)
+    _wake(pspace);
+
+  //queue full.[rd reopened in one tick] let epoll report writable
+  if(pspace->wqueue_len>=REDIS_MAX_OPEN_NUM && penv->usend)
+    return _flush_env(penv);
+  if(pspace->wqueue_len >= REDIS_MAX_OPEN_NUM)
+    return _env_watch(penv , EPOLLIN|EPOLLOUT);
+
+  pspace->wqueue[pspace->wqueue_len++] = penv->id;
+  penv->wqueued = 1;
+  return 0;
+}
+
+
+
+
+//return 0:handled -1:failed 1:handled and reply kept by batch[arena should not be reset]
+static int _handle_reply(REDISENV *pstEnv , REPLYNODE *pstReply)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+
+  int result = CB_RET_SUCCESS;
+  int argc = 0;
+  char **argv = NULL;
+  int *arglen = NULL;
+
+  char buff[128];
+  CBINFO stCBInfo;
+  CBINFO *pstCBInfo = &stCBInfo;
+  CBINFO *pslot = NULL;
+  int sld = pspace->slog_d;
+  int rd = -1;
+  unsigned int gen = 0;
+  int len = 0;
+  
+  /***Arg Check*/
+  if(!pstEnv || !pstReply)
+    return -1;
+  rd = pstEnv->id;
+  gen = pstEnv->gen;
+
+  /***Message of Subscriber. pushed without cmd so no callback slot*/
+  if(pstEnv->sub)
+    return _sub_dispatch(pstEnv , pstReply);
+
+  /***Batch Member. kept in head slot*/
+  if(pstEnv->cb_count > 0)
+  {
+    pslot = &pstEnv->cb_ring[pstEnv->cb_head & (pstEnv->cb_size-1)];
+    if(pslot->batch_n>0 && pslot->batch_got+1<pslot->batch_n)
+    {
+      pslot->batch_reply[pslot->batch_got++] = pstReply;
+      return 1;
+    }
+  }
+
+  /***POP CBFUNC*/
+  if(_hpop_cbi(pstEnv , pstCBInfo) < 0)
+  {
+    slog_log(sld , SL_ERR , "<%s>:drop response for cb null! rd:%d fd:%d" , __FUNCTION__ , pstEnv->id , 
+      pstEnv->hiredis_cxt->fd);
+    return -1;
+  }
+
+  /***Read Latency of Replica Group. late ones sampled too*/
+  if(pstCBInfo->sent_us > 0)
+    _repl_sample(pstEnv , _now_us()-pstCBInfo->sent_us);
+
+  /***Late Reply. callback already fired with CB_RET_TIMEOUT*/
+  if(pstCBInfo->stat == CB_INFO_STAT_TIMEOUT)
+  {
+    slog_log(sld , SL_DEBUG , "<%s> drop late reply! rd:%d" , __FUNCTION__ , rd);
+    _free_cb(pstEnv , pstCBInfo);
+    return 0;
+  }
+
+  /***Last Reply of Batch*/
+  if(pstCBInfo->batch_n > 0)
+  {
+    pstCBInfo->batch_reply[pstCBInfo->batch_got++] = pstReply;
+    _dispatch_batch(pstEnv , pstCBInfo);
+    _free_cb(_env_alive(rd , gen) , pstCBInfo);
+    return 0;
+  }
+
+  /***Cluster Redirect. cmd resent to the node and error not surfaced*/
+  if(pstEnv->cluster && pstReply->type==REDIS_REPLY_ERROR && pstCBInfo->cmd)
+  {
+    if(_cluster_redirect(pstEnv , pstCBInfo , pstReply) == 0)
+      return 0;
+    pstEnv = &pspace->env_list[rd]; //list may grow when node opened
+  }
+  
+  /***Construct Args. point into arena directly*/
+  slog_log(sld , SL_VERBOSE , "<%s> reply type:%d rd:%d" , __FUNCTION__ , pstReply->type , pstEnv->id);
+  switch(pstReply->type)
+  {
+    case REDIS_REPLY_STRING:
+    case REDIS_REPLY_STATUS:    
+    case REDIS_REPLY_INTEGER:
+    case REDIS_REPLY_DOUBLE:
+    case REDIS_REPLY_BOOL:
+    case REDIS_REPLY_BIGNUM:
+    case REDIS_REPLY_VERB:
+      slog_log(sld , SL_VERBOSE , "result:%s" , pstReply->str);
+      argv = &pstReply->str;
+      arglen = &pstReply->len;
+      argc = 1;
+    break;
+
+    case REDIS_REPLY_ERROR:    
+      slog_log(sld , SL_VERBOSE , "result:%s" , pstReply->str);
+      result = CB_RET_ERROR;
+      argv = &pstReply->str; //error info
+      arglen = &pstReply->len;
+      argc = 1;
+    break;
+
+    case REDIS_REPLY_NIL:
+      slog_log(sld , SL_VERBOSE , "result empty");
+      result = CB_RET_NO_NIL;
+    break;
+ 
+    case REDIS_REPLY_ARRAY:
+    case REDIS_REPLY_MAP:
+    case REDIS_REPLY_SET:
+    case REDIS_REPLY_PUSH:
+      argv = pstReply->argv;
+      arglen = pstReply->arglen;
+      argc = pstReply->len;
+    break;
+    default:
+      len = snprintf(buff , sizeof(buff) , "illegal reply type:%d" , pstReply->type);
+      result = CB_RET_ERROR;
+      pstReply->str = buff; //error info
+      pstReply->len = len;
+      argv = &pstReply->str;
+      arglen = &pstReply->len;
+      argc = 1;
+      slog_log(sld , SL_FATAL , "<%s> can not handle it right now! rd:%d fd:%d" , __FUNCTION__ , pstEnv->id , 
+        pstEnv->hiredis_cxt->fd);
+    break;
+  }
+  
+  /***Call CallBack Function*/
+  if(pstCBInfo->stat==CB_INFO_STAT_VALID && pstCBInfo->reply_func)
+  {
+    slog_log(sld , SL_VERBOSE , "exe typed call back! rd:%d" , pstEnv->id);
+    (*pstCBInfo->reply_func)(pstCBInfo->private , pstCBInfo->private_len , result , pstReply);
+  }
+  else if(pstCBInfo->stat == CB_INFO_STAT_VALID)
+  {
+    slog_log(sld , SL_VERBOSE , "exe call back! rd:%d" , pstEnv->id);
+    (*pstCBInfo->func)(pstCBInfo->private , pstCBInfo->private_len , result , argc , argv , arglen);
+  }
+  else
+    slog_log(sld , SL_VERBOSE , "no call back! rd:%d" , pstEnv->id);
+
+  //env may be closed or moved in callback
+  _free_cb(_env_alive(rd , gen) , pstCBInfo);
+  return 0;  
+}
+
+
+
+//PUSH a CBINFO slot into Tail of CallBack Ring in Env. ring grows if full
+//return NULL:failed else pointer of cleared slot[valid until next push]
+static CBINFO *_tpush_cbi(REDISENV *pstEnv)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  CBINFO *new_ring = NULL;
+  CBINFO *pstCBInfo = NULL;
+  unsigned int new_size = 0;
+  unsigned int seq = 0;
+  
+  /***Arg Check*/
+  if(!pstEnv)
+  {
+    printf("%s failed! arg null!\n" , __FUNCTION__);
+    return NULL;
+  }
+
+  //full. grow and keep seq->slot mapping
+  if(pstEnv->cb_tail - pstEnv->cb_head >= pstEnv->cb_size)
+  {
+    new_size = pstEnv->cb_size? pstEnv->cb_size*2 : DEFAULT_CB_RING_SIZE;
+    new_ring = (CBINFO *)calloc(new_size , sizeof(CBINFO));
+    if(!new_ring)
+    {
+      slog_log(pspace->slog_d , SL_ERR , "<%s> failed! alloc ring:%u err:%s rd:%d" , __FUNCTION__ , new_size , 
+        strerror(errno) , pstEnv->id);
+      return NULL;
+    }
+
+    for(seq=pstEnv->cb_head; seq!=pstEnv->cb_tail; seq++)
+    {
+      pstCBInfo = &new_ring[seq & (new_size-1)];
+      memcpy(pstCBInfo , &pstEnv->cb_ring[seq & (pstEnv->cb_size-1)] , sizeof(CBINFO));
+      if(pstEnv->cb_ring[seq & (pstEnv->cb_size-1)].private == pstEnv->cb_ring[seq & (pstEnv->cb_size-1)].private_data)
+        pstCBInfo->private = pstCBInfo->private_data;
+    }
+    free(pstEnv->cb_ring);
+    pstEnv->cb_ring = new_ring;
+    pstEnv->cb_size = new_size;
+    slog_log(pspace->slog_d , SL_INFO , "<%s> callback ring grows to %u rd:%d" , __FUNCTION__ , new_size , pstEnv->id);
+  }
+
+  //push to tail
+  pstCBInfo = &pstEnv->cb_ring[pstEnv->cb_tail & (pstEnv->cb_size-1)];
+  pstCBInfo->stat = CB_INFO_STAT_NULL;
+  pstCBInfo->slab_class = CB_SLAB_NONE;
+  pstCBInfo->func = NULL;
+  pstCBInfo->batch_func = NULL;
+  pstCBInfo->reply_func = NULL;
+  pstCBInfo->private = NULL;
+  pstCBInfo->private_len = 0;
+  pstCBInfo->batch_n = 0;
+  pstCBInfo->batch_got = 0;
+  pstCBInfo->batch_reply = NULL;
+  pstCBInfo->queued = 0;
+  pstCBInfo->qlen = 0;
+  pstCBInfo->timer = -1;
+  pstCBInfo->recycle = 0;
+  pstCBInfo->cmd = NULL;
+  pstCBInfo->cmd_len = 0;
+  pstCBInfo->cmd_class = CB_SLAB_NONE;
+  pstCBInfo->replay = 0;
+  pstCBInfo->redirect = 0;
+  pstCBInfo->sent_us = 0;
+  pstEnv->cb_tail++;
+  pstEnv->cb_count++;
+  return pstCBInfo;
+}
+
+//Cancel last pushed CBINFO when cmd is not appended
+static int _tcancel_cbi(REDISENV *pstEnv)
+{
+  CBINFO *pstCBInfo = NULL;
+  if(!pstEnv || pstEnv->cb_count<=0)
+    return -1;
+
+  pstEnv->cb_tail--;
+  pstEnv->cb_count--;
+  pstCBInfo = &pstEnv->cb_ring[pstEnv->cb_tail & (pstEnv->cb_size-1)];
+  _free_cb(pstEnv , pstCBInfo);
+  return 0;
+}
+
+//POP a CBINFO out of head of CallBack Ring in Env
+//copy to pstCBInfo so that it is safe if ring changes in callback
+//return 0:success -1:failed or empty
+static int _hpop_cbi(REDISENV *pstEnv , CBINFO *pstCBInfo)
+{
+  CBINFO *pslot = NULL;
+
+  /***Arg Check*/
+  if(!pstEnv || !pstCBInfo)
+  {
+    printf("%s failed! arg null!\n" , __FUNCTION__);
+    return -1;
+  }
+  
+  if(pstEnv->cb_count <= 0)
+  {
+    printf("%s failed! callback list empty!\n" , __FUNCTION__);
+    return -1;
+  }
+
+  //pop head
+  pslot = &pstEnv->cb_ring[pstEnv->cb_head & (pstEnv->cb_size-1)];
+  memcpy(pstCBInfo , pslot , sizeof(CBINFO));
+  if(pslot->private == pslot->private_data)
+    pstCBInfo->private = pstCBInfo->private_data;
+  pstEnv->cb_head++;
+  pstEnv->cb_count--;
+  return 0;
+}
+
+//save callback info into a new ring slot
+//return 0:success -1:failed
+//return NULL:failed else slot[valid until next push]
+static CBINFO *_save_cb(REDISENV *pstEnv , REDIS_CALLBACK callback , REDIS_REPLY_CALLBACK reply_func , 
+  char *private , int private_len)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  int sld = pspace->slog_d;
+  CBINFO *pstCBInfo = NULL;
+  int rd = pstEnv->id;
+  int admit = 0;
+
+  //replies of subscriber are messages
+  if(pstEnv->sub)
+  {
+    slog_log(sld , SL_ERR , "<%s> failed! rd is subscriber! rd:%d" , __FUNCTION__ , rd);
+    return NULL;
+  }
+
+  //backpressure
+  admit = _env_admit(pstEnv);
+  if(admit < 0)
+    return NULL;
+
+  pstCBInfo = _tpush_cbi(pstEnv);
+  if(!pstCBInfo)
+  {
+    slog_log(sld , SL_ERR , "<%s> failed! Alloc CBINFO FAIL! rd:%d" , __FUNCTION__ , rd);
+    return NULL;
+  }
+  pstCBInfo->queued = admit;
+  pstEnv->obuf_mark = sdslen(pstEnv->hiredis_cxt->obuf);
+
+  //deadline
+  if(pstEnv->exec_timeout > 0)
+  {
+    pstCBInfo->recycle = pstEnv->timeout_recycle;
+    pstCBInfo->timer = _timer_add(pstEnv , pstEnv->cb_tail-1 , _now_ms()+pstEnv->exec_timeout);
+    if(pstCBInfo->timer < 0)
+    {
+      slog_log(sld , SL_ERR , "<%s> failed! Alloc timer FAIL! rd:%d" , __FUNCTION__ , rd);
+      _tcancel_cbi(pstEnv);
+      return NULL;
+    }
+  }
+
+  if(callback)
+  {
+    pstCBInfo->stat = CB_INFO_STAT_VALID;
+    pstCBInfo->func = callback;
+  }
+  else if(reply_func)
+  {
+    pstCBInfo->stat = CB_INFO_STAT_VALID;
+    pstCBInfo->reply_func = reply_func;
+  }
+
+  //NO PRIVATE DATA
+  if(!private || private_len<=0)
+  {
+    slog_log(sld , SL_DEBUG , "<%s> no private stored! rd:%d" , __FUNCTION__ , rd);      
+    return pstCBInfo;
+  }
+  pstCBInfo->private_len = private_len;
+
+  //PRIVATE LEN <= DEFAULT_CB_PRIVATE_LEN
+  if(private_len <= DEFAULT_CB_PRIVATE_LEN)
+  {
+    slog_log(sld , SL_VERBOSE , "<%s> default private len enough! rd:%d" , __FUNCTION__ , rd);
+    pstCBInfo->private = pstCBInfo->private_data;
+    memcpy(pstCBInfo->private , private , private_len);      
+    return pstCBInfo;
+  }
+
+  //PRIVATE_LEN > DEFAULT_CB_PRIVATE_LEN. reuse slab buffer first
+  pstCBInfo->private = _slab_get(pstEnv , private_len , &pstCBInfo->slab_class);
+  if(!pstCBInfo->private)
+  {
+    slog_log(sld , SL_ERR , "<%s> failed! Alloc CBINFO PRIVATE DATA:%d FAIL! err:%s rd:%d" , __FUNCTION__ , 
+      private_len , strerror(errno) , rd);
+    pstCBInfo->private_len = 0;
+    _tcancel_cbi(pstEnv);
+    return NULL;
+  }
+  memcpy(pstCBInfo->private , private , private_len);
+  return pstCBInfo;
+}
+
+//buffer of len from slab of env. malloc if free list empty or len exceeds largest class
+//pcls:class of buffer. CB_SLAB_NONE if len exceeds largest class
+static char *_slab_get(REDISENV *penv , int len , char *pcls)
+{
+  char *buf = NULL;
+  int cls = 0;
+
+  for(cls=0; cls<CB_SLAB_CLASS; cls++)
+  {
+    if(len <= (1<<(CB_SLAB_MIN_SHIFT+cls)))
+      break;
+  }
+  *pcls = cls<CB_SLAB_CLASS? cls : CB_SLAB_NONE;
+
+  if(cls<CB_SLAB_CLASS && penv->cb_slab[cls])
+  {
+    buf = penv->cb_slab[cls];
+    penv->cb_slab[cls] = *(char **)buf;
+    return buf;
+  }
+  return (char *)malloc(cls<CB_SLAB_CLASS? (1<<(CB_SLAB_MIN_SHIFT+cls)) : len);
+}
+
+//give buffer back to slab of env. freed if no env or not of a class
+static void _slab_put(REDISENV *penv , char *buf , char cls)
+{
+  if(penv && cls!=CB_SLAB_NONE)
+  {
+    *(char **)buf = penv->cb_slab[(int)cls];
+    penv->cb_slab[(int)cls] = buf;
+  }
+  else
+    free(buf);
+}
+
+//Drain all CBINFO of env in one sweep
+static void _drain_cb(REDISENV *penv)
+{
+  CBINFO *pcb = NULL;
+  unsigned int seq = 0;
+  if(!penv || !penv->cb_ring)
+    return;
+
+  for(seq=penv->cb_head; seq!=penv->cb_tail; seq++)
+  {
+    pcb = &penv->cb_ring[seq & (penv->cb_size-1)];
+    if(pcb->stat==CB_INFO_STAT_VALID && pcb->func==_gather_cb)
+      _gather_drop(pcb);
+    else if(pcb->stat==CB_INFO_STAT_VALID && pcb->func==_hedge_cb)
+      _hedge_drop(pcb);
+    else if(pcb->stat==CB_INFO_STAT_VALID && pcb->func==_io_cb)
+      _io_drop(pcb);
+    _free_cb(penv , pcb);
+  }
+
+  penv->cb_head = penv->cb_tail;
+  penv->cb_count = 0;
+  return;
+}
+
+static void _print_space()
+{
+  REDISENV *penv = NULL;
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  int i = 0;
+  int sld = -1;
+  int real_len = 0;
+  
+
+  if(pspace->slog_d < 0)
+    return;
+
+  sld = pspace->slog_d;
+  //real_len
+  if(pspace->env_list && pspace->list_len>=0)
+    real_len = (int)pow(2 , pspace->list_len);
+
+  
+  //PRINT 
+  slog_log(sld, SL_VERBOSE , "(((=============PRINT=============");
+  slog_log(sld , SL_VERBOSE , "----valid_count:%d list_len:%d----" , pspace->valid_count , pspace->list_len);
+  for(i=0; i<real_len; i++)
+  {
+    penv = &pspace->env_list[i];
+    slog_log(sld, SL_VERBOSE, "stat:%d id:%d ip:%s port:%d cb_count:%d", penv->stat , penv->id , penv->ip , 
+      penv->port , penv->cb_count);
+  }
+  slog_log(sld, SL_VERBOSE , "=============END=============)))");
+
+  return;
+}
+
+static REDISENV *_rd2env(int rd , const char *caller)
+{
+  REDISENV *penv = NULL;
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  int real_len = 0;
+  int sld = -1;
+  int i;
+
+  /***Arg Check*/
+  sld = pspace->slog_d;
+  if(sld < 0) //not opened yet
+    return NULL;
+
+  if(!caller)
+  {
+    slog_log(sld, SL_ERR, "<%s> failed! caller nil! rd:%d", __FUNCTION__ , rd);
+    return NULL;
+  }
+
+  //empty list
+  if(!pspace->env_list || pspace->list_len<0)
+  {
+    slog_log(sld, SL_ERR, "<%s> failed! Empty List! rd:%d caller:%s", __FUNCTION__ , rd , caller);
+    return NULL;
+  }
+
+  //rd
+  real_len = (int)pow(2 , pspace->list_len);
+  if(rd<0 || rd>=real_len)
+  {
+    slog_log(sld, SL_ERR, "<%s> failed! rd illegal! rd:%d real_len:%d caller:%s", __FUNCTION__ , rd , 
+      real_len , caller);
+    return NULL;  
+  }
+
+  /***Get Env*/
+  penv = &pspace->env_list[rd];
+  if(penv->stat == REDIS_ENV_STAT_EMPTY)
+  {
+    slog_log(sld, SL_ERR, "<%s> failed! rd not used! rd:%d caller:%s", __FUNCTION__ , rd , caller);
+    return NULL;
+  }
+
+  if(penv->id != rd)
+  {
+    slog_log(sld, SL_ERR, "<%s> failed! rd not match! rd:%d id:%d caller:%s", __FUNCTION__ , rd , 
+      penv->id , caller);
+    return NULL;
+  }
+
+  //slog_log(sld, SL_VERBOSE , "<%s> success! rd:%d caller:%s", __FUNCTION__ , rd , caller);
+  return penv;
+}
+
+//Clear most member. except stat,id
+static int _reset_env(REDISENV *penv)
+{
+  /***Arg Check*/
+  if(!penv)
+    return -1;
+
+  //Clear
+  memset(penv->ip , 0 , sizeof(penv->ip));
+  penv->port = 0;
+  penv->hiredis_cxt = NULL;
+  penv->flag = REDIS_CONN_FLG_NONE;
+  _drain_cb(penv);
+  penv->connect_end_ms = 0;
+  penv->timeout_ms = 0;
+  penv->events = 0;
+  penv->wqueued = 0;
+  penv->hold = 0;
+  penv->reconn_at_ms = 0;
+  penv->reconn_attempt = 0;
+  if(penv->recycle_timer > 0)
+  {
+    _timer_del(penv->recycle_timer-1);
+    penv->recycle_timer = 0;
+  }
+
+  return 0;
+}
+
+//clear connection info
+static int _redis_disconnect(int rd)
+{
+  REDISENV *pstEnv = NULL;
+  pstEnv = NULL;
+  int sld = -1;
+  REDIS_GLOBALSPACE *pspace = redis_space;  
+
+  /***Check Basic*/
+  sld = pspace->slog_d;
+  if(sld < 0)
+    return -1;
+
+  /***Get Env*/
+  pstEnv = _rd2env(rd, __FUNCTION__);
+  if(!pstEnv)
+    return -1;
+
+  /***Handle*/
+  //free hiredis info
+  if(pstEnv->hiredis_cxt)
+  {
+    _uring_detach(pstEnv);
+    _env_unwatch(pstEnv);
+    redisFree(pstEnv->hiredis_cxt);
+    pstEnv->hiredis_cxt = NULL;
+  }
+
+  //unparsed replies are dropped with reader
+  if(pstEnv->backlog)
+  {
+    pstEnv->backlog = 0;
+    pspace->backlog_cnt--;
+  }
+
+  //free callback info. managed env holds them until sorted out in tick
+  if(pstEnv->reconn_min > 0)
+    pstEnv->hold = 1;
+  else
+    _drain_cb(pstEnv);
+  _arena_reset(pstEnv->arena);
+  pstEnv->ov_cnt = 0;
+  pstEnv->ov_bytes = 0;
+   
+  slog_log(sld , SL_INFO , "<%s> success! rd:%d" , __FUNCTION__ , rd);
+  return 0;
+}
+
+//release private buffer of a popped or drained CBINFO
+//penv: owner env or NULL if closed
+static void _free_cb(REDISENV *penv , CBINFO *pcb)
+{
+  if(!pcb)
+    return;
+
+  if(pcb->timer >= 0)
+  {
+    _timer_del(pcb->timer);
+    pcb->timer = -1;
+  }
+
+  if(pcb->cmd)
+  {
+    _slab_put(penv , pcb->cmd , pcb->cmd_class);
+    pcb->cmd = NULL;
+    pcb->cmd_len = 0;
+    pcb->cmd_class = CB_SLAB_NONE;
+  }
+
+  if(pcb->private_len > DEFAULT_CB_PRIVATE_LEN && pcb->private)
+    _slab_put(penv , pcb->private , pcb->slab_class);
+  pcb->private = NULL;
+  pcb->private_len = 0;
+
+  //replies of batch are in arena
+  if(pcb->batch_reply)
+  {
+    free(pcb->batch_reply);
+    pcb->batch_reply = NULL;
+    pcb->batch_got = 0;
+  }
+  return;
+}
+
+//free ring and slab of a closing env
+static void _free_env_mem(REDISENV *penv)
+{
+  char *pbuf = NULL;
+  int i = 0;
+
+  if(!penv)
+    return;
+
+  _drain_cb(penv);
+  _sub_free(penv);
+  _arena_free(penv->arena);
+  penv->arena = NULL;
+  free(penv->cb_ring);
+  penv->cb_ring = NULL;
+  penv->cb_size = 0;
+  for(i=0; i<CB_SLAB_CLASS; i++)
+  {
+    while(penv->cb_slab[i])
+    {
+      pbuf = penv->cb_slab[i];
+      penv->cb_slab[i] = *(char **)pbuf;
+      free(pbuf);
+    }
+  }
+  return;
+}
+
+//env of rd if it is not closed or reopened
+static REDISENV *_env_alive(int rd , unsigned int gen)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISENV *penv = NULL;
+
+  if(!pspace->env_list || pspace->list_len<0 || rd<0 || rd>=(int)pow(2 , pspace->list_len))
+    return NULL;
+
+  penv = &pspace->env_list[rd];
+  if(penv->stat==REDIS_ENV_STAT_EMPTY || penv->gen!=gen)
+    return NULL;
+  return penv;
+}
+
+//monotonic clock in ms
+static long long _now_ms()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC , &ts);
+  return (long long)ts.tv_sec*1000 + ts.tv_nsec/1000000;
+}
+
+static long long _now_us()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC , &ts);
+  return (long long)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+
+//xorshift
+static unsigned int _rand_next()
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+
+  if(pspace->rand_seed == 0)
+    pspace->rand_seed = (unsigned int)_now_us() ^ (unsigned int)getpid() ^ 0x9e3779b9;
+  pspace->rand_seed ^= pspace->rand_seed << 13;
+  pspace->rand_seed ^= pspace->rand_seed >> 17;
+  pspace->rand_seed ^= pspace->rand_seed << 5;
+  return pspace->rand_seed;
+}
+
+
+//encode argv as RESP straight into hiredis output buff. no temp buffer
+//return 0:success -1:failed
+static int _append_argv(REDISENV *penv , int argc , const char **argv , const size_t *argvlen)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  redisContext *c = penv->hiredis_cxt;
+  sds obuf = NULL;
+  char *p = NULL;
+  char num[32];
+  size_t total = 0;
+  size_t len = 0;
+  int i = 0;
+
+  //total length
+  total = 1 + _ll2str(num , argc) + 2;
+  for(i=0; i<argc; i++)
+  {
+    len = argvlen? argvlen[i] : strlen(argv[i]);
+    total += 1 + _ll2str(num , (long long)len) + 2 + len + 2;
+  }
+  if(total > INT_MAX) //sdsIncrLen takes int
+  {
+    slog_log(pspace->slog_d , SL_ERR , "<%s> failed! cmd too large! rd:%d len:%lu" , __FUNCTION__ , penv->id , 
+      (unsigned long)total);
+    return -1;
+  }
+
+  obuf = sdsMakeRoomFor(c->obuf , total);
+  if(!obuf)
+  {
+    slog_log(pspace->slog_d , SL_ERR , "<%s> failed! out of memory! rd:%d len:%lu" , __FUNCTION__ , penv->id , 
+      (unsigned long)total);
+    return -1;
+  }
+  c->obuf = obuf;
+
+  //encode
+  p = obuf + sdslen(obuf);
+  *p++ = '*';
+  p += _ll2str(p , argc);
+  *p++ = '\r';
+  *p++ = '\n';
+  for(i=0; i<argc; i++)
+  {
+    len = argvlen? argvlen[i] : strlen(argv[i]);
+    *p++ = '$';
+    p += _ll2str(p , (long long)len);
+    *p++ = '\r';
+    *p++ = '\n';
+    memcpy(p , argv[i] , len);
+    p += len;
+    *p++ = '\r';
+    *p++ = '\n';
+  }
+  sdsIncrLen(obuf , (int)total);
+  return 0;
+}
+
+//decimal of value without snprintf. buf has 21 bytes at least
+//return length written.[no '\0']
+static int _ll2str(char *buf , long long value)
+{
+  char tmp[24];
+  unsigned long long v = 0;
+  int len = 0;
+  int i = 0;
+
+  if(value < 0)
+  {
+    buf[i++] = '-';
+    v = (unsigned long long)(-(value+1)) + 1;
+  }
+  else
+    v = (unsigned long long)value;
+
+  do
+  {
+    tmp[len++] = '0' + (char)(v % 10);
+    v /= 10;
+  }
+  while(v);
+
+  while(len > 0)
+    buf[i++] = tmp[--len];
+  return i;
+}
+
+//make room for need bytes of args in cmd
+//return 0:success -1:failed
+static int _cmd_reserve(redis_cmd_t *cmd , int need)
+{
+  char *new_buf = NULL;
+  int new_size = cmd->size;
+
+  if(REDIS_CMD_HEAD_LEN+cmd->len+need <= cmd->size)
+    return 0;
+
+  while(REDIS_CMD_HEAD_LEN+cmd->len+need > new_size)
+    new_size *= 2;
+
+  new_buf = (char *)realloc(cmd->buf , new_size);
+  if(!new_buf)
+    return -1;
+
+  cmd->buf = new_buf;
+  cmd->size = new_size;
+  return 0;
+}
+
+//append static bytes of template. merged into last raw op if adjacent
+//return 0:success -1:failed
+static int _tpl_raw(redis_tpl_t *tpl , int *raw_size , const char *data , int len)
+{
+  TPLOP *pop = NULL;
+  char *new_raw = NULL;
+  int new_size = *raw_size;
+
+  if(tpl->raw_len+len > *raw_size)
+  {
+    if(new_size <= 0)
+      new_size = 64;
+    while(tpl->raw_len+len > new_size)
+      new_size *= 2;
+    new_raw = (char *)realloc(tpl->raw , new_size);
+    if(!new_raw)
+      return -1;
+    tpl->raw = new_raw;
+    *raw_size = new_size;
+  }
+  memcpy(tpl->raw+tpl->raw_len , data , len);
+
+  if(tpl->nop>0 && tpl->ops[tpl->nop-1].op==TPL_OP_RAW)
+    tpl->ops[tpl->nop-1].len += len;
+  else
+  {
+    if(tpl->nop >= REDIS_TPL_MAX_OP)
+      return -1;
+    pop = &tpl->ops[tpl->nop++];
+    pop->op = TPL_OP_RAW;
+    pop->off = tpl->raw_len;
+    pop->len = len;
+  }
+  tpl->raw_len += len;
+  return 0;
+}
+
+//write *<argc>\r\n right before args of cmd
+//return start of encoded cmd and its length in len
+static char *_cmd_head(redis_cmd_t *cmd , int *len)
+{
+  char num[32];
+  char *head = NULL;
+  int nlen = 0;
+
+  nlen = _ll2str(num , cmd->argc);
+  head = cmd->buf + REDIS_CMD_HEAD_LEN - (1+nlen+2);
+  head[0] = '*';
+  memcpy(head+1 , num , nlen);
+  head[1+nlen] = '\r';
+  head[2+nlen] = '\n';
+  *len = 1+nlen+2+cmd->len;
+  return head;
+}
+
+//call batch callback with all replies in one vector
+//return 0:success -1:failed
+static int _dispatch_batch(REDISENV *pstEnv , CBINFO *pstCBInfo)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDIS_BATCH_REPLY *replies = NULL;
+  REPLYNODE *pstReply = NULL;
+  int i = 0;
+
+  if(pstCBInfo->stat!=CB_INFO_STAT_VALID || !pstCBInfo->batch_func)
+    return 0;
+
+  //vector in arena too
+  replies = (REDIS_BATCH_REPLY *)_arena_alloc(pstEnv->arena , pstCBInfo->batch_n*sizeof(REDIS_BATCH_REPLY));
+  if(!replies)
+  {
+    slog_log(pspace->slog_d , SL_ERR , "<%s> failed! alloc batch:%d err:%s rd:%d" , __FUNCTION__ , pstCBInfo->batch_n , 
+      strerror(errno) , pstEnv->id);
+    return -1;
+  }
+
+  //construct each reply
+  for(i=0; i<pstCBInfo->batch_n; i++)
+  {
+    pstReply = pstCBInfo->batch_reply[i];
+    replies[i].result = CB_RET_SUCCESS;
+    replies[i].argc = 1;
+    replies[i].argv = &pstReply->str;
+    replies[i].arglen = &pstReply->len;
+    switch(pstReply->type)
+    {
+      case REDIS_REPLY_ERROR:
+        replies[i].result = CB_RET_ERROR; //error info in argv[0]
+      break;
+      case REDIS_REPLY_NIL:
+        replies[i].result = CB_RET_NO_NIL;
+        replies[i].argc = 0;
+      break;
+      case REDIS_REPLY_ARRAY:
+      case REDIS_REPLY_MAP:
+      case REDIS_REPLY_SET:
+      case REDIS_REPLY_PUSH:
+        replies[i].argc = pstReply->len;
+        replies[i].argv = pstReply->argv;
+        replies[i].arglen = pstReply->arglen;
+      break;
+      default:
+      break;
+    }
+  }
+
+  slog_log(pspace->slog_d , SL_VERBOSE , "exe batch call back! rd:%d count:%d" , pstEnv->id , pstCBInfo->batch_n);
+  (*pstCBInfo->batch_func)(pstCBInfo->private , pstCBInfo->private_len , pstCBInfo->batch_n , replies);
+  return 0;
+}
+
+//install arena reply functions into reader of a new hiredis context
+//return 0:success -1:failed
+static int _env_reader(REDISENV *penv)
+{
+  static redisReplyObjectFunctions arena_fn = {
+    _reply_create_string,
+    _reply_create_array,
+    _reply_create_integer,
+    _reply_create_double,
+    _reply_create_nil,
+    _reply_create_bool,
+    _reply_free_object
+  };
+  REDIS_GLOBALSPACE *pspace = redis_space;
+
+  if(!penv->arena)
+  {
+    penv->arena = (REPLYARENA *)calloc(1 , sizeof(REPLYARENA));
+    if(!penv->arena)
+    {
+      slog_log(pspace->slog_d , SL_ERR , "<%s> failed! alloc arena err:%s rd:%d" , __FUNCTION__ , strerror(errno) , 
+        penv->id);
+      return -1;
+    }
+  }
+
+  penv->hiredis_cxt->reader->fn = &arena_fn;
+  penv->hiredis_cxt->reader->privdata = penv->arena;
+  return 0;
+}
+
+//alloc from arena. 8 bytes aligned
+static void *_arena_alloc(REPLYARENA *arena , size_t size)
+{
+  ARENACHUNK *pchunk = NULL;
+  size_t chunk_size = REDIS_ARENA_CHUNK;
+  void *ptr = NULL;
+
+  size = (size+7) & ~(size_t)7;
+  arena->used += size;
+
+  //try current and following chunks
+  for(pchunk=arena->curr; pchunk; pchunk=pchunk->next)
+  {
+    if(pchunk->size-pchunk->used >= size)
+    {
+      arena->curr = pchunk;
+      ptr = pchunk->data + pchunk->used;
+      pchunk->used += size;
+      return ptr;
+    }
+  }
+
+  //new chunk at tail
+  if(size > chunk_size)
+    chunk_size = size;
+  pchunk = (ARENACHUNK *)malloc(sizeof(ARENACHUNK) + chunk_size);
+  if(!pchunk)
+    return NULL;
+  pchunk->next = NULL;
+  pchunk->size = chunk_size;
+  pchunk->used = size;
+
+  if(!arena->head)
+    arena->head = pchunk;
+  else
+  {
+    for(arena->curr=arena->head; arena->curr->next; arena->curr=arena->curr->next)
+      ;
+    arena->curr->next = pchunk;
+  }
+  arena->curr = pchunk;
+  return pchunk->data;
+}
+
+//reset arena for next reply. oversized chunks are released, head included. next alloc makes a new one
+static void _arena_reset(REPLYARENA *arena)
+{
+  ARENACHUNK *pchunk = NULL;
+  ARENACHUNK **pprev = NULL;
+
+  if(!arena || !arena->head)
+    return;
+
+  pprev = &arena->head;
+  while(*pprev)
+  {
+    pchunk = *pprev;
+    if(pchunk->size > REDIS_ARENA_CHUNK)
+    {
+      *pprev = pchunk->next;
+      free(pchunk);
+      continue;
+    }
+    pchunk->used = 0;
+    pprev = &pchunk->next;
+  }
+  arena->curr = arena->head;
+  arena->used = 0;
+}
+
+static void _arena_free(REPLYARENA *arena)
+{
+  ARENACHUNK *pchunk = NULL;
+
+  if(!arena)
+    return;
+
+  while(arena->head)
+  {
+    pchunk = arena->head;
+    arena->head = pchunk->next;
+    free(pchunk);
+  }
+  free(arena);
+}
+
+//alloc a node and link it into its parent
+static void *_reply_node(const redisReadTask *task , int type , int len)
+{
+  REPLYNODE *pnode = NULL;
+  REPLYNODE *parent = NULL;
+
+  pnode = (REPLYNODE *)_arena_alloc((REPLYARENA *)task->privdata , sizeof(REPLYNODE));
+  if(!pnode)
+    return NULL;
+  memset(pnode , 0 , sizeof(REPLYNODE));
+  pnode->type = type;
+  pnode->len = len;
+
+  if(task->parent)
+  {
+    parent = (REPLYNODE *)task->parent->obj;
+    parent->element[task->idx] = pnode;
+  }
+  return pnode;
+}
+
+//fill str of parent after node is completed
+#define REPLY_LINK_STR(task , pnode) \
+  do \
+  { \
+    if((task)->parent) \
+    { \
+      ((REPLYNODE *)(task)->parent->obj)->argv[(task)->idx] = (pnode)->str; \
+      ((REPLYNODE *)(task)->parent->obj)->arglen[(task)->idx] = (pnode)->str? (pnode)->len : 0; \
+    } \
+  } \
+  while(0)
+
+static void *_reply_create_string(const redisReadTask *task , char *str , size_t len)
+{
+  REPLYNODE *pnode = NULL;
+
+  //verbatim string starts with 3 bytes format and ':'. stripped like hiredis
+  if(task->type==REDIS_REPLY_VERB && len>=4)
+  {
+    str += 4;
+    len -= 4;
+  }
+
+  pnode = (REPLYNODE *)_reply_node(task , task->type , (int)len);
+  if(!pnode)
+    return NULL;
+
+  pnode->str = (char *)_arena_alloc((REPLYARENA *)task->privdata , len+1);
+  if(!pnode->str)
+    return NULL;
+  memcpy(pnode->str , str , len);
+  pnode->str[len] = 0;
+  REPLY_LINK_STR(task , pnode);
+  return pnode;
+}
+
+static void *_reply_create_array(const redisReadTask *task , size_t elements)
+{
+  REPLYARENA *arena = (REPLYARENA *)task->privdata;
+  REPLYNODE *pnode = NULL;
+
+  pnode = (REPLYNODE *)_reply_node(task , task->type , (int)elements);
+  if(!pnode)
+    return NULL;
+
+  if(elements > 0)
+  {
+    pnode->argv = (char **)_arena_alloc(arena , elements*sizeof(char *));
+    pnode->arglen = (int *)_arena_alloc(arena , elements*sizeof(int));
+    pnode->element = (REPLYNODE **)_arena_alloc(arena , elements*sizeof(REPLYNODE *));
+    if(!pnode->argv || !pnode->arglen || !pnode->element)
+      return NULL;
+  }
+  REPLY_LINK_STR(task , pnode);
+  return pnode;
+}
+
+static void *_reply_create_integer(const redisReadTask *task , long long value)
+{
+  REPLYNODE *pnode = NULL;
+
+  pnode = (REPLYNODE *)_reply_node(task , REDIS_REPLY_INTEGER , 0);
+  if(!pnode)
+    return NULL;
+
+  //decimal kept for REDIS_CALLBACK
+  pnode->integer = value;
+  pnode->str = (char *)_arena_alloc((REPLYARENA *)task->privdata , 24);
+  if(!pnode->str)
+    return NULL;
+  pnode->len = _ll2str(pnode->str , value);
+  pnode->str[pnode->len] = 0;
+  REPLY_LINK_STR(task , pnode);
+  return pnode;
+}
+
+static void *_reply_create_double(const redisReadTask *task , double value , char *str , size_t len)
+{
+  REPLYNODE *pnode = NULL;
+
+  pnode = (REPLYNODE *)_reply_create_string(task , str , len);
+  if(!pnode)
+    return NULL;
+  pnode->type = REDIS_REPLY_DOUBLE;
+  pnode->dval = value;
+  return pnode;
+}
+
+static void *_reply_create_nil(const redisReadTask *task)
+{
+  REPLYNODE *pnode = NULL;
+
+  pnode = (REPLYNODE *)_reply_node(task , REDIS_REPLY_NIL , 0);
+  if(!pnode)
+    return NULL;
+  REPLY_LINK_STR(task , pnode);
+  return pnode;
+}
+
+static void *_reply_create_bool(const redisReadTask *task , int bval)
+{
+  REPLYNODE *pnode = NULL;
+
+  pnode = (REPLYNODE *)_reply_create_string(task , bval? "1" : "0" , 1);
+  if(!pnode)
+    return NULL;
+  pnode->type = REDIS_REPLY_BOOL;
+  pnode->integer = bval? 1 : 0;
+  return pnode;
+}
+
+//nodes are released by arena reset
+static void _reply_free_object(void *reply)
+{
+  (void)reply;
+  return;
+}
+
+//add a timer of cmd seq on env
+//return node id; -1:failed
+static int _timer_add(REDISENV *penv , unsigned int seq , long long expire_ms)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  TIMERWHEEL *pwheel = &pspace->wheel;
+  TIMERNODE *new_nodes = NULL;
+  TIMERNODE *pnode = NULL;
+  int new_len = 0;
+  int id = -1;
+  int i = 0;
+
+  //first use
+  if(!pwheel->nodes)
+  {
+    pwheel->now_ms = _now_ms();
+    pwheel->free_node = -1;
+    for(i=0; i<TW_SLOTS; i++)
+    {
+      pwheel->slots[i] = -1;
+      pwheel->tails[i] = -1;
+    }
+  }
+
+  //grow pool. nodes are referred by index so realloc is safe
+  if(pwheel->free_node < 0)
+  {
+    new_len = pwheel->node_len? pwheel->node_len*2 : TW_NODE_INIT;
+    new_nodes = (TIMERNODE *)realloc(pwheel->nodes , new_len*sizeof(TIMERNODE));
+    if(!new_nodes)
+      return -1;
+    for(i=new_len-1; i>=pwheel->node_len; i--)
+    {
+      new_nodes[i].slot = -1;
+      new_nodes[i].next = pwheel->free_node;
+      pwheel->free_node = i;
+    }
+    pwheel->nodes = new_nodes;
+    pwheel->node_len = new_len;
+  }
+
+  id = pwheel->free_node;
+  pnode = &pwheel->nodes[id];
+  pwheel->free_node = pnode->next;
+  pnode->rd = penv->id;
+  pnode->gen = penv->gen;
+  pnode->seq = seq;
+  pnode->expire_ms = expire_ms;
+  pnode->hedge = NULL;
+  pnode->reconnect = 0;
+  _timer_link(id);
+  pwheel->active++;
+  return id;
+}
+
+//put node into the slot of its expire time
+static void _timer_link(int id)
+{
+  TIMERWHEEL *pwheel = &redis_space->wheel;
+  TIMERNODE *pnode = &pwheel->nodes[id];
+  long long delay = 0;
+  int slot = 0;
+  int level = 0;
+  int shift = 0;
+
+  if(pnode->expire_ms <= pwheel->now_ms)
+    pnode->expire_ms = pwheel->now_ms + 1;
+  delay = pnode->expire_ms - pwheel->now_ms;
+  if(delay > TW_MAX_DELAY)
+  {
+    pnode->expire_ms = pwheel->now_ms + TW_MAX_DELAY;
+    delay = TW_MAX_DELAY;
+  }
+
+  if(delay < TW_SIZE0)
+    slot = (int)(pnode->expire_ms & (TW_SIZE0-1));
+  else
+  {
+    for(level=1; level<TW_LEVEL; level++)
+    {
+      shift = TW_BITS0 + level*TW_BITS;
+      if(delay < (1LL<<shift) || level==TW_LEVEL-1)
+        break;
+    }
+    shift = TW_BITS0 + (level-1)*TW_BITS;
+    slot = TW_SIZE0 + (level-1)*TW_SIZE + (int)((pnode->expire_ms>>shift) & (TW_SIZE-1));
+  }
+
+  //append to tail
+  pnode->slot = slot;
+  pnode->next = -1;
+  pnode->prev = pwheel->tails[slot];
+  if(pnode->prev >= 0)
+    pwheel->nodes[pnode->prev].next = id;
+  else
+    pwheel->slots[slot] = id;
+  pwheel->tails[slot] = id;
+}
+
+//remove a timer and release its node
+static void _timer_del(int id)
+{
+  TIMERWHEEL *pwheel = &redis_space->wheel;
+  TIMERNODE *pnode = NULL;
+
+  if(id<0 || id>=pwheel->node_len || pwheel->nodes[id].slot<0)
+    return;
+  pnode = &pwheel->nodes[id];
+
+  if(pnode->prev >= 0)
+    pwheel->nodes[pnode->prev].next = pnode->next;
+  else
+    pwheel->slots[pnode->slot] = pnode->next;
+  if(pnode->next >= 0)
+    pwheel->nodes[pnode->next].prev = pnode->prev;
+  else
+    pwheel->tails[pnode->slot] = pnode->prev;
+
+  pnode->slot = -1;
+  pnode->next = pwheel->free_node;
+  pwheel->free_node = id;
+  pwheel->active--;
+}
+
+//advance wheel to curr_ms and fire expired timers
+static void _timer_advance(long long curr_ms)
+{
+  TIMERWHEEL *pwheel = &redis_space->wheel;
+  TIMERNODE *pnode = NULL;
+  int level = 0;
+  int idx = 0;
+  int slot = 0;
+  int id = -1;
+
+  while(pwheel->now_ms<curr_ms && pwheel->active>0)
+  {
+    pwheel->now_ms++;
+
+    //cascade upper level slot into lower ones when lower wheel wraps
+    for(level=1; level<TW_LEVEL; level++)
+    {
+      if(pwheel->now_ms & ((1LL<<(TW_BITS0+(level-1)*TW_BITS))-1))
+        break;
+      idx = (int)((pwheel->now_ms>>(TW_BITS0+(level-1)*TW_BITS)) & (TW_SIZE-1));
+      slot = TW_SIZE0 + (level-1)*TW_SIZE + idx;
+      id = pwheel->slots[slot];
+      pwheel->slots[slot] = -1;
+      pwheel->tails[slot] = -1;
+      while(id >= 0)
+      {
+        pnode = &pwheel->nodes[id];
+        idx = pnode->next;
+        _timer_link(id);
+        id = idx;
+      }
+    }
+
+    //expire level 0 slot. re-read head since callback may change wheel
+    slot = (int)(pwheel->now_ms & (TW_SIZE0-1));
+    while((id = pwheel->slots[slot]) >= 0)
+      _timer_expire(id);
+  }
+
+  if(pwheel->active == 0)
+    pwheel->now_ms = curr_ms;
+}
+
+//nearest level 0 slot with timers. upper levels are bounded by next cascade
+//return ms; -1:no timer
+static long long _timer_next()
+{
+  TIMERWHEEL *pwheel = &redis_space->wheel;
+  long long t = 0;
+
+  if(pwheel->active<=0 || !pwheel->nodes)
+    return -1;
+  for(t=pwheel->now_ms+1; ; t++)
+  {
+    if(pwheel->slots[t & (TW_SIZE0-1)]>=0 || (t & (TW_SIZE0-1))==0)
+      return t;
+  }
+}
+
+//cmd of timer expired
+static void _timer_expire(int id)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  TIMERNODE *pnode = &pspace->wheel.nodes[id];
+  REDISENV *penv = NULL;
+  CBINFO *pslot = NULL;
+  CBINFO stCBInfo;
+  int rd = pnode->rd;
+  unsigned int gen = pnode->gen;
+  unsigned int seq = pnode->seq;
+  HEDGE *phedge = pnode->hedge;
+  char reconnect = pnode->reconnect;
+
+  _timer_del(id);
+  if(phedge) //send read to second node
+  {
+    phedge->timer = -1;
+    _hedge_expire(phedge);
+    return;
+  }
+  if(reconnect) //recycled env still down unless reconnected by app
+  {
+    penv = _env_alive(rd , gen);
+    if(penv)
+      penv->recycle_timer = 0;
+    if(penv && !penv->hiredis_cxt && (penv->flag==REDIS_CONN_FLG_FAIL || penv->flag==REDIS_CONN_FLG_CLOSED))
+      _env_recycle(penv);
+    return;
+  }
+  penv = _env_alive(rd , gen);
+  if(!penv || seq-penv->cb_head>=(unsigned int)penv->cb_count)
+    return;
+
+  //take callback and private out. slot stays to swallow late reply
+  pslot = &penv->cb_ring[seq & (penv->cb_size-1)];
+  if(pslot->timer != id)
+    return;
+  memcpy(&stCBInfo , pslot , sizeof(CBINFO));
+  if(pslot->private == pslot->private_data)
+    stCBInfo.private = stCBInfo.private_data;
+  stCBInfo.timer = -1;
+  stCBInfo.batch_reply = NULL;
+  stCBInfo.cmd = NULL; //freed with slot
+  pslot->timer = -1;
+  pslot->stat = CB_INFO_STAT_TIMEOUT;
+  pslot->private = NULL;
+  pslot->private_len = 0;
+  pslot->slab_class = CB_SLAB_NONE;
+  slog_log(pspace->slog_d , SL_INFO , "<%s> cmd timeout! rd:%d seq:%u" , __FUNCTION__ , rd , seq);
+
+  _fire_cb(&stCBInfo , CB_RET_TIMEOUT);
+  _free_cb(_env_alive(rd , gen) , &stCBInfo);
+
+  //stuck pipeline. fail the rest and reset connection
+  penv = _env_alive(rd , gen);
+  if(penv && stCBInfo.recycle && penv->hiredis_cxt)
+  {
+    slog_log(pspace->slog_d , SL_INFO , "<%s> recycle connection! rd:%d" , __FUNCTION__ , rd);
+    penv->flag = REDIS_CONN_FLG_CLOSED; //reject exec in callbacks
+    _fail_pending(penv , CB_RET_TIMEOUT);
+    penv = _env_alive(rd , gen);
+    if(!penv)
+      return;
+    _redis_disconnect(rd);
+    _env_recycle(penv);
+  }
+}
+
+//reconnect a recycled env. failure is retried by timer unless managed reconnect backs it off
+static void _env_recycle(REDISENV *penv)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  int rd = penv->id;
+  unsigned int gen = penv->gen;
+  int id = -1;
+
+  if(_redis_reconnect(penv) == 0)
+    return;
+  penv = _env_alive(rd , gen);
+  if(!penv || penv->hiredis_cxt) //closed or reconnected by callback
+    return;
+  if(penv->reconn_min > 0)
+    return;
+
+  id = _timer_add(penv , 0 , _now_ms()+REDIS_RECYCLE_RETRY_MS);
+  if(id < 0)
+  {
+    slog_log(pspace->slog_d , SL_ERR , "<%s> reconnect failed and no timer to retry! rd:%d" , __FUNCTION__ , rd);
+    return;
+  }
+  pspace->wheel.nodes[id].reconnect = 1;
+  penv->recycle_timer = id + 1;
+  slog_log(pspace->slog_d , SL_INFO , "<%s> reconnect failed and retry in %dms! rd:%d" , __FUNCTION__ , 
+    REDIS_RECYCLE_RETRY_MS , rd);
+}
+
+//call callback of a slot without reply
+static void _fire_cb(CBINFO *pcb , REDIS_CB_RESULT result)
+{
+  REDIS_BATCH_REPLY *replies = NULL;
+  int i = 0;
+
+  if(pcb->stat != CB_INFO_STAT_VALID)
+    return;
+
+  if(pcb->batch_n > 0)
+  {
+    if(!pcb->batch_func)
+      return;
+    replies = (REDIS_BATCH_REPLY *)calloc(pcb->batch_n , sizeof(REDIS_BATCH_REPLY));
+    if(!replies)
+      return;
+    for(i=0; i<pcb->batch_n; i++)
+      replies[i].result = result;
+    (*pcb->batch_func)(pcb->private , pcb->private_len , pcb->batch_n , replies);
+    free(replies);
+  }
+  else if(pcb->reply_func)
+    (*pcb->reply_func)(pcb->private , pcb->private_len , result , NULL);
+  else if(pcb->func)
+    (*pcb->func)(pcb->private , pcb->private_len , result , 0 , NULL , NULL);
+}
+
+//pop all pending cmds and call their callbacks with result
+//return number of failed cmds
+static int _fail_pending(REDISENV *penv , REDIS_CB_RESULT result)
+{
+  CBINFO stCBInfo;
+  int rd = penv->id;
+  unsigned int gen = penv->gen;
+  int count = 0;
+
+  while(penv && penv->cb_count>0)
+  {
+    _hpop_cbi(penv , &stCBInfo);
+    _fire_cb(&stCBInfo , result);
+    penv = _env_alive(rd , gen);
+    _free_cb(penv , &stCBInfo);
+    count++;
+  }
+  return count;
+}
+
+//sort out cmds held after disconnect. replayable ones stay in ring in order, others fail with CB_RET_DISCONNECT
+//return kept count; -1:failed
+static int _env_hold(REDISENV *penv)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  CBINFO *plist = NULL;
+  CBINFO *pslot = NULL;
+  int count = penv->cb_count;
+  int rd = penv->id;
+  unsigned int gen = penv->gen;
+  int kept = 0;
+  int i = 0;
+
+  penv->hold = 0;
+  if(count <= 0)
+    return 0;
+
+  plist = (CBINFO *)calloc(count , sizeof(CBINFO));
+  if(!plist)
+  {
+    slog_log(pspace->slog_d , SL_ERR , "<%s> failed! alloc %d err:%s rd:%d" , __FUNCTION__ , count , strerror(errno) , 
+      rd);
+    _drain_cb(penv);
+    return -1;
+  }
+  for(i=0; i<count; i++)
+    _hpop_cbi(penv , &plist[i]);
+
+  //keep replayable ones first. ring is consistent before any callback
+  for(i=0; i<count; i++)
+  {
+    if(!plist[i].cmd || !plist[i].replay || plist[i].stat==CB_INFO_STAT_TIMEOUT)
+      continue;
+    pslot = _tpush_cbi(penv);
+    if(!pslot) //fail it
+      continue;
+
+    memcpy(pslot , &plist[i] , sizeof(CBINFO));
+    if(plist[i].private == plist[i].private_data)
+      pslot->private = pslot->private_data;
+    if(pslot->timer >= 0)
+      pspace->wheel.nodes[pslot->timer].seq = penv->cb_tail - 1;
+    pslot->queued = 0;
+    pslot->qlen = 0;
+    pslot->batch_got = 0;
+
+    //owned by ring now
+    memset(&plist[i] , 0 , sizeof(CBINFO));
+    plist[i].timer = -1;
+    kept++;
+  }
+
+  //fail the others
+  for(i=0; i<count; i++)
+  {
+    _fire_cb(&plist[i] , CB_RET_DISCONNECT);
+    _free_cb(_env_alive(rd , gen) , &plist[i]);
+  }
+  free(plist);
+
+  slog_log(pspace->slog_d , SL_INFO , "<%s> held:%d failed:%d rd:%d" , __FUNCTION__ , kept , count-kept , rd);
+  return kept;
+}
+
+//resend held cmds after reconnect
+//return 0:success -1:failed
+static int _env_replay(REDISENV *penv)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  CBINFO *pslot = NULL;
+  unsigned int seq = 0;
+  sds obuf = NULL;
+
+  //timed out ones dropped. the others are sorted out before reconnect
+  if(_env_hold(penv) <= 0)
+    return 0;
+
+  for(seq=penv->cb_head; seq!=penv->cb_tail; seq++)
+  {
+    pslot = &penv->cb_ring[seq & (penv->cb_size-1)];
+    obuf = sdscatlen(penv->hiredis_cxt->obuf , pslot->cmd , pslot->cmd_len);
+    if(!obuf)
+    {
+      slog_log(pspace->slog_d , SL_ERR , "<%s> failed! out of memory! rd:%d" , __FUNCTION__ , penv->id);
+      return -1;
+    }
+    penv->hiredis_cxt->obuf = obuf;
+  }
+
+  slog_log(pspace->slog_d , SL_INFO , "<%s> replay %d cmds! rd:%d" , __FUNCTION__ , penv->cb_count , penv->id);
+  return _wqueue_push(penv);
+}
+
+//managed reconnect of a failed or closed env with jittered exponential backoff
+//return 0:success -1:failed
+static int _env_backoff(REDISENV *penv , long long curr_ms)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  int rd = penv->id;
+  unsigned int gen = penv->gen;
+  long long delay = 0;
+
+  //fail cmds not replayable at once
+  if(penv->hold)
+  {
+    _env_hold(penv);
+    penv = _env_alive(rd , gen);
+    if(!penv || penv->reconn_min<=0 || (penv->flag!=REDIS_CONN_FLG_FAIL && penv->flag!=REDIS_CONN_FLG_CLOSED))
+      return 0;
+  }
+
+  //schedule
+  if(penv->reconn_at_ms == 0)
+  {
+    delay = (long long)penv->reconn_min << (penv->reconn_attempt<20? penv->reconn_attempt : 20);
+    if(delay > penv->reconn_max)
+      delay = penv->reconn_max;
+
+    //jitter in [delay/2 , delay]
+    delay = delay/2 + _rand_next() % (delay/2 + 1);
+
+    penv->reconn_at_ms = curr_ms + delay;
+    penv->reconn_attempt++;
+    slog_log(pspace->slog_d , SL_INFO , "<%s> reconnect after %lldms attempt:%d rd:%d" , __FUNCTION__ , delay , 
+      penv->reconn_attempt , rd);
+    return 0;
+  }
+
+  if(curr_ms < penv->reconn_at_ms)
+    return 0;
+
+  penv->reconn_at_ms = 0;
+  return _redis_reconnect(penv);
+}
+
+//push a cmd without backpressure check. callback of pcb(NULL:none) is taken over on success only
+//connecting env keeps it for replay when connected
+//return 0:success -1:failed and pcb untouched
+static int _env_push_cmd(REDISENV *penv , char *cmd , int len , CBINFO *pcb)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  CBINFO *pslot = NULL;
+  char *copy = NULL;
+  char copy_class = CB_SLAB_NONE;
+  sds obuf = NULL;
+
+  pslot = _tpush_cbi(penv);
+  if(!pslot)
+    return -1;
+
+  //fallible steps first. not sent yet is resent by _env_replay
+  if(penv->flag != REDIS_CONN_FLG_CONNECTED)
+  {
+    if(!pcb || !pcb->cmd)
+    {
+      copy = _slab_get(penv , len , &copy_class);
+      if(!copy)
+      {
+        slog_log(pspace->slog_d , SL_ERR , "<%s> failed! alloc cmd:%d err:%s rd:%d" , __FUNCTION__ , len , 
+          strerror(errno) , penv->id);
+        _tcancel_cbi(penv);
+        return -1;
+      }
+      memcpy(copy , cmd , len);
+    }
+  }
+  else
+  {
+    penv->obuf_mark = sdslen(penv->hiredis_cxt->obuf);
+    obuf = sdscatlen(penv->hiredis_cxt->obuf , cmd , len);
+    if(!obuf)
+    {
+      slog_log(pspace->slog_d , SL_ERR , "<%s> failed! out of memory! rd:%d" , __FUNCTION__ , penv->id);
+      _tcancel_cbi(penv);
+      return -1;
+    }
+    penv->hiredis_cxt->obuf = obuf;
+  }
+
+  //take over callback,private,timer and cmd copy
+  if(pcb)
+  {
+    memcpy(pslot , pcb , sizeof(CBINFO));
+    if(pcb->private == pcb->private_data)
+      pslot->private = pslot->private_data;
+    pslot->queued = 0;
+    pslot->qlen = 0;
+    if(pslot->timer >= 0)
+    {
+      pspace->wheel.nodes[pslot->timer].rd = penv->id;
+      pspace->wheel.nodes[pslot->timer].gen = penv->gen;
+      pspace->wheel.nodes[pslot->timer].seq = penv->cb_tail - 1;
+    }
+    pcb->private = NULL;
+    pcb->private_len = 0;
+    pcb->timer = -1;
+    pcb->cmd = NULL;
+    pcb->cmd_len = 0;
+    pcb->cmd_class = CB_SLAB_NONE;
+  }
+
+  if(penv->flag != REDIS_CONN_FLG_CONNECTED)
+  {
+    if(copy)
+    {
+      pslot->cmd = copy;
+      pslot->cmd_len = len;
+      pslot->cmd_class = copy_class;
+    }
+    pslot->replay = 1;
+    return 0;
+  }
+
+  pslot->queued = penv->ov_cnt>0? 1 : 0; //keep order behind queued cmds
+  return _env_appended(penv);
+}
+
+//cluster of cd. NULL if not opened
+static REDISCLUSTER *_cluster_get(int cd)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+
+  if(cd<0 || cd>=pspace->cluster_len || !pspace->cluster_list[cd].slots)
+    return NULL;
+  return &pspace->cluster_list[cd];
+}
+
+//env of rd if it is a node of cluster cd
+static REDISENV *_cluster_env(int cd , int rd)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISENV *penv = NULL;
+
+  if(rd<0 || !pspace->env_list || pspace->list_len<0 || rd>=(int)pow(2 , pspace->list_len))
+    return NULL;
+  penv = &pspace->env_list[rd];
+  if(penv->stat==REDIS_ENV_STAT_EMPTY || penv->cluster!=cd+1)
+    return NULL;
+  return penv;
+}
+
+//first connected node of cluster
+//return rd; -1:no node connected
+static int _cluster_any(REDISCLUSTER *pcluster , int cd)
+{
+  REDISENV *penv = NULL;
+  int i = 0;
+
+  for(i=0; i<pcluster->node_cnt; i++)
+  {
+    penv = _cluster_env(cd , pcluster->nodes[i]);
+    if(penv && penv->flag==REDIS_CONN_FLG_CONNECTED)
+      return penv->id;
+  }
+  return -1;
+}
+
+//CRC16-XMODEM used by redis cluster
+static const unsigned short crc16_table[256] = 
+{
+  0x0000 , 0x1021 , 0x2042 , 0x3063 , 0x4084 , 0x50a5 , 0x60c6 , 0x70e7 ,
+  0x8108 , 0x9129 , 0xa14a , 0xb16b , 0xc18c , 0xd1ad , 0xe1ce , 0xf1ef ,
+  0x1231 , 0x0210 , 0x3273 , 0x2252 , 0x52b5 , 0x4294 , 0x72f7 , 0x62d6 ,
+  0x9339 , 0x8318 , 0xb37b , 0xa35a , 0xd3bd , 0xc39c , 0xf3ff , 0xe3de ,
+  0x2462 , 0x3443 , 0x0420 , 0x1401 , 0x64e6 , 0x74c7 , 0x44a4 , 0x5485 ,
+  0xa56a , 0xb54b , 0x8528 , 0x9509 , 0xe5ee , 0xf5cf , 0xc5ac , 0xd58d ,
+  0x3653 , 0x2672 , 0x1611 , 0x0630 , 0x76d7 , 0x66f6 , 0x5695 , 0x46b4 ,
+  0xb75b , 0xa77a , 0x9719 , 0x8738 , 0xf7df , 0xe7fe , 0xd79d , 0xc7bc ,
+  0x48c4 , 0x58e5 , 0x6886 , 0x78a7 , 0x0840 , 0x1861 , 0x2802 , 0x3823 ,
+  0xc9cc , 0xd9ed , 0xe98e , 0xf9af , 0x8948 , 0x9969 , 0xa90a , 0xb92b ,
+  0x5af5 , 0x4ad4 , 0x7ab7 , 0x6a96 , 0x1a71 , 0x0a50 , 0x3a33 , 0x2a12 ,
+  0xdbfd , 0xcbdc , 0xfbbf , 0xeb9e , 0x9b79 , 0x8b58 , 0xbb3b , 0xab1a ,
+  0x6ca6 , 0x7c87 , 0x4ce4 , 0x5cc5 , 0x2c22 , 0x3c03 , 0x0c60 , 0x1c41 ,
+  0xedae , 0xfd8f , 0xcdec , 0xddcd , 0xad2a , 0xbd0b , 0x8d68 , 0x9d49 ,
+  0x7e97 , 0x6eb6 , 0x5ed5 , 0x4ef4 , 0x3e13 , 0x2e32 , 0x1e51 , 0x0e70 ,
+  0xff9f , 0xefbe , 0xdfdd , 0xcffc , 0xbf1b , 0xaf3a , 0x9f59 , 0x8f78 ,
+  0x9188 , 0x81a9 , 0xb1ca , 0xa1eb , 0xd10c , 0xc12d , 0xf14e , 0xe16f ,
+  0x1080 , 0x00a1 , 0x30c2 , 0x20e3 , 0x5004 , 0x4025 , 0x7046 , 0x6067 ,
+  0x83b9 , 0x9398 , 0xa3fb , 0xb3da , 0xc33d , 0xd31c , 0xe37f , 0xf35e ,
+  0x02b1 , 0x1290 , 0x22f3 , 0x32d2 , 0x4235 , 0x5214 , 0x6277 , 0x7256 ,
+  0xb5ea , 0xa5cb , 0x95a8 , 0x8589 , 0xf56e , 0xe54f , 0xd52c , 0xc50d ,
+  0x34e2 , 0x24c3 , 0x14a0 , 0x0481 , 0x7466 , 0x6447 , 0x5424 , 0x4405 ,
+  0xa7db , 0xb7fa , 0x8799 , 0x97b8 , 0xe75f , 0xf77e , 0xc71d , 0xd73c ,
+  0x26d3 , 0x36f2 , 0x0691 , 0x16b0 , 0x6657 , 0x7676 , 0x4615 , 0x5634 ,
+  0xd94c , 0xc96d , 0xf90e , 0xe92f , 0x99c8 , 0x89e9 , 0xb98a , 0xa9ab ,
+  0x5844 , 0x4865 , 0x7806 , 0x6827 , 0x18c0 , 0x08e1 , 0x3882 , 0x28a3 ,
+  0xcb7d , 0xdb5c , 0xeb3f , 0xfb1e , 0x8bf9 , 0x9bd8 , 0xabbb , 0xbb9a ,
+  0x4a75 , 0x5a54 , 0x6a37 , 0x7a16 , 0x0af1 , 0x1ad0 , 0x2ab3 , 0x3a92 ,
+  0xfd2e , 0xed0f , 0xdd6c , 0xcd4d , 0xbdaa , 0xad8b , 0x9de8 , 0x8dc9 ,
+  0x7c26 , 0x6c07 , 0x5c64 , 0x4c45 , 0x3ca2 , 0x2c83 , 0x1ce0 , 0x0cc1 ,
+  0xef1f , 0xff3e , 0xcf5d , 0xdf7c , 0xaf9b , 0xbfba , 0x8fd9 , 0x9ff8 ,
+  0x6e17 , 0x7e36 , 0x4e55 , 0x5e74 , 0x2e93 , 0x3eb2 , 0x0ed1 , 0x1ef0
+};
+
+//hash slot of key. only {hashtag} is hashed if not empty
+static int _cluster_slot(const char *key , int keylen)
+{
+  unsigned short crc = 0;
+  int s = 0;
+  int e = 0;
+  int i = 0;
+
+  for(s=0; s<keylen && key[s]!='{'; s++);
+  if(s < keylen)
+  {
+    for(e=s+1; e<keylen && key[e]!='}'; e++);
+    if(e<keylen && e>s+1)
+    {
+      key += s + 1;
+      keylen = e - s - 1;
+    }
+  }
+
+  for(i=0; i<keylen; i++)
+    crc = (crc<<8) ^ crc16_table[((crc>>8) ^ (unsigned char)key[i]) & 0xff];
+  return crc & (REDIS_CLUSTER_SLOTS-1);
+}
+
+//arg index of first key. EVAL* and FCALL* have script and numkeys before keys
+static int _cluster_keypos(const char *name , int len)
+{
+  if(len>=4 && strncasecmp(name , "EVAL" , 4)==0)
+    return 3;
+  if(len>=5 && strncasecmp(name , "FCALL" , 5)==0)
+    return 3;
+  return 1;
+}
+
+//idx-th token of cmd separated by space as hiredis formats it
+//return NULL if not exist
+static const char *_cmd_token(const char *cmd , int idx , int *len)
+{
+  const char *p = cmd;
+  int i = 0;
+
+  while(1)
+  {
+    while(*p == ' ')
+      p++;
+    if(*p == 0)
+      return NULL;
+    for(*len=0; p[*len] && p[*len]!=' '; (*len)++);
+    if(i++ == idx)
+      return p;
+    p += *len;
+  }
+}
+
+//rd of node ip:port in cluster. opened if not found
+//return -1:failed
+static int _cluster_node(int cd , char *ip , int port)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISCLUSTER *pcluster = &pspace->cluster_list[cd];
+  REDISENV *penv = NULL;
+  int *new_nodes = NULL;
+  int empty = -1;
+  int rd = -1;
+  int i = 0;
+
+  for(i=0; i<pcluster->node_cnt; i++)
+  {
+    penv = _cluster_env(cd , pcluster->nodes[i]);
+    if(!penv) //closed by app
+    {
+      empty = i;
+      continue;
+    }
+    if(penv->port==port && strcmp(penv->ip , ip)==0)
+      return penv->id;
+  }
+
+  if(empty<0 && pcluster->node_cnt>=pcluster->node_size)
+  {
+    new_nodes = (int *)realloc(pcluster->nodes , pcluster->node_size*2*sizeof(int));
+    if(!new_nodes)
+    {
+      slog_log(pspace->slog_d , SL_ERR , "<%s> failed! alloc nodes err:%s cd:%d" , __FUNCTION__ , strerror(errno) , cd);
+      return -1;
+    }
+    pcluster->nodes = new_nodes;
+    pcluster->node_size *= 2;
+  }
+
+  rd = _redis_open(ip , port , pcluster->log_level , 1);
+  if(rd < 0)
+    return -1;
+  if(_redis_connect(rd , ip , port , pcluster->timeout_ms) < 0)
+  {
+    redis_close(rd);
+    return -1;
+  }
+  pspace->env_list[rd].cluster = cd + 1;
+  if(empty >= 0)
+    pcluster->nodes[empty] = rd;
+  else
+    pcluster->nodes[pcluster->node_cnt++] = rd;
+
+  slog_log(pspace->slog_d , SL_INFO , "<%s> node %s:%d opened! cd:%d rd:%d" , __FUNCTION__ , ip , port , cd , rd);
+  return rd;
+}
+
+//follow "MOVED <slot> <ip>:<port>" or "ASK <slot> <ip>:<port>" of a node. cmd of pcb is moved to target
+//return 0:redirected and pcb taken over -1:not a redirect or failed
+static int _cluster_redirect(REDISENV *penv , CBINFO *pcb , REPLYNODE *preply)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISCLUSTER *pcluster = NULL;
+  REDISENV *ptarget = NULL;
+  char ip[64] = {0};
+  char *p = NULL;
+  char *colon = NULL;
+  int cd = penv->cluster - 1;
+  int ask = 0;
+  int slot = 0;
+  int port = 0;
+  int rd = -1;
+
+  if(strncmp(preply->str , "MOVED " , 6) == 0)
+    p = preply->str + 6;
+  else if(strncmp(preply->str , "ASK " , 4) == 0)
+  {
+    p = preply->str + 4;
+    ask = 1;
+  }
+  else
+    return -1;
+
+  pcluster = _cluster_get(cd);
+  if(!pcluster || pcb->redirect>=REDIS_CLUSTER_REDIRECT)
+    return -1;
+
+  //parse slot and endpoint. empty ip means same host
+  slot = atoi(p);
+  p = strchr(p , ' ');
+  colon = p? strrchr(p , ':') : NULL;
+  if(slot<0 || slot>=REDIS_CLUSTER_SLOTS || !colon)
+    return -1;
+  if(colon == p+1)
+    snprintf(ip , sizeof(ip) , "%s" , penv->ip);
+  else
+    memcpy(ip , p+1 , (size_t)(colon-p-1)<sizeof(ip)? (size_t)(colon-p-1) : sizeof(ip)-1);
+  port = atoi(colon+1);
+  slog_log(pspace->slog_d , SL_DEBUG , "<%s> %s slot:%d to %s:%d rd:%d" , __FUNCTION__ , ask? "ASK" : "MOVED" , slot , 
+    ip , port , penv->id);
+
+  rd = _cluster_node(cd , ip , port);
+  if(rd < 0)
+    return -1;
+
+  //slot migrated. full map reloaded later
+  if(!ask)
+  {
+    pcluster->slots[slot] = rd;
+    pcluster->refresh = 1;
+  }
+
+  //down node. try once
+  ptarget = &pspace->env_list[rd];
+  if(ptarget->flag==REDIS_CONN_FLG_FAIL || ptarget->flag==REDIS_CONN_FLG_CLOSED)
+  {
+    if(ptarget->reconn_min>0 || _redis_reconnect(ptarget)<0)
+      return -1;
+  }
+  if(!ptarget->hiredis_cxt)
+    return -1;
+
+  if(ask && _env_push_cmd(ptarget , "*1\r\n$6\r\nASKING\r\n" , 16 , NULL)<0)
+    return -1;
+  pcb->redirect++;
+  if(_env_push_cmd(ptarget , pcb->cmd , pcb->cmd_len , pcb) < 0)
+    return -1;
+  return 0;
+}
+
+//reply of CLUSTER SLOTS:[[start , end , [ip , port , id] , replicas...] ...]
+//private:cd and rd asked
+static int _cluster_slots_cb(char *private , int private_len , REDIS_CB_RESULT result , const redis_reply_t *reply)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISCLUSTER *pcluster = NULL;
+  const redis_reply_t *range = NULL;
+  const redis_reply_t *master = NULL;
+  REDISENV *penv = NULL;
+  char ip[64] = {0};
+  const char *str = NULL;
+  int args[2];
+  int start = 0;
+  int end = 0;
+  int count = 0;
+  int len = 0;
+  int rd = -1;
+  int i = 0;
+
+  (void)private_len;
+  memcpy(args , private , sizeof(args));
+  pcluster = _cluster_get(args[0]);
+  if(!pcluster)
+    return 0;
+
+  if(result!=CB_RET_SUCCESS || redis_reply_type(reply)!=REDIS_REPLY_ARRAY)
+  {
+    slog_log(pspace->slog_d , SL_ERR , "<%s> load slot map failed! result:%d cd:%d" , __FUNCTION__ , result , args[0]);
+    pcluster->refresh = 1;
+    return 0;
+  }
+
+  for(i=0; i<redis_reply_count(reply); i++)
+  {
+    range = redis_reply_elem(reply , i);
+    master = redis_reply_elem(range , 2);
+    if(redis_reply_count(range)<3 || redis_reply_count(master)<2)
+      continue;
+    start = (int)redis_reply_integer(redis_reply_elem(range , 0));
+    end = (int)redis_reply_integer(redis_reply_elem(range , 1));
+    if(start<0 || end>=REDIS_CLUSTER_SLOTS || start>end)
+      continue;
+
+    //empty ip means host of node asked
+    str = redis_reply_str(redis_reply_elem(master , 0) , &len);
+    penv = _cluster_env(args[0] , args[1]);
+    if(len<=0 && penv)
+      snprintf(ip , sizeof(ip) , "%s" , penv->ip);
+    else
+    {
+      len = (size_t)len<sizeof(ip)? len : (int)sizeof(ip)-1;
+      memcpy(ip , str , len);
+      ip[len] = 0;
+    }
+
+    rd = _cluster_node(args[0] , ip , (int)redis_reply_integer(redis_reply_elem(master , 1)));
+    if(rd < 0)
+      continue;
+    pcluster = &pspace->cluster_list[args[0]];
+    for(; start<=end; start++)
+      pcluster->slots[start] = rd;
+    count++;
+  }
+
+  slog_log(pspace->slog_d , SL_INFO , "<%s> slot map loaded! ranges:%d cd:%d" , __FUNCTION__ , count , args[0]);
+  return 0;
+}
+
+//send CLUSTER SLOTS for clusters whose map is stale
+static void _cluster_tick(long long curr_ms)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISCLUSTER *pcluster = NULL;
+  REDISENV *penv = NULL;
+  int args[2];
+  int cd = 0;
+  int i = 0;
+
+  for(cd=0; cd<pspace->cluster_len; cd++)
+  {
+    pcluster = &pspace->cluster_list[cd];
+    if(!pcluster->slots || !pcluster->refresh)
+      continue;
+    if(pcluster->load_ms>0 && curr_ms-pcluster->load_ms<REDIS_CLUSTER_RELOAD_MS)
+      continue;
+
+    for(i=0; i<pcluster->node_cnt; i++)
+    {
+      penv = _cluster_env(cd , pcluster->nodes[i]);
+      if(penv && penv->flag==REDIS_CONN_FLG_CONNECTED)
+        break;
+    }
+    if(i >= pcluster->node_cnt)
+      continue;
+
+    args[0] = cd;
+    args[1] = penv->id;
+    if(redis_exec_typed(penv->id , "CLUSTER SLOTS" , _cluster_slots_cb , (char *)args , sizeof(args)) < 0)
+      continue;
+    pcluster = &pspace->cluster_list[cd];
+    pcluster->refresh = 0;
+    pcluster->load_ms = curr_ms;
+  }
+}
+
+//shard group of sd. NULL if not opened
+static REDISSHARD *_shard_get(int sd)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+
+  if(sd<0 || sd>=pspace->shard_len || pspace->shard_list[sd].count<=0)
+    return NULL;
+  return &pspace->shard_list[sd];
+}
+
+//FNV-1a with murmur3 finalizer so that close names spread over ring
+static unsigned int _shard_hash(const char *key , int len)
+{
+  unsigned int h = 2166136261u;
+  int i = 0;
+
+  for(i=0; i<len; i++)
+  {
+    h ^= (unsigned char)key[i];
+    h *= 16777619u;
+  }
+  h ^= h >> 16;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35u;
+  h ^= h >> 16;
+  return h;
+}
+
+static int _shard_point_cmp(const void *a , const void *b)
+{
+  unsigned int ha = ((const SHARDPOINT *)a)->hash;
+  unsigned int hb = ((const SHARDPOINT *)b)->hash;
+  return ha<hb? -1 : (ha>hb? 1 : 0);
+}
+
+//member is down if FAIL,CLOSED or closed by app
+static int _shard_down(int rd)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISENV *penv = NULL;
+
+  if(rd<0 || !pspace->env_list || pspace->list_len<0 || rd>=(int)pow(2 , pspace->list_len))
+    return 1;
+  penv = &pspace->env_list[rd];
+  if(penv->stat == REDIS_ENV_STAT_EMPTY)
+    return 1;
+  return (penv->flag==REDIS_CONN_FLG_FAIL || penv->flag==REDIS_CONN_FLG_CLOSED)? 1 : 0;
+}
+
+//refresh down state of members and ring of live points. keys of a down member move to next points only
+//return 1:changed 0:not changed
+static int _shard_build(REDISSHARD *pshard)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  int changed = 0;
+  int down = 0;
+  int i = 0;
+
+  for(i=0; i<pshard->count; i++)
+  {
+    down = _shard_down(pshard->rds[i]);
+    if(down != pshard->down[i])
+    {
+      pshard->down[i] = down;
+      changed = 1;
+    }
+  }
+  if(!changed)
+    return 0;
+
+  pshard->live_cnt = 0;
+  for(i=0; i<pshard->point_cnt; i++)
+  {
+    if(!pshard->down[pshard->points[i].member])
+      pshard->live[pshard->live_cnt++] = pshard->points[i];
+  }
+  slog_log(pspace->slog_d , SL_INFO , "<%s> ring rebuilt! live points:%d of %d" , __FUNCTION__ , pshard->live_cnt , 
+    pshard->point_cnt);
+  return 1;
+}
+
+//rebuild rings whose members changed state
+static void _shard_tick()
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  int sd = 0;
+
+  for(sd=0; sd<pspace->shard_len; sd++)
+  {
+    if(pspace->shard_list[sd].count > 0)
+      _shard_build(&pspace->shard_list[sd]);
+  }
+}
+
+//split multi-key cmd by owner of keys and pipeline one sub cmd per owner. replies gathered in key order
+//id:sd of shard or cd of cluster. sub cmds of cluster are split by slot since keys of one cmd must share a slot
+//return 0:all sent 1:partly sent and callback fails -1:failed and nothing sent
+static int _scatter(int id , int cluster , int argc , const char *argv[] , const size_t argvlen[] , 
+  REDIS_CALLBACK callback , char *private , int private_len)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  GATHER *pgather = NULL;
+  GATHERKEY *keys = NULL;
+  GATHERSUB sub;
+  const char **sub_argv = NULL;
+  size_t *sub_len = NULL;
+  int name_len = 0;
+  int key_len = 0;
+  int step = 1;
+  int op = 0;
+  int nkeys = 0;
+  int sent = 0;
+  int rd = -1;
+  int src = 0;
+  int i = 0;
+  int j = 0;
+  int k = 0;
+
+  if(argc<2 || !argv)
+  {
+    slog_log(pspace->slog_d , SL_ERR , "<%s> failed! arg illegal! argc:%d id:%d" , __FUNCTION__ , argc , id);
+    return -1;
+  }
+
+  //reply merged by op
+  name_len = (int)(argvlen? argvlen[0] : strlen(argv[0]));
+  if(name_len==4 && strncasecmp(argv[0] , "MGET" , 4)==0)
+    op = GATHER_MGET;
+  else if(name_len==4 && strncasecmp(argv[0] , "MSET" , 4)==0)
+  {
+    op = GATHER_MSET;
+    step = 2;
+  }
+  else if((name_len==3 && strncasecmp(argv[0] , "DEL" , 3)==0) || (name_len==6 && 
+    (strncasecmp(argv[0] , "UNLINK" , 6)==0 || strncasecmp(argv[0] , "EXISTS" , 6)==0)) || 
+    (name_len==5 && strncasecmp(argv[0] , "TOUCH" , 5)==0))
+    op = GATHER_SUM;
+  else
+  {
+    slog_log(pspace->slog_d , SL_ERR , "<%s> failed! cmd %.*s not supported! id:%d" , __FUNCTION__ , name_len , argv[0] , 
+      id);
+    return -1;
+  }
+  if((argc-1) % step)
+  {
+    slog_log(pspace->slog_d , SL_ERR , "<%s> failed! argc:%d illegal! id:%d" , __FUNCTION__ , argc , id);
+    return -1;
+  }
+  nkeys = (argc-1) / step;
+
+  keys = (GATHERKEY *)malloc(nkeys*sizeof(GATHERKEY));
+  sub_argv = (const char **)malloc(argc*sizeof(char *));
+  sub_len = (size_t *)malloc(argc*sizeof(size_t));
+  pgather = (GATHER *)calloc(1 , sizeof(GATHER) + nkeys*sizeof(int)*(op==GATHER_MGET? 3 : 1) + private_len);
+  if(!keys || !sub_argv || !sub_len || !pgather)
+  {
+    slog_log(pspace->slog_d , SL_ERR , "<%s> failed! alloc keys:%d err:%s id:%d" , __FUNCTION__ , nkeys , strerror(errno) , 
+      id);
+    goto _fail;
+  }
+
+  //route each key. all must have an owner
+  for(i=0; i<nkeys; i++)
+  {
+    src = 1 + i*step;
+    key_len = (int)(argvlen? argvlen[src] : strlen(argv[src]));
+    if(cluster)
+    {
+      keys[i].group = _cluster_slot(argv[src] , key_len);
+      rd = redis_cluster_rd(id , argv[src] , key_len);
+    }
+    else
+      keys[i].group = rd = redis_shard_rd(id , argv[src] , key_len);
+    if(rd < 0)
+    {
+      slog_log(pspace->slog_d , SL_ERR , "<%s> failed! no owner of key:%.*s id:%d" , __FUNCTION__ , key_len , argv[src] , 
+        id);
+      goto _fail;
+    }
+    keys[i].idx = i;
+  }
+  qsort(keys , nkeys , sizeof(GATHERKEY) , _gather_key_cmp);
+
+  //gather and its arrays in one block
+  pgather->func = callback;
+  pgather->op = op;
+  pgather->nkeys = nkeys;
+  pgather->result = CB_RET_SUCCESS;
+  pgather->pos = (int *)(pgather + 1);
+  if(op == GATHER_MGET)
+  {
+    pgather->off = pgather->pos + nkeys;
+    pgather->len = pgather->off + nkeys;
+  }
+  pgather->private = (char *)(pgather->pos + nkeys*(op==GATHER_MGET? 3 : 1));
+  pgather->private_len = (private && private_len>0)? private_len : 0;
+  if(pgather->private_len > 0)
+    memcpy(pgather->private , private , private_len);
+  for(i=0; i<nkeys; i++)
+  {
+    pgather->pos[i] = keys[i].idx;
+    if(pgather->off)
+      pgather->off[i] = -1;
+  }
+
+  //one sub cmd per owner. held by scatter until all sent
+  pgather->pending = 1;
+  for(i=0; i<nkeys; i=j)
+  {
+    for(j=i+1; j<nkeys && keys[j].group==keys[i].group; j++);
+
+    sub_argv[0] = argv[0];
+    sub_len[0] = name_len;
+    for(k=i; k<j; k++)
+    {
+      src = 1 + keys[k].idx*step;
+      sub_argv[1+(k-i)*step] = argv[src];
+      sub_len[1+(k-i)*step] = argvlen? argvlen[src] : strlen(argv[src]);
+      if(step == 2)
+      {
+        sub_argv[2+(k-i)*step] = argv[src+1];
+        sub_len[2+(k-i)*step] = argvlen? argvlen[src+1] : strlen(argv[src+1]);
+      }
+    }
+    rd = cluster? redis_cluster_rd(id , sub_argv[1] , sub_len[1]) : keys[i].group;
+
+    sub.pgather = pgather;
+    sub.start = i;
+    sub.n = j - i;
+    pgather->pending++;
+    if(redis_execv(rd , 1+(j-i)*step , sub_argv , sub_len , _gather_cb , (char *)&sub , sizeof(sub)) < 0)
+    {
+      pgather->pending--;
+      break;
+    }
+    sent++;
+  }
+  free(keys);
+  free(sub_argv);
+  free(sub_len);
+  keys = NULL;
+  sub_argv = NULL;
+  sub_len = NULL;
+
+  if(sent == 0)
+    goto _fail;
+  if(i < nkeys) //rest not sent. sent ones still gathered
+  {
+    slog_log(pspace->slog_d , SL_ERR , "<%s> sub cmd failed! sent:%d id:%d" , __FUNCTION__ , sent , id);
+    pgather->result = CB_RET_ERROR;
+  }
+
+  //released by scatter. all dropped during sending
+  if(--pgather->pending == 0)
+  {
+    pgather->next = pspace->gather_done;
+    pspace->gather_done = pgather;
+  }
+  slog_log(pspace->slog_d , SL_DEBUG , "<%s> keys:%d sub cmds:%d id:%d" , __FUNCTION__ , nkeys , sent , id);
+  return i<nkeys? 1 : 0;
+
+_fail:
+  free(keys);
+  free(sub_argv);
+  free(sub_len);
+  free(pgather);
+  return -1;
+}
+
+//by owner then key order
+static int _gather_key_cmp(const void *a , const void *b)
+{
+  const GATHERKEY *ka = (const GATHERKEY *)a;
+  const GATHERKEY *kb = (const GATHERKEY *)b;
+  if(ka->group != kb->group)
+    return ka->group<kb->group? -1 : 1;
+  return ka->idx - kb->idx;
+}
+
+//callback of sub cmd
+static int _gather_cb(char *private , int private_len , REDIS_CB_RESULT result , int argc , char *argv[] , int arglen[])
+{
+  GATHERSUB sub;
+
+  (void)private_len;
+  memcpy(&sub , private , sizeof(sub));
+  _gather_put(sub.pgather , &sub , result , argc , argv , arglen);
+  if(--sub.pgather->pending == 0)
+    _gather_finish(sub.pgather);
+  return 0;
+}
+
+//merge reply of a sub cmd. values copied out since arena is reset after callback
+static void _gather_put(GATHER *pgather , GATHERSUB *psub , REDIS_CB_RESULT result , int argc , char *argv[] , 
+  int arglen[])
+{
+  char *new_data = NULL;
+  int new_size = 0;
+  int idx = 0;
+  int i = 0;
+
+  if(result==CB_RET_SUCCESS && pgather->op==GATHER_MGET && argc!=psub->n)
+    result = CB_RET_ERROR;
+
+  //first failure kept
+  if(result != CB_RET_SUCCESS)
+  {
+    if(pgather->result != CB_RET_SUCCESS)
+      return;
+    pgather->result = result;
+    if(argc==1 && argv && argv[0] && arglen[0]>0)
+    {
+      pgather->err = (char *)malloc(arglen[0]);
+      if(pgather->err)
+      {
+        memcpy(pgather->err , argv[0] , arglen[0]);
+        pgather->err_len = arglen[0];
+      }
+    }
+    return;
+  }
+
+  switch(pgather->op)
+  {
+    case GATHER_MGET:
+      for(i=0; i<argc; i++)
+      {
+        if(!argv[i])
+          continue;
+        if(pgather->data_len+arglen[i] > pgather->data_size)
+        {
+          new_size = pgather->data_size? pgather->data_size*2 : 1024;
+          while(new_size < pgather->data_len+arglen[i])
+            new_size *= 2;
+          new_data = (char *)realloc(pgather->data , new_size);
+          if(!new_data)
+          {
+            pgather->result = CB_RET_ERROR;
+            return;
+          }
+          pgather->data = new_data;
+          pgather->data_size = new_size;
+        }
+        idx = pgather->pos[psub->start+i];
+        memcpy(pgather->data+pgather->data_len , argv[i] , arglen[i]);
+        pgather->off[idx] = pgather->data_len;
+        pgather->len[idx] = arglen[i];
+        pgather->data_len += arglen[i];
+      }
+    break;
+    case GATHER_SUM:
+      if(argc==1 && argv[0])
+        pgather->sum += strtoll(argv[0] , NULL , 10);
+    break;
+    default:
+    break;
+  }
+}
+
+//sub cmd drained without callback. gather finished in next tick
+static void _gather_drop(CBINFO *pcb)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  GATHERSUB sub;
+
+  memcpy(&sub , pcb->private , sizeof(sub));
+  if(sub.pgather->result == CB_RET_SUCCESS)
+    sub.pgather->result = CB_RET_DISCONNECT;
+  if(--sub.pgather->pending == 0)
+  {
+    sub.pgather->next = pspace->gather_done;
+    pspace->gather_done = sub.pgather;
+  }
+}
+
+//one callback of gathered reply and free it
+static void _gather_finish(GATHER *pgather)
+{
+  char **argv = NULL;
+  int *arglen = NULL;
+  int argc = 0;
+  char num[32];
+  char *str = NULL;
+  int len = 0;
+  int i = 0;
+
+  if(pgather->result != CB_RET_SUCCESS)
+  {
+    if(pgather->err)
+    {
+      argv = &pgather->err;
+      arglen = &pgather->err_len;
+      argc = 1;
+    }
+  }
+  else if(pgather->op == GATHER_MGET)
+  {
+    argv = (char **)malloc(pgather->nkeys*sizeof(char *));
+    if(argv)
+    {
+      for(i=0; i<pgather->nkeys; i++)
+        argv[i] = pgather->off[i]>=0? pgather->data+pgather->off[i] : NULL;
+      arglen = pgather->len;
+      argc = pgather->nkeys;
+    }
+    else
+      pgather->result = CB_RET_ERROR;
+  }
+  else
+  {
+    if(pgather->op == GATHER_MSET)
+      str = "OK";
+    else
+    {
+      snprintf(num , sizeof(num) , "%lld" , pgather->sum);
+      str = num;
+    }
+    len = strlen(str);
+    argv = &str;
+    arglen = &len;
+    argc = 1;
+  }
+
+  if(pgather->func)
+    (*pgather->func)(pgather->private , pgather->private_len , pgather->result , argc , argv , arglen);
+
+  if(pgather->result==CB_RET_SUCCESS && pgather->op==GATHER_MGET)
+    free(argv);
+  free(pgather->data);
+  free(pgather->err);
+  free(pgather);
+}
+
+//finish gathers in done list
+static void _gather_flush()
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  GATHER *pgather = NULL;
+
+  while(pspace->gather_done)
+  {
+    pgather = pspace->gather_done;
+    pspace->gather_done = pgather->next;
+    _gather_finish(pgather);
+  }
+}
+
+/***Replica Group*/
+static REDISREPL *_repl_get(int gd)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+
+  if(gd<0 || gd>=pspace->repl_len || !pspace->repl_list[gd].samples)
+    return NULL;
+  return &pspace->repl_list[gd];
+}
+
+static int _repl_name_cmp(const void *a , const void *b)
+{
+  return strcmp((const char *)a , *(const char **)b);
+}
+
+//cmds served by replica. sorted for bsearch
+//return 1:read-only 0:not
+static int _repl_readonly(const char *name , int len)
+{
+  static const char *read_cmds[] = {"BITCOUNT" , "EXISTS" , "GEODIST" , "GEOPOS" , "GET" , "GETBIT" , "GETRANGE" , 
+    "HEXISTS" , "HGET" , "HGETALL" , "HKEYS" , "HLEN" , "HMGET" , "HSCAN" , "HSTRLEN" , "HVALS" , "LINDEX" , "LLEN" , 
+    "LRANGE" , "MGET" , "PFCOUNT" , "PTTL" , "SCAN" , "SCARD" , "SISMEMBER" , "SMEMBERS" , "SMISMEMBER" , 
+    "SRANDMEMBER" , "SSCAN" , "STRLEN" , "TTL" , "TYPE" , "XLEN" , "XRANGE" , "XREVRANGE" , "ZCARD" , "ZCOUNT" , 
+    "ZMSCORE" , "ZRANGE" , "ZRANGEBYSCORE" , "ZRANK" , "ZREVRANGE" , "ZREVRANGEBYSCORE" , "ZREVRANK" , "ZSCAN" , 
+    "ZSCORE"};
+  char upper[20];
+  int i = 0;
+
+  if(!name || len<=0 || len>=(int)sizeof(upper))
+    return 0;
+  for(i=0; i<len; i++)
+    upper[i] = toupper((unsigned char)name[i]);
+  upper[len] = 0;
+
+  return bsearch(upper , read_cmds , sizeof(read_cmds)/sizeof(char *) , sizeof(char *) , _repl_name_cmp)? 1 : 0;
+}
+
+//connected member of group
+static REDISENV *_repl_env(int rd)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISENV *penv = NULL;
+
+  if(rd<0 || !pspace->env_list || pspace->list_len<0 || rd>=(int)pow(2 , pspace->list_len))
+    return NULL;
+  penv = &pspace->env_list[rd];
+  if(penv->stat==REDIS_ENV_STAT_EMPTY || penv->flag!=REDIS_CONN_FLG_CONNECTED || !penv->hiredis_cxt)
+    return NULL;
+  return penv;
+}
+
+//replica for a read. chance in inverse proportion to rtt. master if no replica connected
+//return rd; -1:no node
+static int _repl_pick(REDISREPL *prepl , int exclude)
+{
+  REDISENV *penv = NULL;
+  unsigned int weight[REDIS_REPL_MAX_REPLICAS];
+  unsigned long long total = 0;
+  unsigned long long r = 0;
+  int cnt = 0;
+  int i = 0;
+
+  cnt = prepl->count; //limited by redis_repl_open
+  for(i=0; i<cnt; i++)
+  {
+    weight[i] = 0;
+    if(prepl->replicas[i] == exclude)
+      continue;
+    penv = _repl_env(prepl->replicas[i]);
+    if(!penv)
+      continue;
+    weight[i] = 1000000 / (penv->rtt_us>0? penv->rtt_us : 1);
+    if(weight[i] == 0)
+      weight[i] = 1;
+    total += weight[i];
+  }
+
+  if(total > 0)
+  {
+    r = _rand_next() % total;
+    for(i=0; i<cnt; i++)
+    {
+      if(r < weight[i])
+        return prepl->replicas[i];
+      r -= weight[i];
+    }
+  }
+
+  if(prepl->master!=exclude && _repl_env(prepl->master))
+    return prepl->master;
+  return -1;
+}
+
+static int _repl_sample_cmp(const void *a , const void *b)
+{
+  return *(const int *)a - *(const int *)b;
+}
+
+//latency of a read. moving average of node for routing and p95 of group for hedging
+static void _repl_sample(REDISENV *penv , long long us)
+{
+  REDISREPL *prepl = NULL;
+  int sorted[REDIS_REPL_SAMPLES];
+  int n = 0;
+
+  if(us < 0)
+    us = 0;
+  if(us > 0x7fffffff)
+    us = 0x7fffffff;
+  penv->rtt_us = (int)(((long long)penv->rtt_us*7 + us) / 8);
+  if(penv->rtt_us <= 0)
+    penv->rtt_us = 1;
+
+  prepl = _repl_get(penv->repl-1);
+  if(!prepl)
+    return;
+  prepl->samples[prepl->sample_cnt++ & (REDIS_REPL_SAMPLES-1)] = (int)us;
+  if(prepl->sample_cnt % REDIS_REPL_P95_EVERY)
+    return;
+
+  n = prepl->sample_cnt<REDIS_REPL_SAMPLES? prepl->sample_cnt : REDIS_REPL_SAMPLES;
+  memcpy(sorted , prepl->samples , n*sizeof(int));
+  qsort(sorted , n , sizeof(int) , _repl_sample_cmp);
+  prepl->hedge_ms = (sorted[n*95/100] + 999) / 1000; //wheel ticks in ms
+}
+
+//send formatted read of group. buf is taken over
+static int _repl_send(int gd , char *cmd , int len , REDIS_CALLBACK callback , char *private , 
+  int private_len)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISREPL *prepl = NULL;
+  REDISENV *penv = NULL;
+  HEDGE *phedge = NULL;
+  HEDGESUB sub;
+  int rd = -1;
+  int ret = -1;
+
+  prepl = _repl_get(gd);
+  if(!prepl)
+  {
+    redisFreeCommand(cmd);
+    return -1;
+  }
+
+  //reads without p95 yet
+  if(!prepl->hedge || prepl->hedge_ms<=0)
+  {
+    rd = _repl_pick(prepl , -1);
+    ret = _exec_raw(rd , cmd , len , callback , private , private_len , _now_us() , NULL);
+    redisFreeCommand(cmd);
+    return ret;
+  }
+
+  //hedged read. cmd kept for second attempt
+  rd = _repl_pick(prepl , -1);
+  penv = _repl_env(rd);
+  if(!penv)
+  {
+    slog_log(pspace->slog_d , SL_ERR , "<%s> failed! no node connected! gd:%d" , __FUNCTION__ , gd);
+    redisFreeCommand(cmd);
+    return -1;
+  }
+  phedge = (HEDGE *)calloc(1 , sizeof(HEDGE) + (private_len>0? private_len : 0));
+  if(!phedge)
+  {
+    slog_log(pspace->slog_d , SL_ERR , "<%s> failed! alloc hedge err:%s gd:%d" , __FUNCTION__ , strerror(errno) , gd);
+    redisFreeCommand(cmd);
+    return -1;
+  }
+  phedge->func = callback;
+  phedge->gd = gd;
+  phedge->timer = -1;
+  phedge->cmd = cmd;
+  phedge->cmd_len = len;
+  phedge->private = (char *)(phedge + 1);
+  phedge->private_len = (private && private_len>0)? private_len : 0;
+  if(phedge->private_len > 0)
+    memcpy(phedge->private , private , private_len);
+
+  //held by send. attempt dropped while sending is called back in tick
+  phedge->refs = 2;
+  phedge->sent = 1;
+  phedge->rd[0] = rd;
+  phedge->gen[0] = penv->gen;
+  sub.phedge = phedge;
+  sub.k = 0;
+  if(_exec_raw(rd , cmd , len , _hedge_cb , (char *)&sub , sizeof(sub) , _now_us() , &phedge->seq[0]) < 0)
+  {
+    _hedge_free(phedge);
+    return -1;
+  }
+
+  //second attempt when no reply within p95
+  penv = _env_alive(rd , phedge->gen[0]);
+  if(phedge->refs==2 && penv)
+  {
+    phedge->timer = _timer_add(penv , phedge->seq[0] , _now_ms()+prepl->hedge_ms);
+    if(phedge->timer >= 0)
+      pspace->wheel.nodes[phedge->timer].hedge = phedge;
+  }
+  _hedge_release(phedge);
+  return 0;
+}
+
+//append a formatted cmd
+//return 0:success -1:failed
+static int _exec_raw(int rd , char *cmd , int len , REDIS_CALLBACK callback , char *private , int private_len , 
+  long long sent_us , unsigned int *pseq)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISENV *penv = NULL;
+  CBINFO *pcb = NULL;
+
+  penv = _rd2env(rd , __FUNCTION__);
+  if(!penv)
+    return -1;
+  if(penv->flag!=REDIS_CONN_FLG_CONNECTED || !penv->hiredis_cxt)
+  {
+    slog_log(pspace->slog_d , SL_ERR , "<%s> failed! not connected!rd:%d flag:%d" , __FUNCTION__ , rd , penv->flag);
+    return -1;
+  }
+
+  pcb = _save_cb(penv , callback , NULL , private , private_len);
+  if(!pcb)
+    return -1;
+  pcb->sent_us = sent_us;
+
+  if(redisAppendFormattedCommand(penv->hiredis_cxt , cmd , len) != REDIS_OK)
+  {
+    slog_log(pspace->slog_d , SL_ERR , "<%s> failed! err:%s rd:%d" , __FUNCTION__ , penv->hiredis_cxt->errstr , rd);
+    _tcancel_cbi(penv);
+    return -1;
+  }
+  if(pseq)
+    *pseq = penv->cb_tail - 1;
+
+  _env_appended(penv);
+  return 0;
+}
+
+/***Hedged Read*/
+//callback of an attempt. first reply wins and the other one is ignored
+static int _hedge_cb(char *private , int private_len , REDIS_CB_RESULT result , int argc , char *argv[] , int arglen[])
+{
+  HEDGESUB sub;
+  HEDGE *phedge = NULL;
+
+  (void)private_len;
+  memcpy(&sub , private , sizeof(sub));
+  phedge = sub.phedge;
+  phedge->refs--;
+
+  //lost attempt. wait for the other or send it at once
+  if(!phedge->done && (result==CB_RET_TIMEOUT || result==CB_RET_DISCONNECT))
+  {
+    if(phedge->refs > 0)
+      return 0;
+    if(phedge->timer >= 0)
+    {
+      _timer_del(phedge->timer);
+      phedge->timer = -1;
+      phedge->refs++;
+      _hedge_expire(phedge);
+      if(--phedge->refs > 0)
+        return 0;
+    }
+  }
+
+  if(!phedge->done)
+  {
+    phedge->done = 1;
+    if(phedge->timer >= 0)
+    {
+      _timer_del(phedge->timer);
+      phedge->timer = -1;
+    }
+    if(phedge->refs > 0)
+      _hedge_ignore(phedge , 1-sub.k);
+
+    phedge->refs++; //callback may close members
+    if(phedge->func)
+      (*phedge->func)(phedge->private , phedge->private_len , result , argc , argv , arglen);
+    phedge->refs--;
+  }
+
+  if(phedge->refs == 0)
+    _hedge_free(phedge);
+  return 0;
+}
+
+//send second attempt to another node
+static void _hedge_expire(HEDGE *phedge)
+{
+  REDISREPL *prepl = NULL;
+  REDISENV *penv = NULL;
+  HEDGESUB sub;
+  int rd = -1;
+
+  if(phedge->done || phedge->sent>=2)
+    return;
+  prepl = _repl_get(phedge->gd);
+  if(!prepl)
+    return;
+  rd = _repl_pick(prepl , phedge->rd[0]);
+  penv = _repl_env(rd);
+  if(!penv)
+    return;
+
+  phedge->sent = 2;
+  phedge->rd[1] = rd;
+  phedge->gen[1] = penv->gen;
+  sub.phedge = phedge;
+  sub.k = 1;
+  phedge->refs++;
+  if(_exec_raw(rd , phedge->cmd , phedge->cmd_len , _hedge_cb , (char *)&sub , sizeof(sub) , _now_us() , 
+    &phedge->seq[1]) < 0)
+    phedge->refs--;
+}
+
+//ignore attempt k. its reply dropped as a late one
+static void _hedge_ignore(HEDGE *phedge , int k)
+{
+  REDISENV *penv = NULL;
+  CBINFO *pslot = NULL;
+  HEDGESUB sub;
+
+  if(k >= phedge->sent)
+    return;
+  penv = _env_alive(phedge->rd[k] , phedge->gen[k]);
+  if(!penv || phedge->seq[k]-penv->cb_head>=(unsigned int)penv->cb_count)
+    return;
+  pslot = &penv->cb_ring[phedge->seq[k] & (penv->cb_size-1)];
+  if(pslot->stat!=CB_INFO_STAT_VALID || pslot->func!=_hedge_cb)
+    return;
+  memcpy(&sub , pslot->private , sizeof(sub));
+  if(sub.phedge != phedge)
+    return;
+
+  if(pslot->timer >= 0)
+  {
+    _timer_del(pslot->timer);
+    pslot->timer = -1;
+  }
+  pslot->stat = CB_INFO_STAT_TIMEOUT;
+  phedge->refs--;
+}
+
+//attempt drained without callback. hedge called back in tick
+static void _hedge_drop(CBINFO *pcb)
+{
+  HEDGESUB sub;
+
+  memcpy(&sub , pcb->private , sizeof(sub));
+  _hedge_release(sub.phedge);
+}
+
+static void _hedge_release(HEDGE *phedge)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+
+  if(--phedge->refs > 0)
+    return;
+  if(phedge->timer >= 0)
+  {
+    _timer_del(phedge->timer);
+    phedge->timer = -1;
+  }
+  if(phedge->done)
+  {
+    _hedge_free(phedge);
+    return;
+  }
+  phedge->next = pspace->hedge_done;
+  pspace->hedge_done = phedge;
+}
+
+static void _hedge_free(HEDGE *phedge)
+{
+  if(phedge->timer >= 0)
+    _timer_del(phedge->timer);
+  redisFreeCommand(phedge->cmd);
+  free(phedge);
+}
+
+//fail hedges in done list
+static void _hedge_flush()
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  HEDGE *phedge = NULL;
+
+  while(pspace->hedge_done)
+  {
+    phedge = pspace->hedge_done;
+    pspace->hedge_done = phedge->next;
+    if(phedge->func)
+      (*phedge->func)(phedge->private , phedge->private_len , CB_RET_DISCONNECT , 0 , NULL , NULL);
+    _hedge_free(phedge);
+  }
+}
+
+/***Pub/Sub*/
+//handler table of env. created when first subscribed
+static SUBTABLE *_sub_table(REDISENV *penv)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  SUBTABLE *psub = NULL;
+
+  if(penv->sub)
+    return penv->sub;
+
+  //replies of cmds pending would be taken as messages
+  if(penv->cb_count>0 || penv->pool || penv->cluster || penv->repl)
+  {
+    slog_log(pspace->slog_d , SL_ERR , "<%s> failed! rd has cmds pending or is grouped! rd:%d" , __FUNCTION__ , penv->id);
+    return NULL;
+  }
+
+  psub = (SUBTABLE *)calloc(1 , sizeof(SUBTABLE));
+  if(!psub)
+    return NULL;
+  psub->size = SUB_TABLE_INIT;
+  psub->buckets = (SUBHANDLER **)calloc(psub->size , sizeof(SUBHANDLER *));
+  psub->pend = sdsempty();
+  if(!psub->buckets || !psub->pend)
+  {
+    slog_log(pspace->slog_d , SL_ERR , "<%s> failed! alloc table err:%s rd:%d" , __FUNCTION__ , strerror(errno) , penv->id);
+    free(psub->buckets);
+    sdsfree(psub->pend);
+    free(psub);
+    return NULL;
+  }
+  penv->sub = psub;
+  return psub;
+}
+
+//link to handler of name. *link is NULL if not found
+static SUBHANDLER **_sub_link(SUBTABLE *psub , int pattern , const char *name , int len , unsigned int hash)
+{
+  SUBHANDLER **plink = &psub->buckets[hash & (psub->size-1)];
+
+  for(; *plink; plink=&(*plink)->next)
+  {
+    if((*plink)->hash==hash && (*plink)->pattern==pattern && (*plink)->name_len==len && 
+      memcmp((*plink)->name , name , len)==0)
+      break;
+  }
+  return plink;
+}
+
+//double buckets when full
+static void _sub_grow(SUBTABLE *psub)
+{
+  SUBHANDLER **new_buckets = NULL;
+  SUBHANDLER *ph = NULL;
+  unsigned int new_size = psub->size * 2;
+  unsigned int i = 0;
+
+  new_buckets = (SUBHANDLER **)calloc(new_size , sizeof(SUBHANDLER *));
+  if(!new_buckets) //longer chains only
+    return;
+
+  for(i=0; i<psub->size; i++)
   {
-    if(argv)
-    {      
-      free(argv);
-    }
-    
-    if(arglen)
-    {      
-      free(arglen);
+    while((ph = psub->buckets[i]))
+    {
+      psub->buckets[i] = ph->next;
+      ph->next = new_buckets[ph->hash & (new_size-1)];
+      new_buckets[ph->hash & (new_size-1)] = ph;
     }
   }
-
-  _free_cb(pstCBInfo);
-  return 0;  
+  free(psub->buckets);
+  psub->buckets = new_buckets;
+  psub->size = new_size;
 }
 
-
-
-//timeout:ms
-static int _fd_readable(int fd , int timeout)
+static int _sub_add(int rd , int pattern , int count , const char *names[] , REDIS_SUB_CALLBACK callback , 
+  char *private , int private_len)
 {
-  struct timeval tv;
-  fd_set fds;
-  int ret;
-
-  //set tv
-  tv.tv_sec = timeout / 1000;
-  tv.tv_usec = timeout % 1000 * 1000;
-
-  //set fd 
-  FD_ZERO(&fds);
-  FD_SET(fd , &fds);
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  REDISENV *penv = NULL;
+  SUBTABLE *psub = NULL;
+  SUBHANDLER **plink = NULL;
+  SUBHANDLER *ph = NULL;
+  unsigned int hash = 0;
+  int len = 0;
+  int i = 0;
 
-  //select
-  ret = select(fd+1 , &fds , NULL , NULL , &tv);
-  if(ret < 0)
+  if(count<=0 || !names || !callback)
   {
-    printf("%s failed! select error! err:%s\n" , __FUNCTION__ , strerror(errno));
+    slog_log(pspace->slog_d , SL_ERR , "<%s> failed! arg illegal! rd:%d count:%d" , __FUNCTION__ , rd , count);
     return -1;
   }
+  if(!private || private_len<0)
+    private_len = 0;
+
+  penv = _rd2env(rd , __FUNCTION__);
+  if(!penv)
+    return -1;
+  psub = _sub_table(penv);
+  if(!psub)
+    return -1;
 
-  if(ret==1 && FD_ISSET(fd , &fds))
+  for(i=0; i<count; i++)
   {
-    printf("%s ok!\n" , __FUNCTION__);
-    return 1;
-  }
+    if(!names[i])
+      continue;
+    len = strlen(names[i]);
+    hash = _shard_hash(names[i] , len);
+    plink = _sub_link(psub , pattern , names[i] , len , hash);
+
+    ph = (SUBHANDLER *)malloc(sizeof(SUBHANDLER) + len + 1 + private_len);
+    if(!ph)
+    {
+      slog_log(pspace->slog_d , SL_ERR , "<%s> failed! alloc handler err:%s rd:%d" , __FUNCTION__ , strerror(errno) , rd);
+      return -1;
+    }
+    ph->hash = hash;
+    ph->pattern = pattern;
+    ph->func = callback;
+    ph->name_len = len;
+    memcpy(ph->name , names[i] , len+1);
+    ph->private = ph->name + len + 1;
+    ph->private_len = private_len;
+    if(private_len > 0)
+      memcpy(ph->private , private , private_len);
+
+    //subscribed. only handler replaced
+    if(*plink)
+    {
+      ph->next = (*plink)->next;
+      free(*plink);
+      *plink = ph;
+      continue;
+    }
 
-  printf("%s not ready!\n" , __FUNCTION__);
+    ph->next = psub->buckets[hash & (psub->size-1)];
+    psub->buckets[hash & (psub->size-1)] = ph;
+    psub->count++;
+    if((unsigned int)psub->count > psub->size)
+      _sub_grow(psub);
+    _sub_queue(penv , pattern? SUB_CMD_PSUBSCRIBE : SUB_CMD_SUBSCRIBE , names[i] , len);
+  }
   return 0;
 }
 
-//timeout:ms
-static int _fd_writable(int fd , int timeout)
+static int _sub_del(int rd , int pattern , int count , const char *names[])
 {
-  struct timeval tv;
-  fd_set fds;
-  int ret;
-
-  //set tv
-  tv.tv_sec = timeout / 1000;
-  tv.tv_usec = timeout % 1000 * 1000;
+  REDISENV *penv = NULL;
+  SUBTABLE *psub = NULL;
+  SUBHANDLER **plink = NULL;
+  SUBHANDLER *ph = NULL;
+  int kind = pattern? SUB_CMD_PUNSUBSCRIBE : SUB_CMD_UNSUBSCRIBE;
+  unsigned int b = 0;
+  int len = 0;
+  int i = 0;
 
-  //set fd 
-  FD_ZERO(&fds);
-  FD_SET(fd , &fds);
+  if(count<0 || (count>0 && !names))
+    return -1;
+  penv = _rd2env(rd , __FUNCTION__);
+  if(!penv || !penv->sub)
+    return -1;
+  psub = penv->sub;
 
-  //select
-  ret = select(fd+1 , NULL , &fds , NULL , &tv);
-  if(ret < 0)
+  //all of kind
+  if(count == 0)
   {
-    printf("%s failed! select error! err:%s\n" , __FUNCTION__ , strerror(errno));
-    return -1;
+    for(b=0; b<psub->size; b++)
+    {
+      plink = &psub->buckets[b];
+      while((ph = *plink))
+      {
+        if(ph->pattern != pattern)
+        {
+          plink = &ph->next;
+          continue;
+        }
+        _sub_queue(penv , kind , ph->name , ph->name_len);
+        *plink = ph->next;
+        free(ph);
+        psub->count--;
+      }
+    }
+    return 0;
   }
 
-  if(ret==1 && FD_ISSET(fd , &fds))
+  for(i=0; i<count; i++)
   {
-    //printf("%s ok!\n" , __FUNCTION__);
-    return 1;
+    if(!names[i])
+      continue;
+    len = strlen(names[i]);
+    plink = _sub_link(psub , pattern , names[i] , len , _shard_hash(names[i] , len));
+    ph = *plink;
+    if(!ph)
+      continue;
+    _sub_queue(penv , kind , ph->name , ph->name_len);
+    *plink = ph->next;
+    free(ph);
+    psub->count--;
   }
-
-  printf("%s not ready!\n" , __FUNCTION__);
   return 0;
 }
 
-//PUSH a CBINFO into Tail of CallBack Chain List in Env
+//add an arg to pending (un)subscribe cmd. sent in tick
 //return 0:success -1:failed
-static int _tpush_cbi(REDISENV *pstEnv , CBINFO *pstCBInfo)
+static int _sub_queue(REDISENV *penv , int kind , const char *name , int len)
 {
-  /***Arg Check*/
-  if(!pstEnv || !pstCBInfo)
-  {
-    printf("%s failed! arg null!\n" , __FUNCTION__);
-    return -1;
-  }
+  SUBTABLE *psub = penv->sub;
+  char head[32];
+  sds pend = NULL;
+  int n = 0;
 
-  //push an empty list
-  if(pstEnv->cb_count == 0)
-  {
-    pstEnv->cb_head = pstCBInfo;
-    pstEnv->cb_tail = pstCBInfo;
-    pstEnv->cb_count++;
+  //all restored when connected
+  if(penv->flag!=REDIS_CONN_FLG_CONNECTED || !penv->hiredis_cxt)
     return 0;
-  }
 
-  //push to tail
-  pstEnv->cb_tail->next = pstCBInfo;
-  pstEnv->cb_tail = pstCBInfo;
-  pstEnv->cb_count++;
+  //keep order of calls
+  if(psub->pend_cnt>0 && psub->pend_kind!=kind)
+    _sub_flush(penv);
+
+  head[n++] = '$';
+  n += _ll2str(head+n , len);
+  head[n++] = '\r';
+  head[n++] = '\n';
+  pend = sdscatlen(psub->pend , head , n);
+  if(pend)
+    pend = sdscatlen(pend , name , len);
+  if(pend)
+    pend = sdscatlen(pend , "\r\n" , 2);
+  if(!pend)
+    return -1;
+  psub->pend = pend;
+  psub->pend_kind = kind;
+  psub->pend_cnt++;
+  return _wqueue_push(penv);
+}
+
+//move pending cmd into output buff
+//return 0:success -1:failed
+static int _sub_flush(REDISENV *penv)
+{
+  static const char *sub_cmds[] = {"SUBSCRIBE" , "UNSUBSCRIBE" , "PSUBSCRIBE" , "PUNSUBSCRIBE"};
+  SUBTABLE *psub = penv->sub;
+  redisContext *c = penv->hiredis_cxt;
+  char head[64];
+  sds obuf = NULL;
+  int n = 0;
+
+  if(psub->pend_cnt <= 0)
+    return 0;
+  n = snprintf(head , sizeof(head) , "*%d\r\n$%d\r\n%s\r\n" , psub->pend_cnt+1 , (int)strlen(sub_cmds[psub->pend_kind]) , 
+    sub_cmds[psub->pend_kind]);
+  obuf = sdscatlen(c->obuf , head , n);
+  if(obuf)
+    obuf = sdscatlen(obuf , psub->pend , sdslen(psub->pend));
+  if(!obuf)
+    return -1;
+  c->obuf = obuf;
+  sdsclear(psub->pend);
+  psub->pend_cnt = 0;
   return 0;
 }
 
-//POP a CBINFO out of head of CallBack Chain List in Env
-//return NULL:failed or empy else pointer of CBINFO
-static CBINFO * _hpop_cbi(REDISENV *pstEnv)
+//subscribe all again on new connection
+static void _sub_resume(REDISENV *penv)
 {
-  CBINFO *pstCBInfo = NULL;
-  
-  /***Arg Check*/
-  if(!pstEnv)
+  SUBTABLE *psub = penv->sub;
+  SUBHANDLER *ph = NULL;
+  unsigned int b = 0;
+  int pattern = 0;
+
+  sdsclear(psub->pend);
+  psub->pend_cnt = 0;
+  for(pattern=0; pattern<2; pattern++)
   {
-    printf("%s failed! arg null!\n" , __FUNCTION__);
-    return NULL;
+    for(b=0; b<psub->size; b++)
+    {
+      for(ph=psub->buckets[b]; ph; ph=ph->next)
+      {
+        if(ph->pattern == pattern)
+          _sub_queue(penv , pattern? SUB_CMD_PSUBSCRIBE : SUB_CMD_SUBSCRIBE , ph->name , ph->name_len);
+      }
+    }
   }
-  
-  if(pstEnv->cb_count <= 0)
+  slog_log(redis_space->slog_d , SL_INFO , "<%s> resubscribe %d! rd:%d" , __FUNCTION__ , psub->count , penv->id);
+}
+
+//message to handler. payload passed in place
+static int _sub_dispatch(REDISENV *penv , REPLYNODE *preply)
+{
+  REDIS_GLOBALSPACE *pspace = redis_space;
+  SUBHANDLER *ph = NULL;
+  char **argv = preply->argv;
+  int *arglen = preply->arglen;
+  int pattern = 0;
+  int ch = 1;
+
+  if((preply->type!=REDIS_REPLY_ARRAY && preply->type!=REDIS_REPLY_PUSH) || preply->len<3 || !argv[0] || !argv[1])
   {
-    printf("%s failed! callback list empty!\n" , __FUNCTION__);
-    return NULL;
+    if(preply->type == REDIS_REPLY_ERROR)
+      slog_log(pspace->slog_d , SL_ERR , "<%s> error:%s rd:%d" , __FUNCTION__ , preply->str , penv->id);
+    return 0;
   }
 
-  //pop last one
-  if(pstEnv->cb_count == 1)
+  if(arglen[0]==7 && memcmp(argv[0] , "message" , 7)==0)
+    pattern = 0;
+  else if(arglen[0]==8 && memcmp(argv[0] , "pmessage" , 8)==0 && preply->len>=4)
   {
-    pstCBInfo = pstEnv->cb_head;
-    pstEnv->cb_head = NULL;
-    pstEnv->cb_tail = NULL;
-    pstEnv->cb_count--;
-    return pstCBInfo;
+    pattern = 1;
+    ch = 2;
+  }
+  else //confirm of (un)subscribe
+  {
+    slog_log(pspace->slog_d , SL_DEBUG , "<%s> %.*s %.*s rd:%d" , __FUNCTION__ , arglen[0] , argv[0] , arglen[1] , argv[1] , 
+      penv->id);
+    return 0;
   }
 
-  //pop head
-  pstCBInfo = pstEnv->cb_head;
-  pstEnv->cb_head = pstEnv->cb_head->next;
-  pstEnv->cb_count--;
-  return pstCBInfo;
+  //unsubscribed while in flight
+  ph = *_sub_link(penv->sub , pattern , argv[1] , arglen[1] , _shard_hash(argv[1] , arglen[1]));
+  if(!ph || !argv[ch])
+    return 0;
+
+  (*ph->func)(ph->private , ph->private_len , argv[ch] , arglen[ch] , argv[ch+1] , argv[ch+1]? arglen[ch+1] : 0);
+  return 0;
 }
 
-static void _print_space()
+static void _sub_free(REDISENV *penv)
 {
-  REDISENV *penv = NULL;
-  REDIS_GLOBALSPACE *pspace = &redis_global_space;
-  int i = 0;
-  int sld = -1;
-  int real_len = 0;
-  
+  SUBTABLE *psub = penv->sub;
+  SUBHANDLER *ph = NULL;
+  unsigned int b = 0;
 
-  if(pspace->slog_d < 0)
+  if(!psub)
     return;
-
-  sld = pspace->slog_d;
-  //real_len
-  if(pspace->env_list && pspace->list_len>=0)
-    real_len = (int)pow(2 , pspace->list_len);
-
-  
-  //PRINT 
-  slog_log(sld, SL_VERBOSE , "(((=============PRINT=============");
-  slog_log(sld , SL_VERBOSE , "----valid_count:%d list_len:%d----" , pspace->valid_count , pspace->list_len);
-  for(i=0; i<real_len; i++)
+  for(b=0; b<psub->size; b++)
   {
-    penv = &pspace->env_list[i];
-    slog_log(sld, SL_VERBOSE, "stat:%d id:%d ip:%s port:%d cb_count:%d", penv->stat , penv->id , penv->ip , 
-      penv->port , penv->cb_count);
+    while((ph = psub->buckets[b]))
+    {
+      psub->buckets[b] = ph->next;
+      free(ph);
+    }
   }
-  slog_log(sld, SL_VERBOSE , "=============END=============)))");
+  free(psub->buckets);
+  sdsfree(psub->pend);
+  free(psub);
+  penv->sub = NULL;
+}
 
-  return;
+/***IO Thread*/
+static int _ring_init(IORING *ring , unsigned int size)
+{
+  ring->slots = (void **)calloc(size , sizeof(void *));
+  if(!ring->slots)
+    return -1;
+  ring->size = size;
+  return 0;
 }
 
-static REDISENV *_rd2env(int rd , const char *caller)
+//producer side
+//return 0:success -1:full
+static int _ring_push(IORING *ring , void *p)
 {
-  REDISENV *penv = NULL;
-  REDIS_GLOBALSPACE *pspace = &redis_global_space;
-  int real_len = 0;
-  int sld = -1;
-  int i;
+  unsigned int tail = __atomic_load_n(&ring->tail , __ATOMIC_RELAXED);
 
-  /***Arg Check*/
-  sld = pspace->slog_d;
-  if(sld < 0) //not opened yet
-    return NULL;
+  if(tail-__atomic_load_n(&ring->head , __ATOMIC_ACQUIRE) >= ring->size)
+    return -1;
+  ring->slots[tail & (ring->size-1)] = p;
+  __atomic_store_n(&ring->tail , tail+1 , __ATOMIC_RELEASE);
+  return 0;
+}
 
-  if(!caller)
-  {
-    slog_log(sld, SL_ERR, "<%s> failed! caller nil! rd:%d", __FUNCTION__ , rd);
-    return NULL;
-  }
+//consumer side
+//return NULL:empty
+static void *_ring_pop(IORING *ring)
+{
+  unsigned int head = __atomic_load_n(&ring->head , __ATOMIC_RELAXED);
+  void *p = NULL;
 
-  //empty list
-  if(!pspace->env_list || pspace->list_len<0)
-  {
-    slog_log(sld, SL_ERR, "<%s> failed! Empty List! rd:%d caller:%s", __FUNCTION__ , rd , caller);
+  if(head == __atomic_load_n(&ring->tail , __ATOMIC_ACQUIRE))
     return NULL;
-  }
+  p = ring->slots[head & (ring->size-1)];
+  __atomic_store_n(&ring->head , head+1 , __ATOMIC_RELEASE);
+  return p;
+}
 
-  //rd
-  real_len = (int)pow(2 , pspace->list_len);
-  if(rd<0 || rd>=real_len)
+//submit formatted cmd to io thread. cmd is taken over
+static int _io_send(REDISIO *io , int rd , char *cmd , int len , REDIS_CALLBACK callback , char *private , 
+  int private_len)
+{
+  IOREQ *req = NULL;
+
+  if(!private || private_len<0)
+    private_len = 0;
+  req = (IOREQ *)malloc(sizeof(IOREQ) + private_len);
+  if(!req)
   {
-    slog_log(sld, SL_ERR, "<%s> failed! rd illegal! rd:%d real_len:%d caller:%s", __FUNCTION__ , rd , 
-      real_len , caller);
-    return NULL;  
+    redisFreeCommand(cmd);
+    return -1;
   }
-
-  /***Get Env*/
-  penv = &pspace->env_list[rd];
-  if(penv->stat == REDIS_ENV_STAT_EMPTY)
+  req->io = io;
+  req->rd = rd;
+  req->func = callback;
+  req->cmd = cmd;
+  req->cmd_len = len;
+  req->private = (char *)(req + 1);
+  req->private_len = private_len;
+  if(private_len > 0)
+    memcpy(req->private , private , private_len);
+
+  //full. app backs off
+  if(_ring_push(&io->sq , req) < 0)
   {
-    slog_log(sld, SL_ERR, "<%s> failed! rd not used! rd:%d caller:%s", __FUNCTION__ , rd , caller);
-    return NULL;
+    redisFreeCommand(cmd);
+    free(req);
+    return -1;
   }
 
-  if(penv->id != rd)
+  //wake only a sleeping io thread. pairs with fence in _io_main
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if(__atomic_load_n(&io->sleeping , __ATOMIC_RELAXED))
+    _efd_write(io->efd);
+  return 0;
+}
+
+static void *_io_main(void *arg)
+{
+  REDISIO *io = (REDISIO *)arg;
+  IOCOMP *pcomp = NULL;
+  IOCOMP *next = NULL;
+
+  redis_ctx_use(io->ctx);
+  while(!__atomic_load_n(&io->stop , __ATOMIC_ACQUIRE))
   {
-    slog_log(sld, SL_ERR, "<%s> failed! rd not match! rd:%d id:%d caller:%s", __FUNCTION__ , rd , 
-      penv->id , caller);
-    return NULL;
+    _io_submit(io);
+
+    //completions held while app was slow. next taken before app owns it
+    while(io->backlog)
+    {
+      pcomp = io->backlog;
+      next = pcomp->next;
+      if(_ring_push(&io->cq , pcomp) < 0)
+        break;
+      io->backlog = next;
+    }
+
+    //check ring again after flag set. submission in between is not missed
+    __atomic_store_n(&io->sleeping , 1 , __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if(__atomic_load_n(&io->sq.tail , __ATOMIC_ACQUIRE) != io->sq.head)
+    {
+      //socket io of each drained batch goes on under steady submissions
+      __atomic_store_n(&io->sleeping , 0 , __ATOMIC_RELAXED);
+      redis_wait(0);
+      continue;
+    }
+    //idle until submission,reply or deadline. held completions retried soon
+    if(io->backlog)
+      redis_tick();
+    else
+      redis_wait(-1);
+    __atomic_store_n(&io->sleeping , 0 , __ATOMIC_RELAXED);
+    _efd_read(io->efd);
   }
 
-  //slog_log(sld, SL_VERBOSE , "<%s> success! rd:%d caller:%s", __FUNCTION__ , rd , caller);
-  return penv;
+  //cmds in flight failed into completions
+  redis_ctx_close(io->ctx);
+  io->ctx = NULL;
+  return NULL;
 }
 
-//Clear most member. except stat,id
-static int _reset_env(REDISENV *penv)
+//exec submitted cmds on io context
+static void _io_submit(REDISIO *io)
 {
-  CBINFO *pcb = NULL;
-  /***Arg Check*/
-  if(!penv)
-    return -1;
+  IOREQ *req = NULL;
+  IOCOMP *pcomp = NULL;
+  char *err = "exec failed";
+  int len = strlen(err);
+  char *cmd = NULL;
+  int ret = 0;
 
-  //Clear
-  memset(penv->ip , 0 , sizeof(penv->ip));
-  penv->port = 0;
-  penv->hiredis_cxt = NULL;
-  penv->flag = REDIS_CONN_FLG_NONE;
-  while(penv->cb_count > 0)
+  while((req = (IOREQ *)_ring_pop(&io->sq)))
   {
-    pcb = _hpop_cbi(penv);     
-    _free_cb(pcb);
+    //req may be completed and freed inside exec if connection drops
+    cmd = req->cmd;
+    req->cmd = NULL;
+    ret = _exec_raw(req->rd , cmd , req->cmd_len , _io_cb , (char *)&req , sizeof(req) , 0 , NULL);
+    redisFreeCommand(cmd);
+    if(ret < 0) //failed like redis_exec returns -1
+    {
+      pcomp = _io_comp(req , CB_RET_ERROR , 1 , &err , &len);
+      if(pcomp)
+        _io_complete(io , pcomp);
+    }
   }
-  penv->cb_count = 0;
-  penv->cb_head = NULL;
-  penv->cb_tail = NULL;
-  penv->connect_end_ts = 0;
-  penv->timeout = 0;
+}
 
+//callback on io thread. reply copied since arena is reused
+static int _io_cb(char *private , int private_len , REDIS_CB_RESULT result , int argc , char *argv[] , int arglen[])
+{
+  IOREQ *req = NULL;
+  IOCOMP *pcomp = NULL;
+
+  (void)private_len;
+  memcpy(&req , private , sizeof(req));
+  pcomp = _io_comp(req , result , argc , argv , arglen);
+  if(pcomp)
+    _io_complete(req->io , pcomp);
   return 0;
 }
 
-//clear connection info
-static int _redis_disconnect(int rd)
+//cmd drained by close or disconnect
+static void _io_drop(CBINFO *pcb)
 {
-  REDISENV *pstEnv = NULL;
-  pstEnv = NULL;
-  int sld = -1;
-  REDIS_GLOBALSPACE *pspace = &redis_global_space;  
-  CBINFO *pcb = NULL;
+  IOREQ *req = NULL;
+  IOCOMP *pcomp = NULL;
 
-  /***Check Basic*/
-  sld = pspace->slog_d;
-  if(sld < 0)
-    return -1;
+  memcpy(&req , pcb->private , sizeof(req));
+  pcomp = _io_comp(req , CB_RET_DISCONNECT , 0 , NULL , NULL);
+  if(pcomp)
+    _io_complete(req->io , pcomp);
+}
 
-  /***Get Env*/
-  pstEnv = _rd2env(rd, __FUNCTION__);
-  if(!pstEnv)
-    return -1;
+//completion with reply in one block. cmd is failed with CB_RET_ERROR if reply can not be copied
+//return NULL:no callback or alloc failed. req freed
+static IOCOMP *_io_comp(IOREQ *req , REDIS_CB_RESULT result , int argc , char *argv[] , int arglen[])
+{
+  IOCOMP *pcomp = NULL;
+  size_t size = sizeof(IOCOMP);
+  char *data = NULL;
+  int i = 0;
 
-  /***Handle*/
-  //free hiredis info
-  if(pstEnv->hiredis_cxt)
+  if(!req->func)
   {
-    redisFree(pstEnv->hiredis_cxt);
-    pstEnv->hiredis_cxt = NULL;
+    free(req);
+    return NULL;
   }
 
-  //free callback info
-  while(pstEnv->cb_count > 0)
+  size += argc * (sizeof(char *) + sizeof(int));
+  for(i=0; i<argc; i++)
+    size += argv[i]? arglen[i]+1 : 0;
+  pcomp = (IOCOMP *)malloc(size);
+  if(!pcomp && argc>0) //reply lost. cmd failed instead
   {
-    pcb = _hpop_cbi(pstEnv);     
-    _free_cb(pcb);
+    slog_log(redis_space->slog_d , SL_ERR , "<%s> alloc completion:%zu failed! fail cmd of rd:%d" , __FUNCTION__ , 
+      size , req->rd);
+    result = CB_RET_ERROR;
+    argc = 0;
+    size = sizeof(IOCOMP);
+    pcomp = (IOCOMP *)malloc(size);
   }
-  pstEnv->cb_count = 0;
-  pstEnv->cb_head = NULL;
-  pstEnv->cb_tail = NULL;
-   
-  slog_log(sld , SL_INFO , "<%s> success! rd:%d" , __FUNCTION__ , rd);
-  return 0;
+  if(!pcomp)
+  {
+    slog_log(redis_space->slog_d , SL_ERR , "<%s> alloc completion failed! callback of rd:%d dropped" , 
+      __FUNCTION__ , req->rd);
+    free(req);
+    return NULL;
+  }
+
+  pcomp->next = NULL;
+  pcomp->req = req;
+  pcomp->result = result;
+  pcomp->argc = argc;
+  pcomp->argv = (char **)(pcomp + 1);
+  pcomp->arglen = (int *)(pcomp->argv + argc);
+  data = (char *)(pcomp->arglen + argc);
+  for(i=0; i<argc; i++)
+  {
+    pcomp->arglen[i] = arglen[i];
+    if(!argv[i])
+    {
+      pcomp->argv[i] = NULL;
+      continue;
+    }
+    pcomp->argv[i] = data;
+    memcpy(data , argv[i] , arglen[i]);
+    data[arglen[i]] = 0;
+    data += arglen[i] + 1;
+  }
+  return pcomp;
 }
 
-static void _free_cb(CBINFO *pcb)
+//hand completion to app. kept in order behind backlog if ring full
+static void _io_complete(REDISIO *io , IOCOMP *pcomp)
 {
-  if(!pcb)
+  if(!io->backlog && _ring_push(&io->cq , pcomp)==0)
     return;
+  if(io->backlog)
+    io->backlog_tail->next = pcomp;
+  else
+    io->backlog = pcomp;
+  io->backlog_tail = pcomp;
+}
 
-  if(pcb->private_len > DEFAULT_CB_PRIVATE_LEN)
-    free(pcb->private);
-  free(pcb);
+//callback on app thread
+static void _io_finish(IOCOMP *pcomp)
+{
+  IOREQ *req = pcomp->req;
 
-  return;
+  (*req->func)(req->private , req->private_len , pcomp->result , pcomp->argc , pcomp->argc>0? pcomp->argv : NULL , 
+    pcomp->argc>0? pcomp->arglen : NULL);
+  free(req);
+  free(pcomp);
+}
+
+//signal eventfd. full counter still wakes reader
+//return 0:success -1:failed
+static int _efd_write(int fd)
+{
+  uint64_t one = 1;
+
+  while(write(fd , &one , sizeof(one)) < 0)
+  {
+    if(errno == EINTR)
+      continue;
+    return errno==EAGAIN? 0 : -1;
+  }
+  return 0;
+}
+
+//clear eventfd. EAGAIN means already clear
+static void _efd_read(int fd)
+{
+  uint64_t cnt = 0;
+
+  while(read(fd , &cnt , sizeof(cnt))<0 && errno==EINTR)
+    ;
+}
+
+static void _io_free(REDISIO *io)
+{
+  if(!io)
+    return;
+  if(io->efd >= 0)
+    close(io->efd);
+  free(io->sq.slots);
+  free(io->cq.slots);
+  free(io);
 }
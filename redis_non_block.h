@@ -10,6 +10,9 @@ Created by soullei 2018-11-23
 #include <stdlib.h>
 #include <string.h>
 #include <sys/select.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <time.h>
 #include <hiredis/hiredis.h>
 #include <errno.h>
 #include <sys/socket.h>
@@ -41,12 +44,60 @@ typedef enum
 //max open
 #define REDIS_MAX_OPEN_NUM  1024
 
+//io backend of connected rds
+typedef enum
+{
+  REDIS_BACKEND_EPOLL = 0, //read and write each ready fd(default)
+  REDIS_BACKEND_URING //io_uring if kernel supports it. sends and recvs of all rds in one syscall per tick
+}REDIS_BACKEND;
+
+//when cmds appended by exec are written to socket
+typedef enum
+{
+  REDIS_FLUSH_TICK = 0, //once in next redis_tick(default)
+  REDIS_FLUSH_IMMEDIATE, //on every exec
+  REDIS_FLUSH_BYTES //when pending output reaches flush_bytes or in next redis_tick
+}REDIS_FLUSH_POLICY;
+
+//behavior when a backpressure limit is hit
+typedef enum
+{
+  REDIS_LIMIT_FAIL = 0, //exec fails
+  REDIS_LIMIT_QUEUE, //cmd waits in bounded overflow queue and is sent when fill level drops
+  REDIS_LIMIT_SHED //low priority cmd fails at 3/4 of limits, others fail at limits
+}REDIS_LIMIT_POLICY;
+
+//backpressure limits of a connection. 0:no limit
+typedef struct
+{
+  int max_pending; //outstanding cmds sent but not replied. a batch counts as one
+  int max_obuf; //bytes of output buffer not written yet
+  int max_ibuf; //bytes of reader buffer not parsed yet and replies being built. connection is closed when exceeded
+  int max_queue; //cmds in overflow queue of REDIS_LIMIT_QUEUE
+  REDIS_LIMIT_POLICY policy;
+}REDIS_LIMIT;
+
+//fill levels of a connection
+typedef struct
+{
+  int pending;
+  int obuf;
+  int ibuf;
+  int queued;
+}REDIS_FILL;
+
+//exec flags. refer redis_set_exec_flag
+#define REDIS_EXEC_LOWPRIO 0x01 //shed first under REDIS_LIMIT_SHED
+#define REDIS_EXEC_IDEMPOTENT 0x02 //replayed after managed reconnect instead of failing
+
 /************DATA STRUCT*****************/
 typedef enum
 {
   CB_RET_ERROR = -1, //error. and error detail stores in argv[0]
   CB_RET_SUCCESS = 0, //success
-  CB_RET_NO_NIL //no result
+  CB_RET_NO_NIL, //no result
+  CB_RET_TIMEOUT, //no reply before deadline. late reply is dropped
+  CB_RET_DISCONNECT //connection lost before reply and cmd not replayed
 }REDIS_CB_RESULT;
 /**
 *@private&private_len callback func private data and data length
@@ -57,19 +108,317 @@ typedef enum
 */
 typedef int (*REDIS_CALLBACK)(char *private , int private_len , REDIS_CB_RESULT result , int argc , char *argv[] , int arglen[]);
 
+//reply of each cmd in a batch. argc,argv,arglen same as REDIS_CALLBACK
+typedef struct
+{
+  REDIS_CB_RESULT result;
+  int argc;
+  char **argv;
+  int *arglen;
+}REDIS_BATCH_REPLY;
+
+/**
+*@private&private_len callback func private data and data length
+*@count: number of cmds in batch
+*@replies: reply of each cmd in submitting order
+*/
+typedef int (*REDIS_BATCH_CALLBACK)(char *private , int private_len , int count , REDIS_BATCH_REPLY replies[]);
+
+//read-only typed view of a reply. valid only inside callback
+typedef struct _reply_node redis_reply_t;
+
+/**
+*@private&private_len callback func private data and data length
+*@result:redis-cmd result. refer REDIS_CB_RESULT
+*@reply: typed reply. walk it by redis_reply_xx
+*/
+typedef int (*REDIS_REPLY_CALLBACK)(char *private , int private_len , REDIS_CB_RESULT result , const redis_reply_t *reply);
+
+//iterator of array/map/set reply
+typedef struct
+{
+  const redis_reply_t *reply;
+  int idx;
+}redis_reply_iter_t;
+
+/**
+*@private&private_len: registered with the channel or pattern
+*@channel&channel_len: channel the message published to
+*@msg&msg_len: payload. points into reply buffer and valid only inside callback
+*/
+typedef int (*REDIS_SUB_CALLBACK)(char *private , int private_len , const char *channel , int channel_len , 
+  const char *msg , int msg_len);
+
+//independent library state. rds,groups,epoll and timers of one context are never touched by another
+typedef struct _redis_ctx redis_ctx_t;
+
+//io thread running a context. cmds and replies pass through lock-free rings
+typedef struct _redis_io redis_io_t;
+
+//reusable command builder. args are encoded as RESP when appended
+typedef struct _redis_cmd redis_cmd_t;
+
+//precompiled command template. eg:"HGET user:%b name"
+typedef struct _redis_tpl redis_tpl_t;
+
 /************DATA STRUCT*****************/
 
 /************API FUNC*****************/
+/**
+*create an empty context. a thread binds it by redis_ctx_use and then runs its own loop without lock
+*@RETURN: context; NULL FAILED
+**/
+extern redis_ctx_t *redis_ctx_open();
+
+/**
+*bind context to calling thread. all following apis of this thread work on it
+*threads not bound use the default context which holds the former global state
+*@ctx: NULL:default context
+*@RETURN: context bound before
+**/
+extern redis_ctx_t *redis_ctx_use(redis_ctx_t *ctx);
+
+/**
+*close all groups and rds of a context and free it. default context can not be closed
+*@RETURN: 0 SUCCESS; -1 FAIL
+**/
+extern int redis_ctx_close(redis_ctx_t *ctx);
+
+/**
+*choose io backend of context of calling thread. epoll by default. takes effect when its first rd is opened and
+*falls back to epoll if io_uring is unavailable. contexts do not share it
+*@backend: REDIS_BACKEND_XX
+*@RETURN: 0 SUCCESS; -1 FAIL
+**/
+extern int redis_set_backend(REDIS_BACKEND backend);
+
+/**
+*io backend in use by context of calling thread
+*@RETURN: REDIS_BACKEND_XX
+**/
+extern REDIS_BACKEND redis_get_backend();
+
+/**
+*start an io thread owning ctx. sockets,reading and reply parsing all happen in it
+*ctx must not be used by app any more after start and is closed by redis_io_stop
+*@ctx: from redis_ctx_open with rds opened on it
+*@ring_size: slots of submission and completion ring. <=0 use default
+*@RETURN: io thread; NULL FAILED
+**/
+extern redis_io_t *redis_io_start(redis_ctx_t *ctx , int ring_size);
+
+/**
+*submit cmd to rd of io thread. cmd is formatted on calling thread
+*callback is called in redis_poll_completions. a cmd failed by io thread is called back with CB_RET_ERROR
+*@RETURN: 0 SUCCESS; -1 FAIL(submission ring full)
+**/
+extern int redis_io_exec(redis_io_t *io , int rd , char *cmd , REDIS_CALLBACK callback , char *private , int private_len);
+extern int redis_io_execv(redis_io_t *io , int rd , int argc , const char *argv[] , const size_t argvlen[] , 
+  REDIS_CALLBACK callback , char *private , int private_len);
+
+/**
+*call back completed cmds on calling thread
+*@max: most completions handled. <=0 all
+*@RETURN: completions handled; -1 FAIL
+**/
+extern int redis_poll_completions(redis_io_t *io , int max);
+
+/**
+*stop io thread and close its ctx. pending cmds are called back with CB_RET_DISCONNECT
+*@RETURN: 0 SUCCESS; -1 FAIL
+**/
+extern int redis_io_stop(redis_io_t *io);
+
 /**
 *open and create a connection to redis-server
 *@ip&port: server ip:port
 *@timeout: time out of connecting(seconds)
-*@log_level: refer REDIS_LOG_LEVEL(logfile:redis_non_block.log.xx)
+*@log_level: refer REDIS_LOG_LEVEL(logfile:redis_non_block.log.xx. redis_non_block.log.ctxN.xx of context N)
 *@RETURN: redis-descripter
 * >=0 SUCCESS -1 FAILED
 **/
 extern int redis_open(char *ip , int port , int timeout , REDIS_LOG_LEVEL log_level);
 
+/**
+*same as redis_open but timeout of connecting is in milliseconds
+*@timeout_ms: time out of connecting(ms)
+*@RETURN: redis-descripter
+* >=0 SUCCESS -1 FAILED
+**/
+extern int redis_open_ms(char *ip , int port , int timeout_ms , REDIS_LOG_LEVEL log_level);
+
+/**
+*open a pool of connections to one redis-server
+*@ip&port: server ip:port
+*@timeout: time out of connecting(seconds)
+*@size: connections in pool
+*@log_level: refer REDIS_LOG_LEVEL
+*@RETURN: pool-descripter
+* >=0 SUCCESS -1 FAILED
+**/
+extern int redis_pool_open(char *ip , int port , int timeout , int size , REDIS_LOG_LEVEL log_level);
+
+/**
+*pick a member rd of pool for exec
+*@pd: opened pool descriptor
+*@affinity: <0:connected member with fewest outstanding replies. >=0:fixed member(affinity%size) for cmds sharing one connection like MULTI
+*  picked as <0 while the fixed member is not connected
+*@RETURN: member rd; -1 if no connected member
+**/
+extern int redis_pool_rd(int pd , int affinity);
+
+/**
+*exec cmd on connected member with fewest outstanding replies. same as redis_exec(redis_pool_rd(pd , -1) , ...)
+*@RETURN: same as redis_exec
+**/
+extern int redis_pool_exec(int pd , char *cmd , REDIS_CALLBACK callback , char *private , int private_len);
+
+/**
+*close a pool and all its members
+*@RETURN: 0 SUCCESS; -1 FAIL
+**/
+extern int redis_pool_close(int pd);
+
+/**
+*open a redis cluster by one seed node. slot map is loaded from CLUSTER SLOTS in redis_tick
+*@ip&port: seed node
+*@timeout: time out of connecting(seconds). also used for discovered nodes
+*@log_level: refer REDIS_LOG_LEVEL
+*@RETURN: cluster-descripter
+* >=0 SUCCESS -1 FAILED
+**/
+extern int redis_cluster_open(char *ip , int port , int timeout , REDIS_LOG_LEVEL log_level);
+
+/**
+*rd of node serving key. MOVED/ASK replies of cmds on it are followed transparently
+*@cd: opened cluster descriptor
+*@key&keylen: key of cmd. {hashtag} honored
+*@RETURN: node rd; -1 if no connected node
+**/
+extern int redis_cluster_rd(int cd , const char *key , int keylen);
+
+/**
+*exec cmd on node of its key. key is the first arg(first key of EVAL/EVALSHA/FCALL)
+*@RETURN: same as redis_exec
+**/
+extern int redis_cluster_exec(int cd , char *cmd , REDIS_CALLBACK callback , char *private , int private_len);
+extern int redis_cluster_execv(int cd , int argc , const char *argv[] , const size_t argvlen[] , 
+  REDIS_CALLBACK callback , char *private , int private_len);
+
+/**
+*scatter a multi-key cmd over hash slots of cluster and gather one reply. refer redis_shard_mexec
+**/
+extern int redis_cluster_mexec(int cd , int argc , const char *argv[] , const size_t argvlen[] , 
+  REDIS_CALLBACK callback , char *private , int private_len);
+
+/**
+*close a cluster and all its nodes
+*@RETURN: 0 SUCCESS; -1 FAIL
+**/
+extern int redis_cluster_close(int cd);
+
+/**
+*group opened rds into a consistent-hash shard group(ketama ring of virtual nodes by ip:port of member)
+*@count&rds: opened redis descriptors. still owned by app
+*@vnodes: virtual nodes of each member. <=0:default 160
+*@rebalance: 1:keys of a FAIL or CLOSED member go to next member on ring until it is back. 0:they fail
+*@RETURN: shard-descripter
+* >=0 SUCCESS -1 FAILED
+**/
+extern int redis_shard_open(int count , int rds[] , int vnodes , int rebalance);
+
+/**
+*rd of member owning key
+*@RETURN: member rd; -1 if owner is down and not rebalanced
+**/
+extern int redis_shard_rd(int sd , const char *key , int keylen);
+
+/**
+*exec cmd on member owning key
+*@RETURN: same as redis_exec
+**/
+extern int redis_shard_exec(int sd , const char *key , int keylen , char *cmd , REDIS_CALLBACK callback , 
+  char *private , int private_len);
+
+/**
+*scatter a multi-key cmd(MGET,MSET,DEL,UNLINK,EXISTS,TOUCH) over owning members and gather one reply
+*@argc&argv&argvlen: same as redis_execv. argvlen NULL:strlen
+*@callback: called once. MGET:value of each key in order. MSET:OK. others:sum of integer replies
+*  failed if any sub cmd failed:result of first failure. argc 1 with error info if it is an error reply
+*@RETURN: 0 all sub cmds sent; 1 partly sent and callback will fail with CB_RET_ERROR; -1 FAILED and callback not called
+**/
+extern int redis_shard_mexec(int sd , int argc , const char *argv[] , const size_t argvlen[] , 
+  REDIS_CALLBACK callback , char *private , int private_len);
+
+/**
+*close a shard group. members are not closed
+*@RETURN: 0 SUCCESS; -1 FAIL
+**/
+extern int redis_shard_close(int sd);
+
+/**
+*group opened rds of a master and its replicas. read-only cmds go to replicas weighted by measured rtt
+*@master: rd of master. writes and reads without replica connected go here
+*@count&replicas: rds of replicas(at most 64). still owned by app
+*@hedge: 1:a read not answered within p95 latency is sent to a second node and first reply is used
+*@RETURN: group-descripter
+* >=0 SUCCESS -1 FAILED
+**/
+extern int redis_repl_open(int master , int count , int replicas[] , int hedge);
+
+/**
+*rd for next cmd of group
+*@read: 1:read-only cmd 0:write
+*@RETURN: rd; -1 FAILED
+**/
+extern int redis_repl_rd(int gd , int read);
+
+/**
+*exec cmd on group. read-only ones(GET,HGET,LRANGE,SMEMBERS...) routed to replicas
+*@RETURN: same as redis_exec
+**/
+extern int redis_repl_exec(int gd , char *cmd , REDIS_CALLBACK callback , char *private , int private_len);
+extern int redis_repl_execv(int gd , int argc , const char *argv[] , const size_t argvlen[] , 
+  REDIS_CALLBACK callback , char *private , int private_len);
+
+/**
+*close a replica group. members are not closed
+*@RETURN: 0 SUCCESS; -1 FAIL
+**/
+extern int redis_repl_close(int gd);
+
+/**
+*open a subscriber connection. may share ip:port with a connection opened by redis_open
+*@RETURN: redis-descripter. only redis_(p)(un)subscribe accepted on it
+* >=0 SUCCESS -1 FAILED
+**/
+extern int redis_sub_open(char *ip , int port , int timeout , REDIS_LOG_LEVEL log_level);
+
+/**
+*subscribe channels on rd and dispatch their messages to callback
+*an idle rd from redis_open becomes a subscriber connection. subscriptions are restored after reconnect
+*(un)subscribes in one tick are sent as one cmd
+*@count&channels: c-string channels. a subscribed channel only updates its callback
+*@callback&private&private_len: handler of these channels
+*@RETURN: 0 SUCCESS; -1 FAIL
+**/
+extern int redis_subscribe(int rd , int count , const char *channels[] , REDIS_SUB_CALLBACK callback , 
+  char *private , int private_len);
+
+/**
+*same as redis_subscribe but on glob-style patterns. eg:"room:*"
+**/
+extern int redis_psubscribe(int rd , int count , const char *patterns[] , REDIS_SUB_CALLBACK callback , 
+  char *private , int private_len);
+
+/**
+*unsubscribe channels or patterns. handler removed at once
+*@count: 0 for all
+*@RETURN: 0 SUCCESS; -1 FAIL
+**/
+extern int redis_unsubscribe(int rd , int count , const char *channels[]);
+extern int redis_punsubscribe(int rd , int count , const char *patterns[]);
+
 /**
 *check connect status 
 *@rd: opened redis descriptor
@@ -84,11 +433,94 @@ extern REDIS_CONN_FLAG redis_isconnect(int rd);
 **/
 extern int redis_reconnect(int rd);
 
+/**
+*set flush policy of output
+*@rd: opened redis descriptor
+*@policy: refer REDIS_FLUSH_POLICY
+*@flush_bytes: pending bytes threshold of REDIS_FLUSH_BYTES
+*@RETURN: 0 SUCCESS; -1 FAIL
+**/
+extern int redis_set_flush(int rd , REDIS_FLUSH_POLICY policy , int flush_bytes);
+
+/**
+*enable managed reconnect. redis_tick reconnects a failed or closed rd with jittered exponential backoff.
+*cmds marked REDIS_EXEC_IDEMPOTENT are held and replayed after reconnect, others fail with CB_RET_DISCONNECT
+*@rd: opened redis descriptor
+*@min_ms: first backoff(ms). <=0 disable managed mode
+*@max_ms: max backoff(ms)
+*@RETURN: 0 SUCCESS; -1 FAIL
+**/
+extern int redis_set_reconnect(int rd , int min_ms , int max_ms);
+
+/**
+*set backpressure limits
+*@rd: opened redis descriptor
+*@limit: limits and policy. NULL to remove limits
+*@RETURN: 0 SUCCESS; -1 FAIL
+**/
+extern int redis_set_limit(int rd , REDIS_LIMIT *limit);
+
+/**
+*get fill levels
+*@rd: opened redis descriptor
+*@fill: filled with current levels
+*@RETURN: 0 SUCCESS; -1 FAIL
+**/
+extern int redis_get_fill(int rd , REDIS_FILL *fill);
+
+/**
+*set flags of following execs on rd until changed
+*@rd: opened redis descriptor
+*@flags: REDIS_EXEC_XX or 0
+*@RETURN: 0 SUCCESS; -1 FAIL
+**/
+extern int redis_set_exec_flag(int rd , int flags);
+
+/**
+*set timeout of following execs on rd until changed
+*@rd: opened redis descriptor
+*@timeout_ms: deadline of each cmd(ms). 0:no timeout
+*@recycle: 1:reconnect when a cmd times out and fail all pending cmds with CB_RET_TIMEOUT. 0:keep connection
+*@RETURN: 0 SUCCESS; -1 FAIL
+**/
+extern int redis_set_exec_timeout(int rd , int timeout_ms , int recycle);
+
 /**
 *redis-tick. [Must Be Activtated in Loop of Process!]
 **/
 extern int redis_tick();
 
+/**
+*redis_tick with a work budget. reply dispatch stops once budget is used and the rest is handled first in next call.
+*connections cut off are served round-robin from the one after the last served
+*@max_replies: max replies called back. 0:no limit
+*@max_usec: max time spent on replies(us). time blocked in wait not counted. 0:no limit
+*@RETURN: 1 work remains; 0 all done; -1 FAIL
+**/
+extern int redis_tick_budget(int max_replies , int max_usec);
+
+/**
+*redis_tick that blocks until a connection is ready, a connect or cmd deadline expires or redis_wakeup is called
+*@timeout_ms: max time blocked(ms). 0:no block -1:no limit
+*@RETURN: 0 SUCCESS; -1 FAIL
+**/
+extern int redis_wait(int timeout_ms);
+
+/**
+*end redis_wait of ctx at once. may be called from any thread after first rd of ctx is opened
+*the wakeup fd is published with release ordering when first rd opens, so a call racing with that open fails safely
+*@ctx: NULL:default context
+*@RETURN: 0 SUCCESS; -1 FAIL
+**/
+extern int redis_wakeup(redis_ctx_t *ctx);
+
+/**
+*epoll fd of context of calling thread for nesting in reactor of app. call redis_wait(0) when it is readable
+*deadlines and cmds executed from outside the loop also make it readable
+*@RETURN: >=0 fd; -1 FAIL(no rd opened yet)
+**/
+extern int redis_get_pollfd();
+
 /**
 *exe redis cmd 
 *@rd: opened redis descriptor
@@ -100,6 +532,145 @@ extern int redis_tick();
 **/
 extern int redis_exec(int rd , char *cmd , REDIS_CALLBACK callback , char *private , int private_len);
 
+/**
+*exe redis cmd in argv form. binary safe and no format parsing
+*@rd: opened redis descriptor
+*@argc: count of cmd args
+*@argv: cmd args. eg:{"HSET" , "player:1" , "data" , blob}
+*@argvlen: length of each arg. if NULL every arg is a c-string
+*@callback&private&private_len: same as redis_exec
+*@RETURN: 0 SUCCESS; -1 FAIL
+**/
+extern int redis_execv(int rd , int argc , const char *argv[] , const size_t argvlen[] , REDIS_CALLBACK callback , 
+  char *private , int private_len);
+
+/**
+*create a command builder
+*@init_size: initial buffer size. <=0 use default
+*@RETURN: NULL FAIL; else builder which should be freed by redis_cmd_free
+**/
+extern redis_cmd_t *redis_cmd_new(int init_size);
+
+/**
+*clear args of a builder and keep its buffer for reuse
+**/
+extern void redis_cmd_reset(redis_cmd_t *cmd);
+
+/**
+*free a command builder
+**/
+extern void redis_cmd_free(redis_cmd_t *cmd);
+
+/**
+*append an arg to builder
+*@str: c-string arg
+*@data&len: binary arg
+*@value: integer arg
+*@RETURN: 0 SUCCESS; -1 FAIL
+**/
+extern int redis_cmd_append_str(redis_cmd_t *cmd , const char *str);
+extern int redis_cmd_append_bulk(redis_cmd_t *cmd , const char *data , int len);
+extern int redis_cmd_append_int(redis_cmd_t *cmd , long long value);
+
+/**
+*exe redis cmd built by redis_cmd_t. cmd is copied and can be reset after return
+*@rd: opened redis descriptor
+*@cmd: builder with at least one arg
+*@callback&private&private_len: same as redis_exec
+*@RETURN: 0 SUCCESS; -1 FAIL
+**/
+extern int redis_exec_cmd(int rd , redis_cmd_t *cmd , REDIS_CALLBACK callback , char *private , int private_len);
+
+/**
+*exe a batch of cmds in one pipeline with a single callback
+*@rd: opened redis descriptor
+*@count: number of cmds
+*@cmds: cmds built by redis_cmd_t. they are copied and can be reset after return
+*@callback: called once after reply of the last cmd arrives. if no callback sets to NULL
+*@private&private_len: same as redis_exec
+*@RETURN: 0 SUCCESS; -1 FAIL
+**/
+extern int redis_exec_batch(int rd , int count , redis_cmd_t *cmds[] , REDIS_BATCH_CALLBACK callback , char *private , 
+  int private_len);
+
+/**
+*compile a command template. args are separated by space
+*placeholder: %s(char *) %b(char * , size_t) %d(int) %lld(long long) %%(literal %)
+*@tpl: template. eg:"HSET player:%d %s %b"
+*@RETURN: NULL FAIL; else template which should be freed by redis_tpl_free
+**/
+extern redis_tpl_t *redis_tpl_compile(const char *tpl);
+
+/**
+*free a compiled template
+**/
+extern void redis_tpl_free(redis_tpl_t *tpl);
+
+/**
+*exe redis cmd of a compiled template
+*@rd: opened redis descriptor
+*@tpl: compiled template
+*@callback&private&private_len: same as redis_exec
+*@...: values of placeholders in order
+*@RETURN: 0 SUCCESS; -1 FAIL
+**/
+extern int redis_exec_tpl(int rd , redis_tpl_t *tpl , REDIS_CALLBACK callback , char *private , int private_len , ...);
+
+/**
+*exe redis cmd with a typed reply callback. same as redis_exec/redis_execv/redis_exec_cmd
+*but integers,doubles,booleans and nested arrays are passed as they are
+*@callback: typed callback of application if needed. if no callback sets to NULL
+*@RETURN: 0 SUCCESS; -1 FAIL
+**/
+extern int redis_exec_typed(int rd , char *cmd , REDIS_REPLY_CALLBACK callback , char *private , int private_len);
+extern int redis_execv_typed(int rd , int argc , const char *argv[] , const size_t argvlen[] , 
+  REDIS_REPLY_CALLBACK callback , char *private , int private_len);
+extern int redis_exec_cmd_typed(int rd , redis_cmd_t *cmd , REDIS_REPLY_CALLBACK callback , char *private , 
+  int private_len);
+
+/**
+*type of reply
+*@RETURN: REDIS_REPLY_XX of hiredis
+**/
+extern int redis_reply_type(const redis_reply_t *reply);
+
+/**
+*value of integer or boolean reply. 0 for other types
+**/
+extern long long redis_reply_integer(const redis_reply_t *reply);
+
+/**
+*value of double reply. integer reply is converted. 0 for other types
+**/
+extern double redis_reply_double(const redis_reply_t *reply);
+
+/**
+*string of string/status/error/double/integer reply
+*@len: length of string if not NULL
+*@RETURN: NULL if nil or aggregate
+**/
+extern const char *redis_reply_str(const redis_reply_t *reply , int *len);
+
+/**
+*count of elements of array/set/push reply. map counts both keys and values
+**/
+extern int redis_reply_count(const redis_reply_t *reply);
+
+/**
+*element of aggregate reply
+*@RETURN: NULL if out of range
+**/
+extern const redis_reply_t *redis_reply_elem(const redis_reply_t *reply , int idx);
+
+/**
+*walk elements of aggregate reply
+*redis_reply_next: next element. NULL if no more
+*redis_reply_next_pair: next key and value of map(or flat pair list as HGETALL). 1:got 0:no more
+**/
+extern void redis_reply_iter_init(redis_reply_iter_t *iter , const redis_reply_t *reply);
+extern const redis_reply_t *redis_reply_next(redis_reply_iter_t *iter);
+extern int redis_reply_next_pair(redis_reply_iter_t *iter , const redis_reply_t **key , const redis_reply_t **value);
+
 /**
 *close opened redis desciptor 
 *@RETURN: 0 SUCCESS; -1 FAIL